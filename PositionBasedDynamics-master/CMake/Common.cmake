@@ -43,3 +43,8 @@ OPTION(USE_DOUBLE_PRECISION "Use double precision"	ON)
 if (USE_DOUBLE_PRECISION)
 	add_definitions( -DUSE_DOUBLE)	
 endif (USE_DOUBLE_PRECISION)
+
+OPTION(USE_ROD_BLOCK_LDLT "Use unrolled 6x6 LDLT kernels without pivoting in the direct rod solver"	OFF)
+if (USE_ROD_BLOCK_LDLT)
+	add_definitions( -DUSE_ROD_BLOCK_LDLT)	
+endif (USE_ROD_BLOCK_LDLT)
@@ -311,6 +311,7 @@ void DemoBase::render()
 				selected = true;
 		}
 
+		rb[i]->getGeometry().updateVertexData();
 		const VertexData &vd = rb[i]->getGeometry().getVertexData();
 		const IndexedFaceMesh &mesh = rb[i]->getGeometry().getMesh();
 		if (!selected)
@@ -1,6 +1,8 @@
 #include "FluidModel.h"
 #include "PositionBasedDynamics/PositionBasedDynamics.h"
 #include "PositionBasedDynamics/SPHKernels.h"
+#include <algorithm>
+#include <cstdint>
 
 using namespace PBD;
 
@@ -10,7 +12,17 @@ FluidModel::FluidModel() :
 	m_density0 = static_cast<Real>(1000.0);
 	m_particleRadius = static_cast<Real>(0.025);
 	viscosity = static_cast<Real>(0.02);
+	m_vorticityConfinement = 0.0;
+	m_surfaceTension = 0.0;
+	m_neighborhoodSearchSkin = 0.0;
+	m_sortInterval = 0;
+	m_sortLocalityFactor = 0.0;
+	m_stepsSinceSort = 0;
+	m_sortedLocality = 0.0;
+	m_neighborLocality = 0.0;
 	m_neighborhoodSearch = NULL;
+	m_numStaticBoundaryParticles = 0;
+	m_rigidBodyCoupling = NULL;
 }
 
 FluidModel::~FluidModel(void)
@@ -27,6 +39,39 @@ void FluidModel::cleanupModel()
 	delete m_neighborhoodSearch;
 }
 
+void FluidModel::setNeighborhoodSearchSkin(Real val)
+{
+	m_neighborhoodSearchSkin = val;
+	if (m_neighborhoodSearch != NULL)
+		m_neighborhoodSearch->setSkin(val);
+}
+
+void FluidModel::setRigidBodyCoupling(FluidRigidBodyCoupling *coupling)
+{
+	m_rigidBodyCoupling = coupling;
+	updateRigidBodyBoundary();
+}
+
+void FluidModel::updateRigidBodyBoundary()
+{
+	const unsigned int numCoupled = (m_rigidBodyCoupling != NULL) ? m_rigidBodyCoupling->numBoundaryParticles() : 0;
+	if (m_boundaryX.size() != m_numStaticBoundaryParticles + numCoupled)
+	{
+		m_boundaryX.resize(m_numStaticBoundaryParticles + numCoupled);
+		m_boundaryPsi.resize(m_numStaticBoundaryParticles + numCoupled);
+	}
+
+	#pragma omp parallel default(shared)
+	{
+		#pragma omp for schedule(static)  
+		for (int i = 0; i < (int)numCoupled; i++)
+		{
+			m_boundaryX[m_numStaticBoundaryParticles + i] = m_rigidBodyCoupling->getBoundaryX(i);
+			m_boundaryPsi[m_numStaticBoundaryParticles + i] = m_density0 * m_rigidBodyCoupling->getBoundaryVolume(i);
+		}
+	}
+}
+
 void FluidModel::reset()
 {
 	const unsigned int nPoints = m_particles.size();
@@ -75,6 +120,13 @@ void FluidModel::resizeFluidParticles(const unsigned int newSize)
 	m_lambda.resize(newSize);
 	m_density.resize(newSize);
 	m_deltaX.resize(newSize);
+	m_particleId.resize(newSize);
+	m_particleIndex.resize(newSize);
+	for (unsigned int i = 0; i < newSize; i++)
+	{
+		m_particleId[i] = i;
+		m_particleIndex[i] = i;
+	}
 }
 
 
@@ -86,6 +138,8 @@ void FluidModel::releaseFluidParticles()
 	m_lambda.clear();
 	m_density.clear();
 	m_deltaX.clear();
+	m_particleId.clear();
+	m_particleIndex.clear();
 }
 
 void FluidModel::initModel(const unsigned int nFluidParticles, Vector3r* fluidParticles, const unsigned int nBoundaryParticles, Vector3r* boundaryParticles)
@@ -95,6 +149,7 @@ void FluidModel::initModel(const unsigned int nFluidParticles, Vector3r* fluidPa
 
 	// init kernel
 	CubicKernel::setRadius(m_supportRadius);
+	CohesionKernel::setRadius(m_supportRadius);
 
 	// copy fluid positions
 	#pragma omp parallel default(shared)
@@ -106,6 +161,7 @@ void FluidModel::initModel(const unsigned int nFluidParticles, Vector3r* fluidPa
 		}
 	}
 
+	m_numStaticBoundaryParticles = nBoundaryParticles;
 	m_boundaryX.resize(nBoundaryParticles);
 	m_boundaryPsi.resize(nBoundaryParticles);
 
@@ -155,6 +211,128 @@ void FluidModel::initModel(const unsigned int nFluidParticles, Vector3r* fluidPa
 	if (m_neighborhoodSearch == NULL)
 		m_neighborhoodSearch = new NeighborhoodSearchSpatialHashing(m_particles.size(), m_supportRadius);
 	m_neighborhoodSearch->setRadius(m_supportRadius);
+	m_neighborhoodSearch->setSkin(m_neighborhoodSearchSkin);
+	// the boundary particles are static, so they are only hashed once
+	m_neighborhoodSearch->setBoundaryParticles(nBoundaryParticles, m_boundaryX.data());
+
+	// append the boundary particles of the coupled rigid bodies
+	updateRigidBodyBoundary();
 
 	reset();
-}
\ No newline at end of file
+}
+
+/** Interleave the bits of the three 21 bit cell coordinates.
+*/
+static uint64_t mortonCode(const uint64_t x, const uint64_t y, const uint64_t z)
+{
+	uint64_t code = 0;
+	for (unsigned int i = 0; i < 21; i++)
+	{
+		code |= ((x >> i) & 1ull) << (3 * i);
+		code |= ((y >> i) & 1ull) << (3 * i + 1);
+		code |= ((z >> i) & 1ull) << (3 * i + 2);
+	}
+	return code;
+}
+
+void FluidModel::sortParticles()
+{
+	const unsigned int nParticles = m_particles.size();
+	if (nParticles == 0)
+		return;
+
+	Vector3r minX = m_particles.getPosition(0);
+	for (unsigned int i = 1; i < nParticles; i++)
+		minX = minX.cwiseMin(m_particles.getPosition(i));
+
+	// z-order of the grid cells
+	const Real factor = static_cast<Real>(1.0) / m_supportRadius;
+	const uint64_t maxCell = (1ull << 21) - 1ull;
+	std::vector<std::pair<uint64_t, unsigned int>> keys(nParticles);
+	#pragma omp parallel default(shared)
+	{
+		#pragma omp for schedule(static)  
+		for (int i = 0; i < (int)nParticles; i++)
+		{
+			const Vector3r cell = (m_particles.getPosition(i) - minX) * factor;
+			uint64_t c[3];
+			for (unsigned int j = 0; j < 3; j++)
+				c[j] = std::min((uint64_t) cell[j], maxCell);
+			keys[i] = std::make_pair(mortonCode(c[0], c[1], c[2]), (unsigned int) i);
+		}
+	}
+	std::sort(keys.begin(), keys.end());
+
+	std::vector<unsigned int> order(nParticles);
+	for (unsigned int i = 0; i < nParticles; i++)
+		order[i] = keys[i].second;
+
+	m_particles.permute(order);
+	ParticleData::permuteArray(m_lambda, order);
+	ParticleData::permuteArray(m_density, order);
+	ParticleData::permuteArray(m_deltaX, order);
+	ParticleData::permuteArray(m_particleId, order);
+	for (unsigned int i = 0; i < nParticles; i++)
+		m_particleIndex[m_particleId[i]] = i;
+
+	if (m_neighborhoodSearch != NULL)
+		m_neighborhoodSearch->invalidateVerletLists();
+
+	m_stepsSinceSort = 0;
+	m_sortedLocality = 0.0;
+}
+
+bool FluidModel::updateParticleOrder()
+{
+	m_stepsSinceSort++;
+	const bool scheduled = (m_sortInterval > 0) && (m_stepsSinceSort >= m_sortInterval);
+	const bool degraded = (m_sortLocalityFactor > 0.0) && (m_sortedLocality > 0.0) && 
+		(m_neighborLocality > m_sortLocalityFactor * m_sortedLocality);
+	if (scheduled || degraded)
+	{
+		sortParticles();
+		return true;
+	}
+	return false;
+}
+
+Real FluidModel::computeNeighborLocality()
+{
+	const unsigned int nParticles = m_particles.size();
+	if ((m_neighborhoodSearch == NULL) || (nParticles == 0))
+		return 0.0;
+	unsigned int **neighbors = m_neighborhoodSearch->getNeighbors();
+	unsigned int *numNeighbors = m_neighborhoodSearch->getNumNeighbors();
+
+	Real sum = 0.0;
+	unsigned int count = 0;
+	#pragma omp parallel default(shared)
+	{
+		Real sum_local = 0.0;
+		unsigned int count_local = 0;
+		#pragma omp for schedule(static) nowait
+		for (int i = 0; i < (int)nParticles; i++)
+		{
+			for (unsigned int j = 0; j < numNeighbors[i]; j++)
+			{
+				const unsigned int neighborIndex = neighbors[i][j];
+				if (neighborIndex < nParticles)
+				{
+					sum_local += std::abs((Real) neighborIndex - (Real) i);
+					count_local++;
+				}
+			}
+		}
+		#pragma omp critical
+		{
+			sum += sum_local;
+			count += count_local;
+		}
+	}
+	m_neighborLocality = (count > 0) ? sum / (Real) count : static_cast<Real>(0.0);
+
+	// reference value of the first search after sorting
+	if (m_sortedLocality == 0.0)
+		m_sortedLocality = m_neighborLocality;
+	return m_neighborLocality;
+}
@@ -4,6 +4,7 @@
 #include "Simulation/ParticleData.h"
 #include <vector>
 #include "Simulation/NeighborhoodSearchSpatialHashing.h"
+#include "Simulation/FluidRigidBodyCoupling.h"
 
 namespace PBD 
 {	
@@ -15,17 +16,40 @@ namespace PBD
 
 		protected:	
 			Real viscosity;
+			/** Coefficient of the vorticity confinement (0 disables it) */
+			Real m_vorticityConfinement;
+			/** Coefficient of the surface tension (0 disables it) */
+			Real m_surfaceTension;
+			/** Skin distance of the Verlet lists of the neighborhood search (0 disables them) */
+			Real m_neighborhoodSearchSkin;
 			Real m_density0;
 			Real m_particleRadius;
 			Real m_supportRadius;
 			ParticleData m_particles;
+			/** The static boundary particles are followed by the boundary particles of the coupled rigid bodies */
 			std::vector<Vector3r> m_boundaryX;
 			std::vector<Real> m_boundaryPsi;
+			unsigned int m_numStaticBoundaryParticles;
+			/** Two-way coupling with rigid bodies (not owned by the model) */
+			FluidRigidBodyCoupling *m_rigidBodyCoupling;
 			std::vector<Real> m_density;
 			std::vector<Real> m_lambda;		
 			std::vector<Vector3r> m_deltaX;
 			NeighborhoodSearchSpatialHashing *m_neighborhoodSearch;			
 
+			/** The particles are sorted along a z-order curve every m_sortInterval steps and if the neighbor
+			 * locality is worse than m_sortLocalityFactor times the locality after the last sort. Each trigger
+			 * works on its own and is disabled by a value of 0, both are disabled by default.
+			 */
+			unsigned int m_sortInterval;
+			Real m_sortLocalityFactor;
+			unsigned int m_stepsSinceSort;
+			Real m_sortedLocality;
+			Real m_neighborLocality;
+			/** Permutation map: id (creation index) of each particle and current index of each id */
+			std::vector<unsigned int> m_particleId;
+			std::vector<unsigned int> m_particleIndex;
+
 			void initMasses();
 
 			void resizeFluidParticles(const unsigned int newSize);
@@ -41,6 +65,7 @@ namespace PBD
 			void initModel(const unsigned int nFluidParticles, Vector3r* fluidParticles, const unsigned int nBoundaryParticles, Vector3r* boundaryParticles);
 
 			const unsigned int numBoundaryParticles() const { return (unsigned int)m_boundaryX.size(); }
+			const unsigned int numStaticBoundaryParticles() const { return m_numStaticBoundaryParticles; }
 			Real getDensity0() const { return m_density0; }
 			Real getSupportRadius() const { return m_supportRadius; }
 			Real getParticleRadius() const { return m_particleRadius; }
@@ -49,6 +74,38 @@ namespace PBD
 
 			Real getViscosity() const { return viscosity; }
 			void setViscosity(Real val) { viscosity = val; }
+			Real getVorticityConfinement() const { return m_vorticityConfinement; }
+			void setVorticityConfinement(Real val) { m_vorticityConfinement = val; }
+			Real getSurfaceTension() const { return m_surfaceTension; }
+			void setSurfaceTension(Real val) { m_surfaceTension = val; }
+			Real getNeighborhoodSearchSkin() const { return m_neighborhoodSearchSkin; }
+			void setNeighborhoodSearchSkin(Real val);
+
+			FluidRigidBodyCoupling *getRigidBodyCoupling() { return m_rigidBodyCoupling; }
+			/** Set the coupling with rigid bodies. Its boundary particles are appended to the static boundary particles. */
+			void setRigidBodyCoupling(FluidRigidBodyCoupling *coupling);
+			/** Copy the current positions of the boundary particles of the coupled rigid bodies. */
+			void updateRigidBodyBoundary();
+
+			unsigned int getSortInterval() const { return m_sortInterval; }
+			void setSortInterval(unsigned int val) { m_sortInterval = val; }
+			Real getSortLocalityFactor() const { return m_sortLocalityFactor; }
+			void setSortLocalityFactor(Real val) { m_sortLocalityFactor = val; }
+
+			/** Sort all particle arrays along a z-order curve of the grid with the cell size of the support radius.
+			 * The neighborhood information becomes invalid.
+			 */
+			void sortParticles();
+			/** Sort the particles if required by the sort interval or the neighbor locality. Returns true if the particles were sorted. */
+			bool updateParticleOrder();
+			/** Compute the mean index distance of neighboring fluid particles of the last neighborhood search. */
+			Real computeNeighborLocality();
+			Real getNeighborLocality() const { return m_neighborLocality; }
+
+			/** Return the creation index of the particle with the current index i. */
+			unsigned int getParticleId(const unsigned int i) const { return m_particleId[i]; }
+			/** Return the current index of the particle which was created with index id. */
+			unsigned int getParticleIndex(const unsigned int id) const { return m_particleIndex[id]; }
 
 			FORCE_INLINE const Vector3r& getBoundaryX(const unsigned int i) const
 			{
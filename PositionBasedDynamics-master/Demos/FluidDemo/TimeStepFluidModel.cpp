@@ -10,6 +10,15 @@ using namespace std;
 
 TimeStepFluidModel::TimeStepFluidModel()
 {
+	m_velocityUpdateMethod = 0;
+	m_kernelMethod = 0;
+	m_fusedConstraintProjection = false;
+	m_multiRate = false;
+	// step size of 0.4 particle diameters
+	m_adaptiveTimeStep.setCFLFactor(static_cast<Real>(0.4));
+	m_adaptiveTimeStep.setMinTimeStepSize(static_cast<Real>(0.0001));
+	m_adaptiveTimeStep.setMaxTimeStepSize(static_cast<Real>(0.005));
+	m_minCFLVelocity = sqrt(static_cast<Real>(0.1));
 }
 
 TimeStepFluidModel::~TimeStepFluidModel(void)
@@ -20,49 +29,108 @@ void TimeStepFluidModel::step(FluidModel &model)
 {
 	START_TIMING("simulation step");
 	TimeManager *tm = TimeManager::getCurrent ();
-	const Real h = tm->getTimeStepSize();
-	ParticleData &pd = model.getParticles();
 
+	if (m_multiRate)
+	{
+		// the time step size of the TimeManager is kept and the fluid takes substeps
+		const Real h = tm->getTimeStepSize();
+		advance(model, h);
+		tm->setTime(tm->getTime() + h);
+	}
+	else
+	{
+		clearAccelerations(model);
+
+		// Update time step size by CFL condition
+		updateTimeStepSizeCFL(model);
+		const Real h = tm->getTimeStepSize();
+		substep(model, h);
+
+		// Compute new time	
+		tm->setTime(tm->getTime() + h);
+	}
+	STOP_TIMING_AVG;
+}
+
+/** Advance the fluid by the time step size h without changing the TimeManager. 
+ * The fluid takes as many substeps of equal size as required by the CFL condition, so
+ * that it can be coupled with a model which is simulated with the larger step size h.
+ */
+void TimeStepFluidModel::advance(FluidModel &model, const Real h)
+{
 	clearAccelerations(model);
+	const Real diameter = static_cast<Real>(2.0)*model.getParticleRadius();
+	const Real maxVel = std::max(AdaptiveTimeStep::maxParticleVelocity(model.getParticles(), h), m_minCFLVelocity);
+	const unsigned int numSubsteps = m_adaptiveTimeStep.computeNumSubsteps(h, maxVel, diameter);
+	const Real hSub = h / static_cast<Real>(numSubsteps);
+	for (unsigned int i = 0; i < numSubsteps; i++)
+	{
+		if (i > 0)
+			clearAccelerations(model);
+		substep(model, hSub);
+	}
+}
 
-	// Update time step size by CFL condition
-	updateTimeStepSizeCFL(model, static_cast<Real>(0.0001), static_cast<Real>(0.005));
+/** Perform one simulation step of size h.
+*/
+void TimeStepFluidModel::substep(FluidModel &model, const Real h)
+{
+	// Sort the particles for memory coherence before the neighborhood search
+	model.updateParticleOrder();
+
+	ParticleData &pd = model.getParticles();
 
 	// Time integration
-	for (unsigned int i = 0; i < pd.size(); i++)
-	{ 
-		model.getDeltaX(i).setZero();
-		pd.getLastPosition(i) = pd.getOldPosition(i);
-		pd.getOldPosition(i) = pd.getPosition(i);
-		TimeIntegration::semiImplicitEuler(h, pd.getMass(i), pd.getPosition(i), pd.getVelocity(i), pd.getAcceleration(i));
+	const int numParticles = (int)pd.size();
+	#pragma omp parallel default(shared)
+	{
+		#pragma omp for schedule(static)  
+		for (int i = 0; i < numParticles; i++)
+		{ 
+			model.getDeltaX(i).setZero();
+			pd.getLastPosition(i) = pd.getOldPosition(i);
+			pd.getOldPosition(i) = pd.getPosition(i);
+			TimeIntegration::semiImplicitEuler(h, pd.getMass(i), pd.getPosition(i), pd.getVelocity(i), pd.getAcceleration(i));
+		}
+	}
+
+	// Move the boundary particles of the coupled rigid bodies
+	FluidRigidBodyCoupling *coupling = model.getRigidBodyCoupling();
+	if (coupling != NULL)
+	{
+		coupling->updateBoundary();
+		model.updateRigidBodyBoundary();
 	}
+	const unsigned int numStaticBoundary = model.numStaticBoundaryParticles();
+	const unsigned int numDynamicBoundary = model.numBoundaryParticles() - numStaticBoundary;
 
 	// Perform neighborhood search
 	START_TIMING("neighborhood search");
-	model.getNeighborhoodSearch()->neighborhoodSearch(&model.getParticles().getPosition(0), model.numBoundaryParticles(), &model.getBoundaryX(0));
+	model.getNeighborhoodSearch()->neighborhoodSearchStaticBoundary(&model.getParticles().getPosition(0), 
+		numDynamicBoundary, (numDynamicBoundary > 0) ? &model.getBoundaryX(numStaticBoundary) : NULL);
 	STOP_TIMING_AVG;
+	if (model.getSortLocalityFactor() > 0.0)
+		model.computeNeighborLocality();
 
 	// Solve density constraint
 	START_TIMING("constraint projection");
-	constraintProjection(model);
+	if (m_fusedConstraintProjection)
+		constraintProjectionFused(model);
+	else
+		constraintProjection(model);
 	STOP_TIMING_AVG;
 
-	// Update velocities	
-	for (unsigned int i = 0; i < pd.size(); i++)
-	{
-		if (m_velocityUpdateMethod == 0)
-			TimeIntegration::velocityUpdateFirstOrder(h, pd.getMass(i), pd.getPosition(i), pd.getOldPosition(i), pd.getVelocity(i));
-		else
-			TimeIntegration::velocityUpdateSecondOrder(h, pd.getMass(i), pd.getPosition(i), pd.getOldPosition(i), pd.getLastPosition(i), pd.getVelocity(i));
-	}
+	// Forces of the fluid on the coupled rigid bodies
+	if ((coupling != NULL) && (numDynamicBoundary > 0))
+		coupling->computeForces(numParticles, &pd.getPosition(0), &pd.getMass(0), m_lambdaSum.data(),
+			model.getNeighborhoodSearch()->getNeighbors(), model.getNeighborhoodSearch()->getNumNeighbors(), 
+			numStaticBoundary, model.getDensity0(), h);
 
-	// Compute viscosity 
-	computeXSPHViscosity(model);
+	// Update velocities and compute viscosity 
+	computeXSPHViscosity(model, h);
+	computeVorticityAndSurfaceTension(model, h);
 
-	// Compute new time	
-	tm->setTime (tm->getTime () + h);
 	model.getNeighborhoodSearch()->update();
-	STOP_TIMING_AVG;
 }
 
 
@@ -73,13 +141,17 @@ void TimeStepFluidModel::clearAccelerations(FluidModel &model)
 	ParticleData &pd = model.getParticles();
 	const unsigned int count = pd.size();
 	const Vector3r grav(0.0, -static_cast<Real>(9.81), 0.0);
-	for (unsigned int i=0; i < count; i++)
+	#pragma omp parallel default(shared)
 	{
-		// Clear accelerations of dynamic particles
-		if (pd.getMass(i) != 0.0)
+		#pragma omp for schedule(static)  
+		for (int i = 0; i < (int)count; i++)
 		{
-			Vector3r &a = pd.getAcceleration(i);
-			a = grav;
+			// Clear accelerations of dynamic particles
+			if (pd.getMass(i) != 0.0)
+			{
+				Vector3r &a = pd.getAcceleration(i);
+				a = grav;
+			}
 		}
 	}
 }
@@ -107,38 +179,20 @@ void TimeStepFluidModel::computeDensities(FluidModel &model)
 
 /** Update time step size by CFL condition.
 */
-void TimeStepFluidModel::updateTimeStepSizeCFL(FluidModel &model, const Real minTimeStepSize, const Real maxTimeStepSize)
+void TimeStepFluidModel::updateTimeStepSizeCFL(FluidModel &model)
 {
-	const Real radius = model.getParticleRadius();
-	const Real cflFactor = 1.0;
-	Real h = TimeManager::getCurrent()->getTimeStepSize();
+	const Real h = TimeManager::getCurrent()->getTimeStepSize();
 
 	// Approximate max. position change due to current velocities
-	Real maxVel = static_cast<Real>(0.1);
-	ParticleData &pd = model.getParticles();
-	const unsigned int numParticles = pd.size();
-	const Real diameter = static_cast<Real>(2.0)*radius;
-	for (unsigned int i = 0; i < numParticles; i++)
-	{
-		const Vector3r &vel = pd.getVelocity(i);
-		const Vector3r &accel = pd.getAcceleration(i);
-		const Real velMag = (vel + accel*h).squaredNorm();
-		if (velMag > maxVel)
-			maxVel = velMag;
-	}
+	const Real diameter = static_cast<Real>(2.0)*model.getParticleRadius();
+	const Real maxVel = std::max(AdaptiveTimeStep::maxParticleVelocity(model.getParticles(), h), m_minCFLVelocity);
 
-	// Approximate max. time step size 		
-	h = cflFactor * static_cast<Real>(0.4) * (diameter / (sqrt(maxVel)));
-
-	h = min(h, maxTimeStepSize);
-	h = max(h, minTimeStepSize);
-
-	TimeManager::getCurrent()->setTimeStepSize(h);
+	TimeManager::getCurrent()->setTimeStepSize(m_adaptiveTimeStep.computeTimeStepSize(maxVel, diameter));
 }
 
-/** Compute viscosity accelerations.
+/** Update the velocities and compute viscosity accelerations.
 */
-void TimeStepFluidModel::computeXSPHViscosity(FluidModel &model)
+void TimeStepFluidModel::computeXSPHViscosity(FluidModel &model, const Real h)
 {
 	ParticleData &pd = model.getParticles();
 	const unsigned int numParticles = pd.size();	
@@ -147,11 +201,21 @@ void TimeStepFluidModel::computeXSPHViscosity(FluidModel &model)
 	unsigned int *numNeighbors = model.getNeighborhoodSearch()->getNumNeighbors();
 
 	const Real viscosity = model.getViscosity();
-	const Real h = TimeManager::getCurrent()->getTimeStepSize();
+	const bool useCachedW = m_fusedConstraintProjection && (m_neighborOffsets.size() == numParticles + 1);
 
-	// Compute viscosity forces (XSPH)
 	#pragma omp parallel default(shared)
 	{
+		// Update velocities
+		#pragma omp for schedule(static)  
+		for (int i = 0; i < (int)numParticles; i++)
+		{
+			if (m_velocityUpdateMethod == 0)
+				TimeIntegration::velocityUpdateFirstOrder(h, pd.getMass(i), pd.getPosition(i), pd.getOldPosition(i), pd.getVelocity(i));
+			else
+				TimeIntegration::velocityUpdateSecondOrder(h, pd.getMass(i), pd.getPosition(i), pd.getOldPosition(i), pd.getLastPosition(i), pd.getVelocity(i));
+		}
+
+		// Compute viscosity forces (XSPH)
 		#pragma omp for schedule(static)  
 		for (int i = 0; i < (int)numParticles; i++)
 		{
@@ -167,7 +231,9 @@ void TimeStepFluidModel::computeXSPHViscosity(FluidModel &model)
 					const Vector3r &xj = pd.getPosition(neighborIndex);
 					const Vector3r &vj = pd.getVelocity(neighborIndex);
 					const Real density_j = model.getDensity(neighborIndex);
-					vi -= viscosity * (pd.getMass(neighborIndex) / density_j) * (vi - vj) * CubicKernel::W(xi - xj);
+					// the kernel values of the final positions are reused from the fused solver
+					const Real W = useCachedW ? m_pairW[m_neighborOffsets[i] + j] : CubicKernel::W(xi - xj);
+					vi -= viscosity * (pd.getMass(neighborIndex) / density_j) * (vi - vj) * W;
 
 				}
 // 				else 
@@ -181,7 +247,85 @@ void TimeStepFluidModel::computeXSPHViscosity(FluidModel &model)
 }
 
 
+/** Add the accelerations of the vorticity confinement and the surface tension to the velocities.
+ * The passes use the kernel gradients of the constraint projection if they are cached.
+*/
+void TimeStepFluidModel::computeVorticityAndSurfaceTension(FluidModel &model, const Real h)
+{
+	const Real vorticityConfinement = model.getVorticityConfinement();
+	const Real surfaceTension = model.getSurfaceTension();
+	if ((vorticityConfinement == 0.0) && (surfaceTension == 0.0))
+		return;
+
+	ParticleData &pd = model.getParticles();
+	const unsigned int numParticles = pd.size();
+	if (numParticles == 0)
+		return;
+
+	unsigned int **neighbors = model.getNeighborhoodSearch()->getNeighbors();
+	unsigned int *numNeighbors = model.getNeighborhoodSearch()->getNumNeighbors();
+	const bool useCachedW = m_fusedConstraintProjection && (m_neighborOffsets.size() == numParticles + 1);
+
+	m_vorticity.resize(numParticles);
+	m_normal.resize(numParticles);
+
+	#pragma omp parallel default(shared)
+	{
+		// kernel values of the neighbors of the current particle
+		std::vector<Real> W;
+		std::vector<Vector3r> gradW;
+		std::vector<Vector3r> xj;
+
+		// Compute vorticities and surface normals
+		#pragma omp for schedule(static)  
+		for (int i = 0; i < (int)numParticles; i++)
+		{
+			const Vector3r *gradW_i;
+			if (useCachedW)
+				gradW_i = m_pairGradW.data() + m_neighborOffsets[i];
+			else
+			{
+				W.resize(numNeighbors[i]);
+				gradW.resize(numNeighbors[i]);
+				computeKernelValues(model, i, W.data(), gradW.data(), xj);
+				gradW_i = gradW.data();
+			}
+
+			if (vorticityConfinement != 0.0)
+				PositionBasedFluids::computeVorticity(i, numParticles, &pd.getVelocity(0), &pd.getMass(0), &model.getDensity(0), numNeighbors[i], neighbors[i], gradW_i, m_vorticity[i]);
+			if (surfaceTension != 0.0)
+				PositionBasedFluids::computeSurfaceNormal(numParticles, &pd.getMass(0), &model.getDensity(0), numNeighbors[i], neighbors[i], gradW_i, model.getSupportRadius(), m_normal[i]);
+		}
 
+		// Update velocities (the accelerations do not depend on the velocities)
+		#pragma omp for schedule(static)  
+		for (int i = 0; i < (int)numParticles; i++)
+		{
+			Vector3r &vi = pd.getVelocity(i);
+			Vector3r accel;
+			if (vorticityConfinement != 0.0)
+			{
+				const Vector3r *gradW_i;
+				if (useCachedW)
+					gradW_i = m_pairGradW.data() + m_neighborOffsets[i];
+				else
+				{
+					W.resize(numNeighbors[i]);
+					gradW.resize(numNeighbors[i]);
+					computeKernelValues(model, i, W.data(), gradW.data(), xj);
+					gradW_i = gradW.data();
+				}
+				PositionBasedFluids::computeVorticityConfinement(i, numParticles, &pd.getMass(0), &model.getDensity(0), m_vorticity.data(), numNeighbors[i], neighbors[i], gradW_i, vorticityConfinement, accel);
+				vi += h * accel;
+			}
+			if (surfaceTension != 0.0)
+			{
+				PositionBasedFluids::computeSurfaceTension(i, numParticles, &pd.getPosition(0), &pd.getMass(0), &model.getDensity(0), m_normal.data(), numNeighbors[i], neighbors[i], model.getDensity0(), surfaceTension, accel);
+				vi += h * accel;
+			}
+		}
+	}
+}
 
 void TimeStepFluidModel::reset()
 {
@@ -200,30 +344,70 @@ void TimeStepFluidModel::constraintProjection(FluidModel &model)
 	const unsigned int nParticles = pd.size();
 	unsigned int **neighbors = model.getNeighborhoodSearch()->getNeighbors();
 	unsigned int *numNeighbors = model.getNeighborhoodSearch()->getNumNeighbors();
+	m_lambdaSum.assign(nParticles, 0.0);
+	initKernels(model);
 
 	while (iter < maxIter)
 	{
 		Real avg_density_err = 0.0;
 
-		#pragma omp parallel default(shared)
+		if (m_kernelMethod == 0)
 		{
-			#pragma omp for schedule(static)  
-			for (int i = 0; i < (int)nParticles; i++)
+			#pragma omp parallel default(shared)
 			{
-				Real density_err;
-				PositionBasedFluids::computePBFDensity(i, nParticles, &pd.getPosition(0), &pd.getMass(0), &model.getBoundaryX(0), &model.getBoundaryPsi(0), numNeighbors[i], neighbors[i], model.getDensity0(), true, density_err, model.getDensity(i));
-				PositionBasedFluids::computePBFLagrangeMultiplier(i, nParticles, &pd.getPosition(0), &pd.getMass(0), &model.getBoundaryX(0), &model.getBoundaryPsi(0), model.getDensity(i), numNeighbors[i], neighbors[i], model.getDensity0(), true, model.getLambda(i));
+				#pragma omp for schedule(static)  
+				for (int i = 0; i < (int)nParticles; i++)
+				{
+					Real density_err;
+					PositionBasedFluids::computePBFDensity(i, nParticles, &pd.getPosition(0), &pd.getMass(0), &model.getBoundaryX(0), &model.getBoundaryPsi(0), numNeighbors[i], neighbors[i], model.getDensity0(), true, density_err, model.getDensity(i));
+					PositionBasedFluids::computePBFLagrangeMultiplier(i, nParticles, &pd.getPosition(0), &pd.getMass(0), &model.getBoundaryX(0), &model.getBoundaryPsi(0), model.getDensity(i), numNeighbors[i], neighbors[i], model.getDensity0(), true, model.getLambda(i));
+					m_lambdaSum[i] += model.getLambda(i);
+				}
+			}
+
+			#pragma omp parallel default(shared)
+			{
+				#pragma omp for schedule(static)  
+				for (int i = 0; i < (int)nParticles; i++)
+				{
+					Vector3r corr;
+					PositionBasedFluids::solveDensityConstraint(i, nParticles, &pd.getPosition(0), &pd.getMass(0), &model.getBoundaryX(0), &model.getBoundaryPsi(0), numNeighbors[i], neighbors[i], model.getDensity0(), true, &model.getLambda(0), corr);
+					model.getDeltaX(i) = corr;
+				}
 			}
 		}
-		
-		#pragma omp parallel default(shared)
+		else
 		{
-			#pragma omp for schedule(static)  
-			for (int i = 0; i < (int)nParticles; i++)
+			const Real W_zero = (m_kernelMethod == 1) ? PrecomputedCubicKernel::W_zero() : CubicKernel::W_zero();
+			#pragma omp parallel default(shared)
 			{
-				Vector3r corr;
-				PositionBasedFluids::solveDensityConstraint(i, nParticles, &pd.getPosition(0), &pd.getMass(0), &model.getBoundaryX(0), &model.getBoundaryPsi(0), numNeighbors[i], neighbors[i], model.getDensity0(), true, &model.getLambda(0), corr);
-				model.getDeltaX(i) = corr;
+				// kernel values of the neighbors of the current particle
+				std::vector<Real> W;
+				std::vector<Vector3r> gradW;
+				std::vector<Vector3r> xj;
+
+				#pragma omp for schedule(static)  
+				for (int i = 0; i < (int)nParticles; i++)
+				{
+					W.resize(numNeighbors[i]);
+					gradW.resize(numNeighbors[i]);
+					computeKernelValues(model, i, W.data(), gradW.data(), xj);
+					Real density_err;
+					PositionBasedFluids::computePBFDensity(i, nParticles, &pd.getMass(0), &model.getBoundaryPsi(0), numNeighbors[i], neighbors[i], W_zero, W.data(), model.getDensity0(), true, density_err, model.getDensity(i));
+					PositionBasedFluids::computePBFLagrangeMultiplier(nParticles, &pd.getMass(0), &model.getBoundaryPsi(0), model.getDensity(i), numNeighbors[i], neighbors[i], gradW.data(), model.getDensity0(), true, model.getLambda(i));
+					m_lambdaSum[i] += model.getLambda(i);
+				}
+
+				#pragma omp for schedule(static)  
+				for (int i = 0; i < (int)nParticles; i++)
+				{
+					W.resize(numNeighbors[i]);
+					gradW.resize(numNeighbors[i]);
+					computeKernelValues(model, i, W.data(), gradW.data(), xj);
+					Vector3r corr;
+					PositionBasedFluids::solveDensityConstraint(i, nParticles, &pd.getMass(0), &model.getBoundaryPsi(0), numNeighbors[i], neighbors[i], gradW.data(), model.getDensity0(), true, &model.getLambda(0), corr);
+					model.getDeltaX(i) = corr;
+				}
 			}
 		}
 
@@ -240,3 +424,113 @@ void TimeStepFluidModel::constraintProjection(FluidModel &model)
 	}
 }
 
+
+/** Set the support radius of the kernels which are used by the selected kernel method. The table of
+ * the precomputed kernel is only built if this method is selected.
+ */
+void TimeStepFluidModel::initKernels(FluidModel &model)
+{
+	const Real radius = model.getSupportRadius();
+	if (CubicKernel::getRadius() != radius)
+		CubicKernel::setRadius(radius);
+	if ((m_kernelMethod == 1) && (PrecomputedCubicKernel::getRadius() != radius))
+		PrecomputedCubicKernel::setRadius(radius);
+}
+
+void TimeStepFluidModel::computeKernelValues(FluidModel &model, const unsigned int i, Real *W, Vector3r *gradW, std::vector<Vector3r> &xj)
+{
+	ParticleData &pd = model.getParticles();
+	const unsigned int nParticles = pd.size();
+	const unsigned int n = model.getNeighborhoodSearch()->getNumNeighbors()[i];
+	const unsigned int *neighbors = model.getNeighborhoodSearch()->getNeighbors()[i];
+	const Vector3r &xi = pd.getPosition(i);
+	xj.resize(n);
+
+	// gather the neighbor positions
+	for (unsigned int j = 0; j < n; j++)
+	{
+		const unsigned int neighborIndex = neighbors[j];
+		if (neighborIndex < nParticles)
+			xj[j] = pd.getPosition(neighborIndex);
+		else
+			xj[j] = model.getBoundaryX(neighborIndex - nParticles);
+	}
+
+	if (m_kernelMethod == 1)
+	{
+		for (unsigned int j = 0; j < n; j++)
+		{
+			const Vector3r r = xi - xj[j];
+			W[j] = PrecomputedCubicKernel::W(r);
+			gradW[j] = PrecomputedCubicKernel::gradW(r);
+		}
+	}
+	else if (m_kernelMethod == 2)
+		CubicKernel::batchW(xi, n, xj.data(), W, gradW);
+	else
+	{
+		for (unsigned int j = 0; j < n; j++)
+		{
+			const Vector3r r = xi - xj[j];
+			W[j] = CubicKernel::W(r);
+			gradW[j] = CubicKernel::gradW(r);
+		}
+	}
+}
+
+/** Solve density constraint with fused solver passes.
+*/
+void TimeStepFluidModel::constraintProjectionFused(FluidModel &model)
+{
+	const unsigned int maxIter = 5;
+
+	ParticleData &pd = model.getParticles();
+	const unsigned int nParticles = pd.size();
+	unsigned int **neighbors = model.getNeighborhoodSearch()->getNeighbors();
+	unsigned int *numNeighbors = model.getNeighborhoodSearch()->getNumNeighbors();
+
+	m_neighborOffsets.resize(nParticles + 1);
+	m_neighborOffsets[0] = 0;
+	for (unsigned int i = 0; i < nParticles; i++)
+		m_neighborOffsets[i + 1] = m_neighborOffsets[i] + numNeighbors[i];
+	m_pairW.resize(m_neighborOffsets[nParticles]);
+	m_pairGradW.resize(m_neighborOffsets[nParticles]);
+	m_lambdaSum.assign(nParticles, 0.0);
+	initKernels(model);
+
+	const Real W_zero = (m_kernelMethod == 1) ? PrecomputedCubicKernel::W_zero() : CubicKernel::W_zero();
+	#pragma omp parallel default(shared)
+	{
+		std::vector<Vector3r> xj;
+		for (unsigned int iter = 0; iter < maxIter; iter++)
+		{
+			// density and Lagrange multiplier
+			#pragma omp for schedule(static)  
+			for (int i = 0; i < (int)nParticles; i++)
+			{
+				Real *W = m_pairW.data() + m_neighborOffsets[i];
+				Vector3r *gradW = m_pairGradW.data() + m_neighborOffsets[i];
+				computeKernelValues(model, i, W, gradW, xj);
+				Real density_err;
+				PositionBasedFluids::computePBFDensity(i, nParticles, &pd.getMass(0), &model.getBoundaryPsi(0), numNeighbors[i], neighbors[i], W_zero, W, model.getDensity0(), true, density_err, model.getDensity(i));
+				PositionBasedFluids::computePBFLagrangeMultiplier(nParticles, &pd.getMass(0), &model.getBoundaryPsi(0), model.getDensity(i), numNeighbors[i], neighbors[i], gradW, model.getDensity0(), true, model.getLambda(i));
+				m_lambdaSum[i] += model.getLambda(i);
+			}
+
+			// The correction only uses the stored gradients, so the positions can be updated directly.
+			#pragma omp for schedule(static)  
+			for (int i = 0; i < (int)nParticles; i++)
+			{
+				Vector3r corr;
+				PositionBasedFluids::solveDensityConstraint(i, nParticles, &pd.getMass(0), &model.getBoundaryPsi(0), numNeighbors[i], neighbors[i], m_pairGradW.data() + m_neighborOffsets[i], model.getDensity0(), true, &model.getLambda(0), corr);
+				pd.getPosition(i) += corr;
+			}
+		}
+
+		// The viscosity, vorticity and surface tension passes reuse the kernel values, 
+		// so they are updated for the final positions.
+		#pragma omp for schedule(static)  
+		for (int i = 0; i < (int)nParticles; i++)
+			computeKernelValues(model, i, m_pairW.data() + m_neighborOffsets[i], m_pairGradW.data() + m_neighborOffsets[i], xj);
+	}
+}
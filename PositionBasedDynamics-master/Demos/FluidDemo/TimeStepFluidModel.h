@@ -2,6 +2,8 @@
 #define __TimeStepFluidModel_h__
 
 #include "FluidModel.h"
+#include "Simulation/AdaptiveTimeStep.h"
+#include <vector>
 
 namespace PBD
 {
@@ -9,11 +11,51 @@ namespace PBD
 	{
 	protected:
 		unsigned int m_velocityUpdateMethod;
+		/** 0: cubic kernel, 1: precomputed cubic kernel, 2: batch evaluation of the cubic kernel */
+		unsigned int m_kernelMethod;
+
+		/** If enabled, the density and the Lagrange multiplier are computed in a single pass and
+		 * the position corrections are applied directly in the correction pass. The kernel values 
+		 * of all neighbor pairs are stored once per iteration and are reused by the correction 
+		 * pass. After the last iteration they are updated for the final positions and are reused
+		 * by the viscosity, vorticity and surface tension passes. Disabled by default.
+		 */
+		bool m_fusedConstraintProjection;
+		/** Offsets of the neighbors of each particle in the pair buffers */
+		std::vector<unsigned int> m_neighborOffsets;
+		std::vector<Real> m_pairW;
+		std::vector<Vector3r> m_pairGradW;
+
+		/** CFL time step control which is shared with the solid time step method */
+		AdaptiveTimeStep m_adaptiveTimeStep;
+		/** Lower bound of the max. velocity in the CFL condition */
+		Real m_minCFLVelocity;
+		/** If enabled, the time step size of the TimeManager is not changed. Instead the fluid
+		 * takes several substeps within a time step if the CFL condition requires it.
+		 */
+		bool m_multiRate;
+
+		/** Sum of the Lagrange multipliers of all solver iterations, which determines the forces
+		 * of the fluid on coupled rigid bodies
+		 */
+		std::vector<Real> m_lambdaSum;
+
+		/** Vorticities and surface normals of the fluid particles */
+		std::vector<Vector3r> m_vorticity;
+		std::vector<Vector3r> m_normal;
+
+		/** Set the radius of the kernels of the selected kernel method. */
+		void initKernels(FluidModel &model);
+		/** Evaluate the kernel and its gradient for all neighbors of particle i by the selected kernel method. */
+		void computeKernelValues(FluidModel &model, const unsigned int i, Real *W, Vector3r *gradW, std::vector<Vector3r> &xj);
+		void constraintProjectionFused(FluidModel &model);
 
 		void clearAccelerations(FluidModel &model);
-		void computeXSPHViscosity(FluidModel &model);
+		void computeXSPHViscosity(FluidModel &model, const Real h);
+		/** Apply the vorticity confinement and the surface tension to the velocities. */
+		void computeVorticityAndSurfaceTension(FluidModel &model, const Real h);
 		void computeDensities(FluidModel &model);
-		void updateTimeStepSizeCFL(FluidModel &model, const Real minTimeStepSize, const Real maxTimeStepSize);
+		void substep(FluidModel &model, const Real h);
 		void constraintProjection(FluidModel &model);
 
 	public:
@@ -21,10 +63,23 @@ namespace PBD
 		virtual ~TimeStepFluidModel(void);
 
 		void step(FluidModel &model);
+		/** Advance the fluid by h in substeps which satisfy the CFL condition. The time of the
+		 * TimeManager is not changed, so the fluid can be stepped along with a SimulationModel.
+		 */
+		void advance(FluidModel &model, const Real h);
+		/** Set the time step size of the TimeManager by the CFL condition of the fluid. */
+		void updateTimeStepSizeCFL(FluidModel &model);
 		void reset();
 
 		unsigned int getVelocityUpdateMethod() const { return m_velocityUpdateMethod; }
 		void setVelocityUpdateMethod(unsigned int val) { m_velocityUpdateMethod = val; }
+		unsigned int getKernelMethod() const { return m_kernelMethod; }
+		void setKernelMethod(unsigned int val) { m_kernelMethod = val; }
+		bool getFusedConstraintProjection() const { return m_fusedConstraintProjection; }
+		void setFusedConstraintProjection(bool val) { m_fusedConstraintProjection = val; }
+		bool getMultiRate() const { return m_multiRate; }
+		void setMultiRate(bool val) { m_multiRate = val; }
+		AdaptiveTimeStep &getAdaptiveTimeStep() { return m_adaptiveTimeStep; }
 	};
 }
 
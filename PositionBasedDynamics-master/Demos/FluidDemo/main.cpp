@@ -7,7 +7,11 @@
 #include <Eigen/Dense>
 #include "FluidModel.h"
 #include "TimeStepFluidModel.h"
+#include "Simulation/Simulation.h"
+#include "Simulation/DistanceFieldCollisionDetection.h"
+#include "Simulation/FluidRigidBodyCoupling.h"
 #include <iostream>
+#include "Utils/OBJLoader.h"
 #include "Utils/Logger.h"
 #include "Utils/Timing.h"
 #include "Utils/FileSystem.h"
@@ -30,12 +34,15 @@ using namespace Utilities;
 void timeStep ();
 void buildModel ();
 void createBreakingDam();
+void createRigidBodies();
+void loadObj(const std::string &filename, VertexData &vd, IndexedFaceMesh &mesh, const Vector3r &scale);
 void addWall(const Vector3r &minX, const Vector3r &maxX, std::vector<Vector3r> &boundaryParticles);
 void initBoundaryData(std::vector<Vector3r> &boundaryParticles);
 void render ();
 void cleanup();
 void reset();
 void selection(const Eigen::Vector2i &start, const Eigen::Vector2i &end, void *clientData);
+void renderRigidBodies();
 void createSphereBuffers(Real radius, int resolution);
 void renderSphere(const Vector3r &x, const float color[]);
 void releaseSphereBuffers();
@@ -43,13 +50,31 @@ void TW_CALL setTimeStep(const void *value, void *clientData);
 void TW_CALL getTimeStep(void *value, void *clientData);
 void TW_CALL setVelocityUpdateMethod(const void *value, void *clientData);
 void TW_CALL getVelocityUpdateMethod(void *value, void *clientData);
+void TW_CALL setKernelMethod(const void *value, void *clientData);
+void TW_CALL getKernelMethod(void *value, void *clientData);
+void TW_CALL setMultiRate(const void *value, void *clientData);
+void TW_CALL getMultiRate(void *value, void *clientData);
+void TW_CALL setFusedConstraintProjection(const void *value, void *clientData);
+void TW_CALL getFusedConstraintProjection(void *value, void *clientData);
 void TW_CALL setViscosity(const void *value, void *clientData);
 void TW_CALL getViscosity(void *value, void *clientData);
+void TW_CALL setVorticityConfinement(const void *value, void *clientData);
+void TW_CALL getVorticityConfinement(void *value, void *clientData);
+void TW_CALL setSurfaceTension(const void *value, void *clientData);
+void TW_CALL getSurfaceTension(void *value, void *clientData);
+void TW_CALL setNeighborhoodSearchSkin(const void *value, void *clientData);
+void TW_CALL getNeighborhoodSearchSkin(void *value, void *clientData);
+void TW_CALL setSortInterval(const void *value, void *clientData);
+void TW_CALL getSortInterval(void *value, void *clientData);
+void TW_CALL setSortLocalityFactor(const void *value, void *clientData);
+void TW_CALL getSortLocalityFactor(void *value, void *clientData);
 
 
 
 FluidModel model;
 TimeStepFluidModel simulation;
+DistanceFieldCollisionDetection cd;
+FluidRigidBodyCoupling *rigidBodyCoupling = NULL;
 
 const Real particleRadius = static_cast<Real>(0.025);
 const unsigned int width = 15;
@@ -58,6 +83,7 @@ const unsigned int height = 20;
 const Real containerWidth = (width + 1)*particleRadius*static_cast<Real>(2.0 * 5.0);
 const Real containerDepth = (depth + 1)*particleRadius*static_cast<Real>(2.0);
 const Real containerHeight = 4.0;
+const Real boxSize = static_cast<Real>(0.3);
 bool doPause = true;
 std::vector<unsigned int> selectedParticles;
 Vector3r oldMousePos;
@@ -100,7 +126,20 @@ int main( int argc, char **argv )
 	TwAddVarCB(MiniGL::getTweakBar(), "TimeStepSize", TW_TYPE_REAL, setTimeStep, getTimeStep, &model, " label='Time step size'  min=0.0 max = 0.1 step=0.001 precision=4 group=Simulation ");
 	TwType enumType = TwDefineEnum("VelocityUpdateMethodType", NULL, 0);
 	TwAddVarCB(MiniGL::getTweakBar(), "VelocityUpdateMethod", enumType, setVelocityUpdateMethod, getVelocityUpdateMethod, &simulation, " label='Velocity update method' enum='0 {First Order Update}, 1 {Second Order Update}' group=Simulation");
+	TwType kernelEnumType = TwDefineEnum("KernelMethodType", NULL, 0);
+	TwAddVarCB(MiniGL::getTweakBar(), "KernelMethod", kernelEnumType, setKernelMethod, getKernelMethod, &simulation, " label='Kernel' enum='0 {Cubic}, 1 {Precomputed cubic}, 2 {Batch cubic}' group=Simulation");
+	TwAddVarCB(MiniGL::getTweakBar(), "MultiRate", TW_TYPE_BOOLCPP, setMultiRate, getMultiRate, &simulation, " label='Substeps (fixed step size)' group=Simulation");
+	TwAddVarCB(MiniGL::getTweakBar(), "FusedConstraintProjection", TW_TYPE_BOOLCPP, setFusedConstraintProjection, getFusedConstraintProjection, &simulation, " label='Fused solver' group=Simulation");
 	TwAddVarCB(MiniGL::getTweakBar(), "Viscosity", TW_TYPE_REAL, setViscosity, getViscosity, &model, " label='Viscosity'  min=0.0 max = 0.5 step=0.001 precision=4 group=Simulation ");
+	TwAddVarCB(MiniGL::getTweakBar(), "VorticityConfinement", TW_TYPE_REAL, setVorticityConfinement, getVorticityConfinement, &model, " label='Vorticity confinement'  min=0.0 max = 1.0 step=0.001 precision=4 group=Simulation ");
+	TwAddVarCB(MiniGL::getTweakBar(), "SurfaceTension", TW_TYPE_REAL, setSurfaceTension, getSurfaceTension, &model, " label='Surface tension'  min=0.0 max = 10.0 step=0.01 precision=4 group=Simulation ");
+	TwAddVarCB(MiniGL::getTweakBar(), "NeighborhoodSearchSkin", TW_TYPE_REAL, setNeighborhoodSearchSkin, getNeighborhoodSearchSkin, &model, " label='Neighborhood skin'  min=0.0 max = 0.1 step=0.005 precision=4 group=Simulation ");
+	TwAddVarCB(MiniGL::getTweakBar(), "SortInterval", TW_TYPE_UINT32, setSortInterval, getSortInterval, &model, " label='Sort interval'  min=0 max = 1000 step=1 group=Simulation ");
+	TwAddVarCB(MiniGL::getTweakBar(), "SortLocalityFactor", TW_TYPE_REAL, setSortLocalityFactor, getSortLocalityFactor, &model, " label='Sort locality factor'  min=0.0 max = 100.0 step=0.1 precision=2 group=Simulation ");
+
+	SimulationModel *rigidBodyModel = new SimulationModel();
+	rigidBodyModel->init();
+	Simulation::getCurrent()->setModel(rigidBodyModel);
 
 	buildModel();
 
@@ -118,7 +157,10 @@ int main( int argc, char **argv )
 
 void cleanup()
 {
-	delete TimeManager::getCurrent();
+	delete rigidBodyCoupling;
+	SimulationModel *rigidBodyModel = Simulation::getCurrent()->getModel();
+	delete Simulation::getCurrent();
+	delete rigidBodyModel;
 	if (context_major_version >= 3)
 		releaseSphereBuffers();
 }
@@ -128,9 +170,13 @@ void reset()
 	Timing::printAverageTimes();
 	Timing::reset();
 
+	Simulation::getCurrent()->reset();
+	TimeManager::getCurrent()->setTimeStepSize(static_cast<Real>(0.0025));
+	rigidBodyCoupling->reset();
+
 	model.reset();
+	model.updateRigidBodyBoundary();
 	simulation.reset();
-	TimeManager::getCurrent()->setTime(0.0);
 }
 
 void mouseMove(int x, int y, void *clientData)
@@ -170,8 +216,17 @@ void timeStep ()
 		return;
 
 	// Simulation code
+	TimeManager *tm = TimeManager::getCurrent();
+	SimulationModel *rigidBodyModel = Simulation::getCurrent()->getModel();
 	for (unsigned int i = 0; i < 8; i++)
-		simulation.step(model);
+	{
+		// Without multi-rate stepping the fluid determines the step size, otherwise it takes 
+		// substeps. The rigid body step applies the forces of the fluid and advances the time.
+		if (!simulation.getMultiRate())
+			simulation.updateTimeStepSizeCFL(model);
+		simulation.advance(model, tm->getTimeStepSize());
+		Simulation::getCurrent()->getTimeStep()->step(*rigidBodyModel);
+	}
 }
 
 void buildModel ()
@@ -179,6 +234,7 @@ void buildModel ()
 	TimeManager::getCurrent ()->setTimeStepSize (static_cast<Real>(0.0025));
 
 	createBreakingDam();
+	createRigidBodies();
 }
 
 void render ()
@@ -252,6 +308,8 @@ void render ()
 
 
 
+	renderRigidBodies();
+
 	float red[4] = { 0.8f, 0.0f, 0.0f, 1 };
 	for (unsigned int j = 0; j < selectedParticles.size(); j++)
 	{
@@ -302,6 +360,86 @@ void createBreakingDam()
 }
 
 
+/** Create floating boxes which are two-way coupled with the fluid. The container is a static
+* body with an inverted box distance field, so that the boxes collide with its walls.
+*/
+void createRigidBodies()
+{
+	SimulationModel *rigidBodyModel = Simulation::getCurrent()->getModel();
+	SimulationModel::RigidBodyVector &rb = rigidBodyModel->getRigidBodies();
+	Simulation::getCurrent()->getTimeStep()->setCollisionDetection(*rigidBodyModel, &cd);
+
+	string fileNameBox = FileSystem::normalizePath(dataPath + "/models/cube.obj");
+	IndexedFaceMesh meshBox;
+	VertexData vdBox;
+	loadObj(fileNameBox, vdBox, meshBox, Vector3r::Ones());
+
+	const unsigned int numBoxes = 3;
+	rb.resize(numBoxes + 1);
+
+	// container
+	const Vector3r containerSize(containerWidth, containerHeight, containerDepth);
+	rb[0] = new RigidBody();
+	rb[0]->initBody(1.0, Vector3r(0.0, static_cast<Real>(0.5)*containerHeight, 0.0), Quaternionr(1.0, 0.0, 0.0, 0.0), vdBox, meshBox, containerSize);
+	rb[0]->setMass(0.0);
+	const std::vector<Vector3r> *vertices = rb[0]->getGeometry().getVertexDataLocal().getVertices();
+	cd.addCollisionBox(0, CollisionDetection::CollisionObject::RigidBodyCollisionObjectType, &(*vertices)[0], (unsigned int)vertices->size(), containerSize, false, true);
+
+	// boxes with half and 0.8 times the density of the fluid
+	rigidBodyCoupling = new FluidRigidBodyCoupling(rigidBodyModel);
+	const Real density[numBoxes] = { static_cast<Real>(0.5)*model.getDensity0(), static_cast<Real>(0.8)*model.getDensity0(), static_cast<Real>(0.5)*model.getDensity0() };
+	for (unsigned int i = 1; i <= numBoxes; i++)
+	{
+		const Vector3r x(static_cast<Real>(-0.6 + 0.8*(i - 1)), static_cast<Real>(0.3 + 0.5*i), 0.0);
+		const Quaternionr q(AngleAxisr(static_cast<Real>(0.3*i), Vector3r(0.0, 0.0, 1.0)));
+		rb[i] = new RigidBody();
+		rb[i]->initBody(density[i - 1], x, q, vdBox, meshBox, Vector3r::Constant(boxSize));
+		vertices = rb[i]->getGeometry().getVertexDataLocal().getVertices();
+		cd.addCollisionBox(i, CollisionDetection::CollisionObject::RigidBodyCollisionObjectType, &(*vertices)[0], (unsigned int)vertices->size(), Vector3r::Constant(boxSize));
+		rigidBodyCoupling->addRigidBody(i, static_cast<Real>(2.0)*particleRadius, model.getSupportRadius());
+	}
+
+	model.setRigidBodyCoupling(rigidBodyCoupling);
+	Simulation::getCurrent()->getTimeStep()->setForceCallback(FluidRigidBodyCoupling::forceCallback, rigidBodyCoupling);
+
+	LOG_INFO << "Number of rigid body boundary particles: " << rigidBodyCoupling->numBoundaryParticles();
+}
+
+void loadObj(const std::string &filename, VertexData &vd, IndexedFaceMesh &mesh, const Vector3r &scale)
+{
+	std::vector<OBJLoader::Vec3f> x;
+	std::vector<OBJLoader::Vec3f> normals;
+	std::vector<OBJLoader::Vec2f> texCoords;
+	std::vector<MeshFaceIndices> faces;
+	OBJLoader::Vec3f s = { (float)scale[0], (float)scale[1], (float)scale[2] };
+	OBJLoader::loadObj(filename, &x, &faces, &normals, &texCoords, s);
+
+	mesh.release();
+	const unsigned int nPoints = (unsigned int)x.size();
+	const unsigned int nFaces = (unsigned int)faces.size();
+	mesh.initMesh(nPoints, nFaces * 2, nFaces);
+	vd.reserve(nPoints);
+	for (unsigned int i = 0; i < nPoints; i++)
+	{
+		vd.addVertex(Vector3r(x[i][0], x[i][1], x[i][2]));
+	}
+	for (unsigned int i = 0; i < nFaces; i++)
+	{
+		// Reduce the indices by one
+		int posIndices[3];
+		for (int j = 0; j < 3; j++)
+		{
+			posIndices[j] = faces[i].posIndices[j] - 1;
+		}
+
+		mesh.addFace(&posIndices[0]);
+	}
+	mesh.buildNeighbors();
+
+	mesh.updateNormals(vd, 0);
+	mesh.updateVertexNormals(vd);
+}
+
 void addWall(const Vector3r &minX, const Vector3r &maxX, std::vector<Vector3r> &boundaryParticles)
 {
 	const Real particleDistance = static_cast<Real>(2.0)*model.getParticleRadius();
@@ -357,6 +495,26 @@ void initBoundaryData(std::vector<Vector3r> &boundaryParticles)
 }
 
 
+/** Draw the dynamic rigid bodies, the container is not drawn.
+*/
+void renderRigidBodies()
+{
+	float boxColor[4] = { 0.6f, 0.4f, 0.2f, 1.0f };
+	SimulationModel::RigidBodyVector &rb = Simulation::getCurrent()->getModel()->getRigidBodies();
+	for (size_t i = 0; i < rb.size(); i++)
+	{
+		if (rb[i]->getMass() == 0.0)
+			continue;
+		RigidBodyGeometry &geometry = rb[i]->getGeometry();
+		geometry.updateVertexData();
+		const VertexData &vd = geometry.getVertexData();
+		const IndexedFaceMesh &mesh = geometry.getMesh();
+		const unsigned int *faces = mesh.getFaces().data();
+		for (unsigned int j = 0; j < mesh.numFaces(); j++)
+			MiniGL::drawTriangle(vd.getPosition(faces[3 * j]), vd.getPosition(faces[3 * j + 1]), vd.getPosition(faces[3 * j + 2]), mesh.getFaceNormals()[j], boxColor);
+	}
+}
+
 void createSphereBuffers(Real radius, int resolution)
 {
 	Real PI = static_cast<Real>(M_PI);
@@ -517,6 +675,37 @@ void TW_CALL getVelocityUpdateMethod(void *value, void *clientData)
 	*(short *)(value) = (short)((TimeStepFluidModel*)clientData)->getVelocityUpdateMethod();
 }
 
+void TW_CALL setKernelMethod(const void *value, void *clientData)
+{
+	const short val = *(const short *)(value);
+	((TimeStepFluidModel*)clientData)->setKernelMethod((unsigned int)val);
+}
+
+void TW_CALL getKernelMethod(void *value, void *clientData)
+{
+	*(short *)(value) = (short)((TimeStepFluidModel*)clientData)->getKernelMethod();
+}
+
+void TW_CALL setMultiRate(const void *value, void *clientData)
+{
+	((TimeStepFluidModel*)clientData)->setMultiRate(*(const bool *)(value));
+}
+
+void TW_CALL getMultiRate(void *value, void *clientData)
+{
+	*(bool *)(value) = ((TimeStepFluidModel*)clientData)->getMultiRate();
+}
+
+void TW_CALL setFusedConstraintProjection(const void *value, void *clientData)
+{
+	((TimeStepFluidModel*)clientData)->setFusedConstraintProjection(*(const bool *)(value));
+}
+
+void TW_CALL getFusedConstraintProjection(void *value, void *clientData)
+{
+	*(bool *)(value) = ((TimeStepFluidModel*)clientData)->getFusedConstraintProjection();
+}
+
 void TW_CALL setViscosity(const void *value, void *clientData)
 {
 	const Real val = *(const Real *)(value);
@@ -528,3 +717,58 @@ void TW_CALL getViscosity(void *value, void *clientData)
 	*(Real *)(value) = ((FluidModel*)clientData)->getViscosity();
 }
 
+void TW_CALL setVorticityConfinement(const void *value, void *clientData)
+{
+	const Real val = *(const Real *)(value);
+	((FluidModel*)clientData)->setVorticityConfinement(val);
+}
+
+void TW_CALL getVorticityConfinement(void *value, void *clientData)
+{
+	*(Real *)(value) = ((FluidModel*)clientData)->getVorticityConfinement();
+}
+
+void TW_CALL setSurfaceTension(const void *value, void *clientData)
+{
+	const Real val = *(const Real *)(value);
+	((FluidModel*)clientData)->setSurfaceTension(val);
+}
+
+void TW_CALL getSurfaceTension(void *value, void *clientData)
+{
+	*(Real *)(value) = ((FluidModel*)clientData)->getSurfaceTension();
+}
+
+void TW_CALL setNeighborhoodSearchSkin(const void *value, void *clientData)
+{
+	const Real val = *(const Real *)(value);
+	((FluidModel*)clientData)->setNeighborhoodSearchSkin(val);
+}
+
+void TW_CALL getNeighborhoodSearchSkin(void *value, void *clientData)
+{
+	*(Real *)(value) = ((FluidModel*)clientData)->getNeighborhoodSearchSkin();
+}
+
+void TW_CALL setSortInterval(const void *value, void *clientData)
+{
+	const unsigned int val = *(const unsigned int *)(value);
+	((FluidModel*)clientData)->setSortInterval(val);
+}
+
+void TW_CALL getSortInterval(void *value, void *clientData)
+{
+	*(unsigned int *)(value) = ((FluidModel*)clientData)->getSortInterval();
+}
+
+void TW_CALL setSortLocalityFactor(const void *value, void *clientData)
+{
+	const Real val = *(const Real *)(value);
+	((FluidModel*)clientData)->setSortLocalityFactor(val);
+}
+
+void TW_CALL getSortLocalityFactor(void *value, void *clientData)
+{
+	*(Real *)(value) = ((FluidModel*)clientData)->getSortLocalityFactor();
+}
+
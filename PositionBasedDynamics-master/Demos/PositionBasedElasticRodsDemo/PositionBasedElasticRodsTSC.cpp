@@ -89,8 +89,8 @@ void PositionBasedElasticRodsTSC::step(SimulationModel &model)
 				TimeIntegration::velocityUpdateSecondOrder(h, rb[i]->getMass(), rb[i]->getPosition(), rb[i]->getOldPosition(), rb[i]->getLastPosition(), rb[i]->getVelocity());
 				TimeIntegration::angularVelocityUpdateSecondOrder(h, rb[i]->getMass(), rb[i]->getRotation(), rb[i]->getOldRotation(), rb[i]->getLastRotation(), rb[i]->getAngularVelocity());
 			}
-			// update geometry
-			rb[i]->getGeometry().updateMeshTransformation(rb[i]->getPosition(), rb[i]->getRotationMatrix());
+			// update geometry, the mesh is transformed on demand
+			rb[i]->getGeometry().setTransformation(rb[i]->getPosition(), rb[i]->getRotationMatrix());
  		}
 
 		// Update velocities	
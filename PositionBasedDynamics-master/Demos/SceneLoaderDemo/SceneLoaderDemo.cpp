@@ -13,6 +13,7 @@
 #include "Utils/SceneLoader.h"
 #include "Utils/TetGenLoader.h"
 #include "Simulation/CubicSDFCollisionDetection.h"
+#include "Simulation/SDFCache.h"
 #include "Utils/Logger.h"
 #include "Utils/Timing.h"
 #include "Utils/FileSystem.h"
@@ -56,6 +57,7 @@ DemoBase *base;
 Vector3r camPos;
 Vector3r camLookat;
 CubicSDFCollisionDetection cd;
+SDFCache sdfCache;
 
 short clothSimulationMethod = 2;
 short solidSimulationMethod = 2;
@@ -78,6 +80,8 @@ int main( int argc, char **argv )
 
 	base = new DemoBase();
 	base->init(argc, argv, sceneFileName.c_str());
+	// the signed distance fields are cached in the directory of the scene
+	sdfCache.setCachePath(FileSystem::getFilePath(base->getSceneFile()) + "/Cache");
 
 	SimulationModel *model = new SimulationModel();
 	model->init();
@@ -420,82 +424,19 @@ void loadObj(const std::string &filename, VertexData &vd, IndexedFaceMesh &mesh,
 	LOG_INFO << "Number of vertices: " << nPoints;
 }
 
-CubicSDFCollisionDetection::GridPtr generateSDF(const std::string &modelFile, const std::string &collisionObjectFileName, const Eigen::Matrix<unsigned int, 3, 1> &resolutionSDF, 
+CubicSDFCollisionDetection::GridPtr generateSDF(const std::string &collisionObjectFileName, const Eigen::Matrix<unsigned int, 3, 1> &resolutionSDF, 
 	VertexData &vd, IndexedFaceMesh &mesh)
 {
-	const std::string basePath = FileSystem::getFilePath(base->getSceneFile());
-	const string cachePath = basePath + "/Cache";
-	const std::string modelFileName = FileSystem::getFileNameWithExt(modelFile);
-	CubicSDFCollisionDetection::GridPtr distanceField;
-	
 	if (collisionObjectFileName == "")
-	{
-		std::string md5FileName = FileSystem::normalizePath(cachePath + "/" + modelFileName + ".md5");
-		string md5Str = FileSystem::getFileMD5(modelFile);
-		bool md5 = false;
-		if (FileSystem::fileExists(md5FileName))
-			md5 = FileSystem::checkMD5(md5Str, md5FileName);
-
-		// check MD5 if cache file is available
-		const string resStr = to_string(resolutionSDF[0]) + "_" + to_string(resolutionSDF[1]) + "_" + to_string(resolutionSDF[2]);
-		const string sdfFileName = FileSystem::normalizePath(cachePath + "/" + modelFileName + "_" + resStr + ".csdf");
-		bool foundCacheFile = FileSystem::fileExists(sdfFileName);
-
-		if (foundCacheFile && md5)
-		{
-			LOG_INFO << "Load cached SDF: " << sdfFileName;
-			distanceField = std::make_shared<CubicSDFCollisionDetection::Grid>(sdfFileName);
-		}
-		else
-		{
-			std::vector<unsigned int> &faces = mesh.getFaces();
-			const unsigned int nFaces = mesh.numFaces();
+		return sdfCache.getCubicSDF(vd, mesh, resolutionSDF);
 
-#ifdef USE_DOUBLE
-			Discregrid::TriangleMesh sdfMesh(&vd.getPosition(0)[0], faces.data(), vd.size(), nFaces);
-#else
-			// if type is float, copy vector to double vector
-			std::vector<double> doubleVec;
-			doubleVec.resize(3 * vd.size());
-			for (unsigned int i = 0; i < vd.size(); i++)
-				for (unsigned int j = 0; j < 3; j++)
-					doubleVec[3 * i + j] = vd.getPosition(i)[j];
-			Discregrid::TriangleMesh sdfMesh(&doubleVec[0], faces.data(), vd.size(), nFaces);
-#endif
-			Discregrid::MeshDistance md(sdfMesh);
-			Eigen::AlignedBox3d domain;
-			for (auto const& x : sdfMesh.vertices())
-			{
-				domain.extend(x);
-			}
-			domain.max() += 1.0e-3 * domain.diagonal().norm() * Eigen::Vector3d::Ones();
-			domain.min() -= 1.0e-3 * domain.diagonal().norm() * Eigen::Vector3d::Ones();
-
-			LOG_INFO << "Set SDF resolution: " << resolutionSDF[0] << ", " << resolutionSDF[1] << ", " << resolutionSDF[2];
-			distanceField = std::make_shared<CubicSDFCollisionDetection::Grid>(domain, std::array<unsigned int, 3>({ resolutionSDF[0], resolutionSDF[1], resolutionSDF[2] }));
-			auto func = Discregrid::DiscreteGrid::ContinuousFunction{};
-			func = [&md](Eigen::Vector3d const& xi) {return md.signedDistanceCached(xi); };
-			LOG_INFO << "Generate SDF for " << modelFile;
-			distanceField->addFunction(func, true);
-			if (FileSystem::makeDir(cachePath) == 0)
-			{
-				LOG_INFO << "Save SDF: " << sdfFileName;
-				distanceField->save(sdfFileName);
-				FileSystem::writeMD5File(modelFile, md5FileName);
-			}
-		}
-	}
-	else
+	std::string fileName = collisionObjectFileName;
+	if (FileSystem::isRelativePath(fileName))
 	{
-		std::string fileName = collisionObjectFileName;
-		if (FileSystem::isRelativePath(fileName))
-		{
-			fileName = FileSystem::normalizePath(basePath + "/" + fileName);
-		}
-		LOG_INFO << "Load SDF: " << fileName;
-		distanceField = std::make_shared<CubicSDFCollisionDetection::Grid>(fileName);
+		const std::string basePath = FileSystem::getFilePath(base->getSceneFile());
+		fileName = FileSystem::normalizePath(basePath + "/" + fileName);
 	}
-	return distanceField;
+	return sdfCache.loadCubicSDF(fileName);
 }
 
 
@@ -552,7 +493,8 @@ void readScene(const bool readFile)
 
 	// map file names to loaded geometry to prevent multiple imports of same files
 	std::map<std::string, pair<VertexData, IndexedFaceMesh>> objFiles;
-	std::map<std::string, CubicSDFCollisionDetection::GridPtr> distanceFields;
+	std::vector<CubicSDFCollisionDetection::GridPtr> rigidBodySDFs(data.m_rigidBodyData.size());
+	std::vector<CubicSDFCollisionDetection::GridPtr> tetModelSDFs(data.m_tetModelData.size());
 	for (unsigned int i = 0; i < data.m_rigidBodyData.size(); i++)
 	{
 		SceneLoader::RigidBodyData &rbd = data.m_rigidBodyData[i];
@@ -567,93 +509,12 @@ void readScene(const bool readFile)
 			objFiles[rbd.m_modelFile] = { vd, mesh };
 		}
 
-		const std::string basePath = FileSystem::getFilePath(base->getSceneFile());
-		const string cachePath = basePath + "/Cache";
-		const string resStr = to_string(rbd.m_resolutionSDF[0]) + "_" + to_string(rbd.m_resolutionSDF[1]) + "_" + to_string(rbd.m_resolutionSDF[2]);
-		const std::string modelFileName = FileSystem::getFileNameWithExt(rbd.m_modelFile);
-		const string sdfFileName = FileSystem::normalizePath(cachePath + "/" + modelFileName + "_" + resStr + ".csdf");
-
-		std::string sdfKey = rbd.m_collisionObjectFileName;
-		if (sdfKey == "")
+		// Generate SDF, the cache shares the fields of equal meshes and resolutions
+		if (rbd.m_collisionObjectType == SceneLoader::SDF)
 		{
-			sdfKey = sdfFileName;
-		}
-		if (distanceFields.find(sdfKey) == distanceFields.end())
-		{
-			// Generate SDF
-			if (rbd.m_collisionObjectType == SceneLoader::SDF)
-			{
-				if (rbd.m_collisionObjectFileName == "")
-				{
-					std::string md5FileName = FileSystem::normalizePath(cachePath + "/" + modelFileName + ".md5");
-					string md5Str = FileSystem::getFileMD5(rbd.m_modelFile);
-					bool md5 = false;
-					if (FileSystem::fileExists(md5FileName))
-						md5 = FileSystem::checkMD5(md5Str, md5FileName);
-
-					// check MD5 if cache file is available
-					const string resStr = to_string(rbd.m_resolutionSDF[0]) + "_" + to_string(rbd.m_resolutionSDF[1]) + "_" + to_string(rbd.m_resolutionSDF[2]);
-					const string sdfFileName = FileSystem::normalizePath(cachePath + "/" + modelFileName + "_" + resStr + ".csdf");
-					bool foundCacheFile = FileSystem::fileExists(sdfFileName);
-
-					if (foundCacheFile && md5)
-					{
-						LOG_INFO << "Load cached SDF: " << sdfFileName;
-						distanceFields[sdfFileName] = std::make_shared<CubicSDFCollisionDetection::Grid>(sdfFileName);
-					}
-					else
-					{
-						VertexData &vd = objFiles[rbd.m_modelFile].first;
-						IndexedFaceMesh &mesh = objFiles[rbd.m_modelFile].second;
-
-						std::vector<unsigned int> &faces = mesh.getFaces();
-						const unsigned int nFaces = mesh.numFaces();
-
-#ifdef USE_DOUBLE
-						Discregrid::TriangleMesh sdfMesh(&vd.getPosition(0)[0], faces.data(), vd.size(), nFaces);
-#else
-						// if type is float, copy vector to double vector
-						std::vector<double> doubleVec;
-						doubleVec.resize(3 * vd.size());
-						for (unsigned int i = 0; i < vd.size(); i++)
-							for (unsigned int j = 0; j < 3; j++)
-								doubleVec[3 * i + j] = vd.getPosition(i)[j];
-						Discregrid::TriangleMesh sdfMesh(&doubleVec[0], faces.data(), vd.size(), nFaces);
-#endif
-						Discregrid::MeshDistance md(sdfMesh);
-						Eigen::AlignedBox3d domain;
-						for (auto const& x : sdfMesh.vertices())
-						{
-							domain.extend(x);
-						}
-						domain.max() += 1.0e-3 * domain.diagonal().norm() * Eigen::Vector3d::Ones();
-						domain.min() -= 1.0e-3 * domain.diagonal().norm() * Eigen::Vector3d::Ones();
-
-						LOG_INFO << "Set SDF resolution: " << rbd.m_resolutionSDF[0] << ", " << rbd.m_resolutionSDF[1] << ", " << rbd.m_resolutionSDF[2];
-						distanceFields[sdfFileName] = std::make_shared<CubicSDFCollisionDetection::Grid>(domain, std::array<unsigned int, 3>({ rbd.m_resolutionSDF[0], rbd.m_resolutionSDF[1], rbd.m_resolutionSDF[2] }));
-						auto func = Discregrid::DiscreteGrid::ContinuousFunction{};
-						func = [&md](Eigen::Vector3d const& xi) {return md.signedDistanceCached(xi); };
-						LOG_INFO << "Generate SDF for " << rbd.m_modelFile;
-						distanceFields[sdfFileName]->addFunction(func, true);
-						if (FileSystem::makeDir(cachePath) == 0)
-						{
-							LOG_INFO << "Save SDF: " << sdfFileName;
-							distanceFields[sdfFileName]->save(sdfFileName);
-							FileSystem::writeMD5File(rbd.m_modelFile, md5FileName);
-						}
-					}
-				}
-				else
-				{
-					std::string fileName = rbd.m_collisionObjectFileName;
-					if (FileSystem::isRelativePath(fileName))
-					{
-						fileName = FileSystem::normalizePath(basePath + "/" + fileName);
-					}
-					LOG_INFO << "Load SDF: " << fileName;
-					distanceFields[rbd.m_collisionObjectFileName] = std::make_shared<CubicSDFCollisionDetection::Grid>(fileName);
-				}
-			}
+			VertexData &vd = objFiles[rbd.m_modelFile].first;
+			IndexedFaceMesh &mesh = objFiles[rbd.m_modelFile].second;
+			rigidBodySDFs[i] = generateSDF(rbd.m_collisionObjectFileName, rbd.m_resolutionSDF, vd, mesh);
 		}
 	}
 
@@ -671,32 +532,12 @@ void readScene(const bool readFile)
 			objFiles[tmd.m_modelFileVis] = { vd, mesh };
 		}
 
-		const std::string basePath = FileSystem::getFilePath(base->getSceneFile());
-		const string cachePath = basePath + "/Cache";
-		const string resStr = to_string(tmd.m_resolutionSDF[0]) + "_" + to_string(tmd.m_resolutionSDF[1]) + "_" + to_string(tmd.m_resolutionSDF[2]);
-		const std::string modelFileName = FileSystem::getFileNameWithExt(tmd.m_modelFileVis);
-		const string sdfFileName = FileSystem::normalizePath(cachePath + "/" + modelFileName + "_" + resStr + ".csdf");
-
-		std::string sdfKey = tmd.m_collisionObjectFileName;
-		if (sdfKey == "")
-		{
-			sdfKey = sdfFileName;
-		}
-		if (distanceFields.find(sdfKey) == distanceFields.end())
+		// Generate SDF, the cache shares the fields of equal meshes and resolutions
+		if (tmd.m_collisionObjectType == SceneLoader::SDF)
 		{
-			// Generate SDF
-			if (tmd.m_collisionObjectType == SceneLoader::SDF)
-			{
-				VertexData &vd = objFiles[tmd.m_modelFileVis].first;
-				IndexedFaceMesh &mesh = objFiles[tmd.m_modelFileVis].second;
-
-				CubicSDFCollisionDetection::GridPtr distanceField = generateSDF(tmd.m_modelFileVis, tmd.m_collisionObjectFileName, tmd.m_resolutionSDF, vd, mesh);
-
-				if (tmd.m_collisionObjectFileName == "")
-					distanceFields[sdfFileName] = distanceField;
-				else
-					distanceFields[tmd.m_collisionObjectFileName] = distanceField;
-			}
+			VertexData &vd = objFiles[tmd.m_modelFileVis].first;
+			IndexedFaceMesh &mesh = objFiles[tmd.m_modelFileVis].second;
+			tetModelSDFs[i] = generateSDF(tmd.m_collisionObjectFileName, tmd.m_resolutionSDF, vd, mesh);
 		}
 	}
 
@@ -758,17 +599,7 @@ void readScene(const bool readFile)
 				break;
 			case SceneLoader::SDF:
 			{	
-				if (rbd.m_collisionObjectFileName == "")
-				{
-					const std::string basePath = FileSystem::getFilePath(base->getSceneFile());
-					const string cachePath = basePath + "/Cache";
-					const string resStr = to_string(rbd.m_resolutionSDF[0]) + "_" + to_string(rbd.m_resolutionSDF[1]) + "_" + to_string(rbd.m_resolutionSDF[2]);
-					const std::string modelFileName = FileSystem::getFileNameWithExt(rbd.m_modelFile);
-					const string sdfFileName = FileSystem::normalizePath(cachePath + "/" + modelFileName + "_" + resStr + ".csdf");
-					cd.addCubicSDFCollisionObject(i, CollisionDetection::CollisionObject::RigidBodyCollisionObjectType, &(*vertices)[0], nVert, distanceFields[sdfFileName], rbd.m_collisionObjectScale, rbd.m_testMesh, rbd.m_invertSDF);
-				}
-				else
-					cd.addCubicSDFCollisionObject(i, CollisionDetection::CollisionObject::RigidBodyCollisionObjectType, &(*vertices)[0], nVert, distanceFields[rbd.m_collisionObjectFileName], rbd.m_collisionObjectScale, rbd.m_testMesh, rbd.m_invertSDF);
+				cd.addCubicSDFCollisionObject(i, CollisionDetection::CollisionObject::RigidBodyCollisionObjectType, &(*vertices)[0], nVert, rigidBodySDFs[i], rbd.m_collisionObjectScale, rbd.m_testMesh, rbd.m_invertSDF);
 				break;
 			}
 		}
@@ -962,17 +793,7 @@ void readScene(const bool readFile)
 			break;
 		case SceneLoader::SDF:
 		{
-			if (tmd.m_collisionObjectFileName == "")
-			{
-				const std::string basePath = FileSystem::getFilePath(base->getSceneFile());
-				const string cachePath = basePath + "/Cache";
-				const string resStr = to_string(tmd.m_resolutionSDF[0]) + "_" + to_string(tmd.m_resolutionSDF[1]) + "_" + to_string(tmd.m_resolutionSDF[2]);
-				const std::string modelFileName = FileSystem::getFileNameWithExt(tmd.m_modelFileVis);
-				const string sdfFileName = FileSystem::normalizePath(cachePath + "/" + modelFileName + "_" + resStr + ".csdf");
-				cd.addCubicSDFCollisionObject(i, CollisionDetection::CollisionObject::TetModelCollisionObjectType, &pd.getPosition(offset), nVert, distanceFields[sdfFileName], tmd.m_collisionObjectScale, tmd.m_testMesh, tmd.m_invertSDF);
-			}
-			else
-				cd.addCubicSDFCollisionObject(i, CollisionDetection::CollisionObject::TetModelCollisionObjectType, &pd.getPosition(offset), nVert, distanceFields[tmd.m_collisionObjectFileName], tmd.m_collisionObjectScale, tmd.m_testMesh, tmd.m_invertSDF);
+			cd.addCubicSDFCollisionObject(i, CollisionDetection::CollisionObject::TetModelCollisionObjectType, &pd.getPosition(offset), nVert, tetModelSDFs[i], tmd.m_collisionObjectScale, tmd.m_testMesh, tmd.m_invertSDF);
 			break;
 		}
 		}
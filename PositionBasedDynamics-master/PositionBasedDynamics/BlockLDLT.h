@@ -0,0 +1,93 @@
+#ifndef BLOCK_LDLT_H
+#define BLOCK_LDLT_H
+
+#include "Common/Common.h"
+
+// ------------------------------------------------------------------------------------
+namespace PBD
+{
+	/** LDLT decomposition A = L D L^T of a small symmetric NxN matrix without pivoting.
+	 * The loops have compile-time bounds, so the compiler unrolls them and vectorizes the
+	 * solve over the columns of the right hand side. The decomposition requires that all
+	 * leading principal minors are non-zero, which holds for the definite diagonal blocks
+	 * of the direct rod solver.
+	 * The class provides the compute() and solve() methods of Eigen::LDLT, so both can be
+	 * exchanged.
+	 */
+	template <int N>
+	class BlockLDLT
+	{
+	public:
+		using MatrixType = Eigen::Matrix<Real, N, N>;
+
+	protected:
+		/** L (unit diagonal) is stored in the strict lower part and D on the diagonal */
+		MatrixType m_LD;
+
+	public:
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+		BlockLDLT() { m_LD.setIdentity(); }
+
+		const MatrixType &matrixLD() const { return m_LD; }
+
+		/** Decompose the symmetric matrix A. Only the lower triangle of A is read. */
+		FORCE_INLINE BlockLDLT &compute(const MatrixType &A)
+		{
+			for (int j = 0; j < N; j++)
+			{
+				// v_k = L(j,k) D(k)
+				Real v[N];
+				Real d = A(j, j);
+				for (int k = 0; k < j; k++)
+				{
+					v[k] = m_LD(j, k) * m_LD(k, k);
+					d -= m_LD(j, k) * v[k];
+				}
+				m_LD(j, j) = d;
+				const Real invD = (d != 0.0) ? static_cast<Real>(1.0) / d : static_cast<Real>(0.0);
+				for (int i = j + 1; i < N; i++)
+				{
+					Real l = A(i, j);
+					for (int k = 0; k < j; k++)
+						l -= m_LD(i, k) * v[k];
+					m_LD(i, j) = l * invD;
+				}
+			}
+			return *this;
+		}
+
+		/** Solve A X = B in place. */
+		template <int Cols>
+		FORCE_INLINE void solveInPlace(Eigen::Matrix<Real, N, Cols> &B) const
+		{
+			// L Y = B
+			for (int i = 1; i < N; i++)
+				for (int k = 0; k < i; k++)
+					B.row(i) -= m_LD(i, k) * B.row(k);
+			// D Z = Y
+			for (int i = 0; i < N; i++)
+			{
+				const Real d = m_LD(i, i);
+				if (d != 0.0)
+					B.row(i) /= d;
+				else
+					B.row(i).setZero();
+			}
+			// L^T X = Z
+			for (int i = N - 2; i >= 0; i--)
+				for (int k = i + 1; k < N; k++)
+					B.row(i) -= m_LD(k, i) * B.row(k);
+		}
+
+		template <int Cols>
+		FORCE_INLINE Eigen::Matrix<Real, N, Cols> solve(const Eigen::Matrix<Real, N, Cols> &B) const
+		{
+			Eigen::Matrix<Real, N, Cols> X(B);
+			solveInPlace(X);
+			return X;
+		}
+	};
+}
+
+#endif
@@ -5,6 +5,8 @@
 
 #define _USE_MATH_DEFINES
 #include "math.h"
+#include <algorithm>
+#include <map>
 
 using namespace PBD;
 
@@ -461,17 +463,23 @@ bool PositionBasedElasticRods::computeDarbouxGradient(
 // ----------------------------------------------------------------------------------------------
 
 
-void PBD::DirectPositionBasedSolverForStiffRods::initLists(int numberOfIntervals, std::list <Node*> * &forward, std::list <Node*> * &backward, Node* &root)
+void PBD::NodeArrays::clear()
 {
-	if (forward != NULL)
-		delete[] forward;
-	if (backward != NULL)
-		delete[] backward;
-	if (root != NULL)
-		delete[] root;
-	forward = new std::list<Node*>[numberOfIntervals];
-	backward = new std::list<Node*>[numberOfIntervals];
-	root = new Node[numberOfIntervals];
+	intervalStart.clear();
+	isconstraint.clear();
+	object.clear();
+	index.clear();
+	parent.clear();
+	childrenStart.clear();
+	children.clear();
+	D.clear();
+	J.clear();
+	DLDLT.clear();
+	soln.clear();
+	factorized.clear();
+	maxError.clear();
+	factorizedX.clear();
+	factorizedQ.clear();
 }
 
 bool PBD::DirectPositionBasedSolverForStiffRods::isSegmentInInterval(RodSegment *segment, int intervalIndex, Interval* intervals, std::vector<RodConstraint*> &rodConstraints, std::vector<RodSegment*> &rodSegments)
@@ -535,10 +543,6 @@ void PBD::DirectPositionBasedSolverForStiffRods::initSegmentNode(Node *n, int in
 			constraintNode->object = constraints[i];
 			constraintNode->isconstraint = true;
 			constraintNode->parent = n;
-			constraintNode->D.setZero();
-			constraintNode->Dinv.setZero();
-			constraintNode->J.setZero();
-			constraintNode->soln.setZero();
 
 			n->children.push_back(constraintNode);
 
@@ -558,11 +562,6 @@ void PBD::DirectPositionBasedSolverForStiffRods::initSegmentNode(Node *n, int in
 				segmentNode->index = constraints[i]->segmentIndex(0);
 			}
 
-			segmentNode->D.setZero();
-			segmentNode->Dinv.setZero();
-			segmentNode->J.setZero();
-			segmentNode->soln.setZero();
-
 			constraintNode->children.push_back(segmentNode);
 
 			// mark constraint
@@ -574,15 +573,48 @@ void PBD::DirectPositionBasedSolverForStiffRods::initSegmentNode(Node *n, int in
 	}
 }
 
-void PBD::DirectPositionBasedSolverForStiffRods::orderMatrix(Node *n, int intervalIndex, std::list <Node*> * forward, std::list <Node*> * backward)
+void PBD::DirectPositionBasedSolverForStiffRods::orderMatrix(Node *n, std::vector <Node*> &forward)
 {
 	for (unsigned int i = 0; i < n->children.size(); i++)
-		orderMatrix(n->children[i], intervalIndex, forward, backward);
-	forward[intervalIndex].push_back(n);
-	backward[intervalIndex].push_front(n);
+		orderMatrix(n->children[i], forward);
+	forward.push_back(n);
+}
+
+void PBD::DirectPositionBasedSolverForStiffRods::appendNodes(const std::vector <Node*> &forward, NodeArrays &nodes)
+{
+	const int offset = (int)nodes.size();
+	const int numNodes = (int)forward.size();
+	std::map<Node*, int> nodeIndex;
+	for (int i = 0; i < numNodes; i++)
+		nodeIndex[forward[i]] = offset + i;
+
+	for (int i = 0; i < numNodes; i++)
+	{
+		Node *node = forward[i];
+		nodes.isconstraint.push_back(node->isconstraint);
+		nodes.object.push_back(node->object);
+		nodes.index.push_back(node->index);
+		nodes.parent.push_back((node->parent != NULL) ? nodeIndex[node->parent] : -1);
+		nodes.childrenStart.push_back((int)nodes.children.size());
+		for (size_t j = 0; j < node->children.size(); j++)
+			nodes.children.push_back(nodeIndex[node->children[j]]);
+	}
+	nodes.D.resize(offset + numNodes, Matrix6r::Zero());
+	nodes.J.resize(offset + numNodes, Matrix6r::Zero());
+	nodes.DLDLT.resize(offset + numNodes);
+	nodes.soln.resize(offset + numNodes, Vector6r::Zero());
+	nodes.factorizedX.resize(offset + numNodes, Vector3r::Zero());
+	nodes.factorizedQ.resize(offset + numNodes, Vector4r::Zero());
+
+	// the root is owned by the caller
+	for (int i = 0; i < numNodes; i++)
+	{
+		if (forward[i]->parent != NULL)
+			delete forward[i];
+	}
 }
 
-void PBD::DirectPositionBasedSolverForStiffRods::initNodes(int intervalIndex, std::vector<RodSegment*> &rodSegments, Node* &root, Interval* intervals, std::vector<RodConstraint*> &rodConstraints, std::list <Node*> * forward, std::list <Node*> * backward, std::vector <RodConstraint*> &markedConstraints)
+void PBD::DirectPositionBasedSolverForStiffRods::initNodes(int intervalIndex, std::vector<RodSegment*> &rodSegments, Node &root, Interval* intervals, std::vector<RodConstraint*> &rodConstraints, NodeArrays &nodes, std::vector <RodConstraint*> &markedConstraints)
 {
 	// find root
 	for (int i = 0; i < (int)rodSegments.size(); i++)
@@ -592,46 +624,108 @@ void PBD::DirectPositionBasedSolverForStiffRods::initNodes(int intervalIndex, st
 			continue;
 		else
 		{
-			if (root[intervalIndex].object == NULL)
+			if (root.object == NULL)
 			{
-				root[intervalIndex].object = rb;
-				root[intervalIndex].index = i;
+				root.object = rb;
+				root.index = i;
 			}
 		}
 
 		if (!rb->isDynamic())
 		{
-			root[intervalIndex].object = rb;
-			root[intervalIndex].index = i;
+			root.object = rb;
+			root.index = i;
 			break;
 		}
 	}
-	root[intervalIndex].isconstraint = false;
-	root[intervalIndex].parent = NULL;
+	root.isconstraint = false;
+	root.parent = NULL;
 
-	root[intervalIndex].D.setZero();
-	root[intervalIndex].Dinv.setZero();
-	root[intervalIndex].soln.setZero();
-
-	initSegmentNode(&root[intervalIndex], intervalIndex, rodConstraints,
+	initSegmentNode(&root, intervalIndex, rodConstraints,
 		rodSegments, markedConstraints, intervals);
-	orderMatrix(&root[intervalIndex], intervalIndex, forward, backward);
+
+	std::vector<Node*> forward;
+	orderMatrix(&root, forward);
+	appendNodes(forward, nodes);
 }
 
-void PBD::DirectPositionBasedSolverForStiffRods::initTree(std::vector<RodConstraint*> &rodConstraints, std::vector<RodSegment*> & rodSegments, Interval* &intervals, int &numberOfIntervals, std::list <Node*> * &forward, std::list <Node*> * &backward, Node* &root)
+void PBD::DirectPositionBasedSolverForStiffRods::initTree(std::vector<RodConstraint*> &rodConstraints, std::vector<RodSegment*> & rodSegments, Interval* &intervals, int &numberOfIntervals, NodeArrays &nodes)
 {
-	numberOfIntervals = 1;
-	intervals = new Interval[1];
-	intervals[0].start = 0;
-	intervals[0].end = (int)rodConstraints.size() - 1;
-	initLists(numberOfIntervals, forward, backward, root);
+	// Determine the connected components of the constraint graph. Static segments do not
+	// connect constraints since their solution is zero. So each component is an independent 
+	// tree which is factorized and solved separately.
+	std::vector<int> componentOfSegment(rodSegments.size());
+	for (size_t i = 0; i < rodSegments.size(); i++)
+		componentOfSegment[i] = (int)i;
+	auto findComponent = [&componentOfSegment](int i)
+	{
+		while (componentOfSegment[i] != i)
+		{
+			componentOfSegment[i] = componentOfSegment[componentOfSegment[i]];
+			i = componentOfSegment[i];
+		}
+		return i;
+	};
+	for (size_t i = 0; i < rodConstraints.size(); i++)
+	{
+		const int s0 = (int)rodConstraints[i]->segmentIndex(0);
+		const int s1 = (int)rodConstraints[i]->segmentIndex(1);
+		if (rodSegments[s0]->isDynamic() && rodSegments[s1]->isDynamic())
+			componentOfSegment[findComponent(s0)] = findComponent(s1);
+	}
+
+	// The component of a constraint is the component of its dynamic segment(s).
+	std::vector<int> componentOfConstraint(rodConstraints.size());
+	for (size_t i = 0; i < rodConstraints.size(); i++)
+	{
+		const int s0 = (int)rodConstraints[i]->segmentIndex(0);
+		const int s1 = (int)rodConstraints[i]->segmentIndex(1);
+		componentOfConstraint[i] = rodSegments[s0]->isDynamic() ? findComponent(s0) : findComponent(s1);
+	}
+
+	// Sort the constraints by component so that each component is an interval of constraints. 
+	// The relative order of the constraints in a component is kept.
+	std::vector<unsigned int> order(rodConstraints.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = (unsigned int)i;
+	std::stable_sort(order.begin(), order.end(), [&componentOfConstraint](const unsigned int a, const unsigned int b) { return componentOfConstraint[a] < componentOfConstraint[b]; });
+	std::vector<RodConstraint*> sortedConstraints(rodConstraints.size());
+	for (size_t i = 0; i < order.size(); i++)
+		sortedConstraints[i] = rodConstraints[order[i]];
+	rodConstraints.swap(sortedConstraints);
+
+	std::vector<Interval> componentIntervals;
+	for (int i = 0; i < (int)order.size(); i++)
+	{
+		if ((i == 0) || (componentOfConstraint[order[i]] != componentOfConstraint[order[i - 1]]))
+		{
+			Interval interval;
+			interval.start = i;
+			componentIntervals.push_back(interval);
+		}
+		componentIntervals.back().end = i;
+	}
 
+	if (intervals != NULL)
+		delete[] intervals;
+	numberOfIntervals = (int)componentIntervals.size();
+	intervals = new Interval[std::max(numberOfIntervals, 1)];
+	for (int i = 0; i < numberOfIntervals; i++)
+		intervals[i] = componentIntervals[i];
+
+	nodes.clear();
 	std::vector <RodConstraint*> markedConstraints;
 	for (int i = 0; i < numberOfIntervals; i++)
 	{
-		initNodes(i, rodSegments, root, intervals, rodConstraints, forward, backward, markedConstraints);
+		nodes.intervalStart.push_back((int)nodes.size());
+		Node root;
+		initNodes(i, rodSegments, root, intervals, rodConstraints, nodes, markedConstraints);
 		markedConstraints.clear();
 	}
+	nodes.intervalStart.push_back((int)nodes.size());
+	nodes.childrenStart.push_back((int)nodes.children.size());
+	nodes.factorized.resize(numberOfIntervals, 0);
+	nodes.maxError.resize(numberOfIntervals, 0.0);
 }
 
 bool PBD::DirectPositionBasedSolverForStiffRods::computeDarbouxVector(const Quaternionr & q0, const Quaternionr & q1, const Real averageSegmentLength, Vector3r & darbouxVector)
@@ -732,12 +826,30 @@ void PBD::DirectPositionBasedSolverForStiffRods::getMassMatrix(RodSegment *segme
 		M(i, j) = inertia(i - 3, j - 3);
 }
 
-Real PBD::DirectPositionBasedSolverForStiffRods::factor(const int intervalIndex, const std::vector<RodConstraint*> &rodConstraints, std::vector<RodSegment*> & rodSegments, const Interval* &intervals, std::list <Node*> * forward, std::list <Node*> * backward, std::vector<Vector6r> & RHS, std::vector<Vector6r> & lambdaSums, std::vector<std::vector<Matrix3r>> & bendingAndTorsionJacobians)
+bool PBD::DirectPositionBasedSolverForStiffRods::requiresFactorization(const int intervalIndex, NodeArrays &nodes, const Real threshold)
+{
+	if (!nodes.factorized[intervalIndex])
+		return true;
+
+	for (int n = nodes.intervalStart[intervalIndex]; n < nodes.intervalStart[intervalIndex + 1]; n++)
+	{
+		if (nodes.isconstraint[n])
+			continue;
+		RodSegment *segment = (RodSegment*)nodes.object[n];
+		if ((segment->Position() - nodes.factorizedX[n]).lpNorm<Eigen::Infinity>() > threshold)
+			return true;
+		if ((segment->Rotation().coeffs() - nodes.factorizedQ[n]).lpNorm<Eigen::Infinity>() > threshold)
+			return true;
+	}
+	return false;
+}
+
+Real PBD::DirectPositionBasedSolverForStiffRods::factor(const bool factorize, const int intervalIndex, const std::vector<RodConstraint*> &rodConstraints, std::vector<RodSegment*> & rodSegments, const Interval* &intervals, NodeArrays &nodes, std::vector<Vector6r> & RHS, std::vector<Vector6r> & lambdaSums, std::vector<std::vector<Matrix3r>> & bendingAndTorsionJacobians)
 {
 	Real maxError(0.);
 	
-	// compute right hand side of linear equation system
-	for (size_t currentConstraintIndex = 0; currentConstraintIndex < rodConstraints.size(); ++currentConstraintIndex)
+	// compute right hand side of linear equation system for the constraints of the interval
+	for (int currentConstraintIndex = intervals[intervalIndex].start; currentConstraintIndex <= intervals[intervalIndex].end; ++currentConstraintIndex)
 	{
 		RodConstraint* currentConstraint = rodConstraints[currentConstraintIndex];
 
@@ -778,6 +890,10 @@ Real PBD::DirectPositionBasedSolverForStiffRods::factor(const int intervalIndex,
 			maxError = std::max(maxError, abs(rhs[i]));
 		}
 
+		// the Jacobians are only required for the system matrix
+		if (!factorize)
+			continue;
+
 		// Compute a part of the Jacobian here, because the relationship
 		// of the first and second segment to the constraint can be determined directly
 
@@ -794,40 +910,46 @@ Real PBD::DirectPositionBasedSolverForStiffRods::factor(const int intervalIndex,
 		bendingAndTorsionJacobians[currentConstraintIndex][1] = jOmega1*G1;
 	}
 
-	std::list<Node*>::iterator nodeIter;
-	for (nodeIter = forward[intervalIndex].begin(); nodeIter != forward[intervalIndex].end(); nodeIter++)
+	if (!factorize)
+		return maxError;
+
+	const int firstNode = nodes.intervalStart[intervalIndex];
+	const int endNode = nodes.intervalStart[intervalIndex + 1];
+	for (int n = firstNode; n < endNode; n++)
 	{
-		Node *node = *nodeIter;
+		Matrix6r &D = nodes.D[n];
+		Matrix6r &J = nodes.J[n];
+		const int parent = nodes.parent[n];
 		// compute system matrix diagonal
-		if (node->isconstraint)
+		if (nodes.isconstraint[n])
 		{
-			RodConstraint* currentConstraint = (RodConstraint*)node->object;
+			RodConstraint* currentConstraint = (RodConstraint*)nodes.object[n];
 			//insert compliance
-			node->D.setZero();
+			D.setZero();
 			const Vector3r &stretchCompliance(currentConstraint->getStretchCompliance());
 
-			node->D(0, 0) -= stretchCompliance[0];
-			node->D(1, 1) -= stretchCompliance[1];
-			node->D(2, 2) -= stretchCompliance[2];
+			D(0, 0) -= stretchCompliance[0];
+			D(1, 1) -= stretchCompliance[1];
+			D(2, 2) -= stretchCompliance[2];
 
 			const Vector3r &bendingAndTorsionCompliance(currentConstraint->getBendingAndTorsionCompliance());
-			node->D(3, 3) -= bendingAndTorsionCompliance[0];
-			node->D(4, 4) -= bendingAndTorsionCompliance[1];
-			node->D(5, 5) -= bendingAndTorsionCompliance[2];
+			D(3, 3) -= bendingAndTorsionCompliance[0];
+			D(4, 4) -= bendingAndTorsionCompliance[1];
+			D(5, 5) -= bendingAndTorsionCompliance[2];
 		}
 		else
 		{
-			getMassMatrix((RodSegment*)node->object, node->D);
+			getMassMatrix((RodSegment*)nodes.object[n], D);
 		}
 
 		// compute Jacobian
-		if (node->parent != NULL)
+		if (parent != -1)
 		{
-			if (node->isconstraint)
+			if (nodes.isconstraint[n])
 			{
 				//compute J 
-				RodConstraint *constraint = (RodConstraint*)node->object;
-				RodSegment *segment = (RodSegment*)node->parent->object;
+				RodConstraint *constraint = (RodConstraint*)nodes.object[n];
+				RodSegment *segment = (RodSegment*)nodes.object[parent];
 
 				Real sign = 1;
 				int segmentIndex = 0;
@@ -844,21 +966,21 @@ Real PBD::DirectPositionBasedSolverForStiffRods::factor(const int intervalIndex,
 				MathFunctions::crossProductMatrix(crossSign*r, r_cross);
 
 				Eigen::DiagonalMatrix<Real, 3> upperLeft(sign, sign, sign);
-				node->J.block<3, 3>(0, 0) = upperLeft;
+				J.block<3, 3>(0, 0) = upperLeft;
 
 				Matrix3r lowerLeft(Matrix3r::Zero());
-				node->J.block<3, 3>(3, 0) = lowerLeft;
+				J.block<3, 3>(3, 0) = lowerLeft;
 
-				node->J.block<3, 3>(0, 3) = r_cross;
+				J.block<3, 3>(0, 3) = r_cross;
 
-				Matrix3r &lowerRight(bendingAndTorsionJacobians[node->index][segmentIndex]);
-				node->J.block<3, 3>(3, 3) = lowerRight;
+				Matrix3r &lowerRight(bendingAndTorsionJacobians[nodes.index[n]][segmentIndex]);
+				J.block<3, 3>(3, 3) = lowerRight;
 			}
 			else
 			{
 				//compute JT
-				RodConstraint *constraint = (RodConstraint*)node->parent->object;
-				RodSegment *segment = (RodSegment*)node->object;
+				RodConstraint *constraint = (RodConstraint*)nodes.object[parent];
+				RodSegment *segment = (RodSegment*)nodes.object[n];
 
 				Real sign = 1;
 				int segmentIndex = 0;
@@ -874,133 +996,133 @@ Real PBD::DirectPositionBasedSolverForStiffRods::factor(const int intervalIndex,
 				MathFunctions::crossProductMatrix(sign*r, r_crossT);
 
 				Eigen::DiagonalMatrix<Real, 3> upperLeft(sign, sign, sign);
-				node->J.block<3, 3>(0, 0) = upperLeft;
+				J.block<3, 3>(0, 0) = upperLeft;
 
-				node->J.block<3, 3>(3, 0) = r_crossT;
+				J.block<3, 3>(3, 0) = r_crossT;
 
 				Matrix3r upperRight(Matrix3r::Zero());
-				node->J.block<3, 3>(0, 3) = upperRight;
+				J.block<3, 3>(0, 3) = upperRight;
 
-				Matrix3r lowerRight(bendingAndTorsionJacobians[node->parent->index][segmentIndex].transpose());
-				node->J.block<3, 3>(3, 3) = lowerRight;
+				Matrix3r lowerRight(bendingAndTorsionJacobians[nodes.index[parent]][segmentIndex].transpose());
+				J.block<3, 3>(3, 3) = lowerRight;
 			}
 		}
 	}
 
-	for (nodeIter = forward[intervalIndex].begin(); nodeIter != forward[intervalIndex].end(); nodeIter++)
+	for (int n = firstNode; n < endNode; n++)
 	{
-		Node *node = *nodeIter;
-		std::vector <Node*> children = node->children;
-		for (size_t i = 0; i < children.size(); i++)
+		Matrix6r &D = nodes.D[n];
+		for (int c = nodes.childrenStart[n]; c < nodes.childrenStart[n + 1]; c++)
 		{
-			Matrix6r JT = (children[i]->J).transpose();
-			Matrix6r &D = children[i]->D;
-			Matrix6r &J = children[i]->J;
-			Matrix6r JTDJ = ((JT * D) * J);
-			node->D = node->D - JTDJ;
+			const int child = nodes.children[c];
+			const Matrix6r &childJ = nodes.J[child];
+			D -= childJ.transpose() * nodes.D[child] * childJ;
 		}
 		bool chk = false;
-		if (!node->isconstraint)
+		if (!nodes.isconstraint[n])
 		{
-			RodSegment *segment = (RodSegment*)node->object;
+			RodSegment *segment = (RodSegment*)nodes.object[n];
 			if (!segment->isDynamic())
-			{
-				node->Dinv.setZero();
 				chk = true;
-			}
 		}
 
-		node->DLDLT.compute(node->D); // result reused in solve()
-		if (node->parent != NULL)
+		nodes.DLDLT[n].compute(D); // result reused in solve()
+		if (nodes.parent[n] != -1)
 		{
 			if (!chk)
 			{
-				node->J = node->DLDLT.solve(node->J);
+				nodes.J[n] = nodes.DLDLT[n].solve(nodes.J[n]);
 			}
 			else
 			{
-				node->J.setZero();
+				nodes.J[n].setZero();
 			}
 		}
+
+		// store the configuration of the factorization
+		if (!nodes.isconstraint[n])
+		{
+			RodSegment *segment = (RodSegment*)nodes.object[n];
+			nodes.factorizedX[n] = segment->Position();
+			nodes.factorizedQ[n] = segment->Rotation().coeffs();
+		}
 	}
+	nodes.factorized[intervalIndex] = 1;
 	return maxError;
 }
 
-bool PBD::DirectPositionBasedSolverForStiffRods::solve(int intervalIndex, std::list <Node*> * forward, std::list <Node*> * backward, std::vector<Vector6r> & RHS, std::vector<Vector6r> & lambdaSums, std::vector<Vector3r> & corr_x, std::vector<Quaternionr> & corr_q)
+bool PBD::DirectPositionBasedSolverForStiffRods::solve(int intervalIndex, NodeArrays &nodes, std::vector<Vector6r> & RHS, std::vector<Vector6r> & lambdaSums, std::vector<Vector3r> & corr_x, std::vector<Quaternionr> & corr_q)
 {
-	std::list<Node*>::iterator nodeIter;
-	for (nodeIter = forward[intervalIndex].begin(); nodeIter != forward[intervalIndex].end(); nodeIter++)
+	const int firstNode = nodes.intervalStart[intervalIndex];
+	const int endNode = nodes.intervalStart[intervalIndex + 1];
+	for (int n = firstNode; n < endNode; n++)
 	{
-		Node *node = *nodeIter;
-		if (node->isconstraint)
+		Vector6r &soln = nodes.soln[n];
+		if (nodes.isconstraint[n])
 		{
-			node->soln = -RHS[node->index];
+			soln = -RHS[nodes.index[n]];
 		}
 		else
 		{
-			node->soln.setZero();
+			soln.setZero();
 		}
-		std::vector <Node*> &children = node->children;
-		for (size_t i = 0; i < children.size(); ++i)
+		for (int c = nodes.childrenStart[n]; c < nodes.childrenStart[n + 1]; c++)
 		{
-			Matrix6r cJT = children[i]->J.transpose();
-			Vector6r &csoln = children[i]->soln;
-			Vector6r v = cJT * csoln;
-			node->soln = node->soln - v;
+			const int child = nodes.children[c];
+			soln -= nodes.J[child].transpose() * nodes.soln[child];
 		}
 	}
 
-	for (nodeIter = backward[intervalIndex].begin(); nodeIter != backward[intervalIndex].end(); nodeIter++)
+	for (int n = endNode - 1; n >= firstNode; n--)
 	{
-		Node *node = *nodeIter;
-
+		Vector6r &soln = nodes.soln[n];
 		bool noZeroDinv(true);
-		if (!node->isconstraint)
+		if (!nodes.isconstraint[n])
 		{
-			RodSegment *segment = (RodSegment*)node->object;
+			RodSegment *segment = (RodSegment*)nodes.object[n];
 			noZeroDinv = segment->isDynamic();
 		}
 		if (noZeroDinv) // if DInv == 0 child value is 0 and node->soln is not altered
 		{
-			node->soln = node->DLDLT.solve(node->soln);
+			soln = nodes.DLDLT[n].solve(soln);
 
-			if (node->parent != NULL)
+			if (nodes.parent[n] != -1)
 			{
-				node->soln -= node->J * node->parent->soln;
+				soln -= nodes.J[n] * nodes.soln[nodes.parent[n]];
 			}
 		}
 		else
 		{
-			node->soln.setZero(); // segment of node is not dynamic
+			soln.setZero(); // segment of node is not dynamic
 		}
 
-		if (node->isconstraint)
+		if (nodes.isconstraint[n])
 		{
-			lambdaSums[node->index] += node->soln;
+			lambdaSums[nodes.index[n]] += soln;
 		}
 	}
 
 	// compute position and orientation updates
-	for (nodeIter = forward[intervalIndex].begin(); nodeIter != forward[intervalIndex].end(); nodeIter++)
+	for (int n = firstNode; n < endNode; n++)
 	{
-		Node *node = *nodeIter;
-		if (!node->isconstraint)
+		if (!nodes.isconstraint[n])
 		{
-			RodSegment *segment = (RodSegment *)node->object;
+			RodSegment *segment = (RodSegment *)nodes.object[n];
+			// static segments can also occur inside a tree if it is fixed at several segments
 			if (!segment->isDynamic())
 			{
-				break;
+				continue;
 			}
 
-			const Vector6r & soln(node->soln);
+			const Vector6r & soln(nodes.soln[n]);
 			Vector3r deltaXSoln = Vector3r(-soln[0], -soln[1], -soln[2]);
-			corr_x[node->index] = deltaXSoln;
+			corr_x[nodes.index[n]] = deltaXSoln;
 
 			Eigen::Matrix<Real, 4, 3> G;
 			computeMatrixG(segment->Rotation(), G);
 			Quaternionr deltaQSoln;
 			deltaQSoln.coeffs() = G * Vector3r(-soln[3], -soln[4], -soln[5]);
-			corr_q[node->index] = deltaQSoln;
+			corr_q[nodes.index[n]] = deltaQSoln;
 		}
 	}
 	return true;
@@ -1011,9 +1133,7 @@ bool PBD::DirectPositionBasedSolverForStiffRods::init_DirectPositionBasedSolverF
 	std::vector<RodSegment*> & rodSegments, 
 	Interval* &intervals, 
 	int &numberOfIntervals, 
-	std::list <Node*> * &forward, 
-	std::list <Node*> * &backward, 
-	Node* &root, 
+	NodeArrays &nodes, 
 	const std::vector<Vector3r> &constraintPositions,
 	const std::vector<Real> &averageRadii,
 	const std::vector<Real> &youngsModuli,
@@ -1040,7 +1160,7 @@ bool PBD::DirectPositionBasedSolverForStiffRods::init_DirectPositionBasedSolverF
 	}
 	
 	// compute tree data structure for direct solver
-	initTree(rodConstraints, rodSegments, intervals, numberOfIntervals, forward, backward, root);
+	initTree(rodConstraints, rodSegments, intervals, numberOfIntervals, nodes);
 
 	RHS.resize(rodConstraints.size());
 	std::fill(RHS.begin(), RHS.end(), Vector6r::Zero());
@@ -1112,23 +1232,38 @@ bool PBD::DirectPositionBasedSolverForStiffRods::solve_DirectPositionBasedSolver
 	std::vector<RodSegment*> & rodSegments, 
 	const Interval* intervals, 
 	const int &numberOfIntervals, 
-	std::list <Node*> * forward, 
-	std::list <Node*> * backward, 
+	NodeArrays &nodes, 
 	std::vector<Vector6r> & RHS, 
 	std::vector<Vector6r> & lambdaSums, 
 	std::vector<std::vector<Matrix3r>> & bendingAndTorsionJacobians, 
 	std::vector<Vector3r> & corr_x, 
-	std::vector<Quaternionr> & corr_q
+	std::vector<Quaternionr> & corr_q,
+	const bool forceFactorization,
+	const Real refactorizationThreshold
 	)
 {
-	for (int i = 0; i < numberOfIntervals; i++)
+	// The intervals are independent trees which share no dynamic segment. Each interval only 
+	// writes the entries of its own constraints and segments, so they are solved in parallel.
+	#pragma omp parallel if(numberOfIntervals > 1) default(shared)
 	{
-		factor(i, rodConstraints, rodSegments, intervals,
-			forward, backward, RHS, lambdaSums, bendingAndTorsionJacobians);
-	}
-	for (int i = 0; i < numberOfIntervals; i++)
-	{
-		solve(i, forward, backward, RHS, lambdaSums, corr_x, corr_q);
+		#pragma omp for schedule(dynamic, 1)
+		for (int i = 0; i < numberOfIntervals; i++)
+		{
+			bool factorize = forceFactorization || requiresFactorization(i, nodes, refactorizationThreshold);
+			Real maxError = 0.0;
+			if (!factorize)
+			{
+				// the old factorization is only reused as long as the iteration converges
+				maxError = factor(false, i, rodConstraints, rodSegments, intervals,
+					nodes, RHS, lambdaSums, bendingAndTorsionJacobians);
+				factorize = (maxError > nodes.maxError[i]);
+			}
+			if (factorize)
+				maxError = factor(true, i, rodConstraints, rodSegments, intervals,
+					nodes, RHS, lambdaSums, bendingAndTorsionJacobians);
+			nodes.maxError[i] = maxError;
+			solve(i, nodes, RHS, lambdaSums, corr_x, corr_q);
+		}
 	}
 	return true;
 }
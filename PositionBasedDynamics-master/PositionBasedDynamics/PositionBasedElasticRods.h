@@ -4,9 +4,9 @@
 #include <Eigen/Dense>
 #include "Common/Common.h"
 #include "DirectPositionBasedSolverForStiffRodsInterface.h"
+#include "BlockLDLT.h"
 
 #include <vector>
-#include <list>
 
 // ------------------------------------------------------------------------------------
 namespace PBD
@@ -25,20 +25,59 @@ namespace PBD
 
 	using Matrix6r = Eigen::Matrix<Real, 6, 6>;
 	using Vector6r = Eigen::Matrix<Real, 6, 1>;
-	/** Node in the simulated tree structure */
+	using Alloc_Matrix6r = Eigen::aligned_allocator<Matrix6r>;
+	using Alloc_Vector6r = Eigen::aligned_allocator<Vector6r>;
+
+	/** Factorization of the 6x6 diagonal blocks of the direct rod solver */
+#ifdef USE_ROD_BLOCK_LDLT
+	using Matrix6rLDLT = BlockLDLT<6>;
+#else
+	using Matrix6rLDLT = Eigen::LDLT<Matrix6r>;
+#endif
+
+	/** Node in the simulated tree structure which is only used to build the tree */
 	struct Node {
 		Node() {
-			object = NULL; D = Dinv = J = Matrix6r::Zero(); parent = NULL;
-			soln.setZero(); index = 0;
+			object = NULL; parent = NULL; index = 0;
 		};
 		bool isconstraint;
 		void *object;
-		Matrix6r D, Dinv, J;
 		std::vector <Node*> children;
 		Node *parent;
-		Vector6r soln;
 		int index;
-		Eigen::LDLT<Matrix6r> DLDLT;
+	};
+
+	/** Nodes of the trees of all intervals stored in arrays in elimination order. 
+	 * The nodes of interval i have the indices intervalStart[i], ..., intervalStart[i+1]-1 and 
+	 * children occur before their parents. So the forward pass (from the leaves to the root) 
+	 * processes the nodes of an interval with increasing index and the backward pass with 
+	 * decreasing index. The matrices and factors are stored in separate arrays so that both 
+	 * passes stream linearly through memory.
+	 */
+	struct NodeArrays {
+		std::vector<int> intervalStart;
+		std::vector<unsigned char> isconstraint;
+		std::vector<void*> object;
+		std::vector<int> index;
+		/** index of the parent node, -1 for the root */
+		std::vector<int> parent;
+		/** the children of node i are children[childrenStart[i]], ..., children[childrenStart[i+1]-1] */
+		std::vector<int> childrenStart;
+		std::vector<int> children;
+		std::vector<Matrix6r, Alloc_Matrix6r> D;
+		std::vector<Matrix6r, Alloc_Matrix6r> J;
+		std::vector<Matrix6rLDLT, Eigen::aligned_allocator<Matrix6rLDLT>> DLDLT;
+		std::vector<Vector6r, Alloc_Vector6r> soln;
+		/** Flag for each interval whether it has a valid factorization */
+		std::vector<unsigned char> factorized;
+		/** Max. constraint violation of each interval in the last iteration */
+		std::vector<Real> maxError;
+		/** Position and rotation of the segment of each node at the time of the last factorization */
+		std::vector<Vector3r> factorizedX;
+		std::vector<Vector4r, Alloc_Vector4r> factorizedQ;
+
+		unsigned int size() const { return (unsigned int)index.size(); }
+		void clear();
 	};
 
 	struct Interval
@@ -51,12 +90,6 @@ namespace PBD
 	{
 	private:
 
-		static void initLists(
-			int numberOfIntervals,
-			std::list <Node*> * &forward,
-			std::list <Node*> * &backward,
-			Node* &root);
-
 		/** Returns, whether the passed segment is connected to a constraint in the
 		* passed index range of the entire constraints.
 		*/
@@ -92,9 +125,14 @@ namespace PBD
 		*/
 		static void orderMatrix(
 			Node *n,
-			int intervalIndex,
-			std::list <Node*> * forward,
-			std::list <Node*> * backward);
+			std::vector <Node*> &forward);
+
+		/** Appends the nodes of a tree in the passed order to the node arrays and deletes the nodes 
+		* except the root.
+		*/
+		static void appendNodes(
+			const std::vector <Node*> &forward,
+			NodeArrays &nodes);
 
 		/** Initializes the nodes.
 		* The first static node is selected as the root of the tree.
@@ -104,11 +142,10 @@ namespace PBD
 		static void initNodes(
 			int intervalIndex,
 			std::vector<RodSegment*> &rodSegments,
-			Node* &root,
+			Node &root,
 			Interval* intervals,
 			std::vector<RodConstraint*> &rodConstraints,
-			std::list <Node*> * forward,
-			std::list <Node*> * backward,
+			NodeArrays &nodes,
 			std::vector <RodConstraint*> &markedConstraints);
 
 
@@ -117,9 +154,7 @@ namespace PBD
 			std::vector<RodSegment*> & rodSegments,
 			Interval* &intervals,
 			int &numberOfIntervals,
-			std::list <Node*> * &forward,
-			std::list <Node*> * &backward,
-			Node* &root
+			NodeArrays &nodes
 			);
 
 
@@ -157,15 +192,24 @@ namespace PBD
 		*/
 		static void getMassMatrix(RodSegment *segment, Matrix6r &M);
 
+		/** Returns, whether a segment of the interval moved more than the threshold since the last 
+		* factorization. The position change and the change of the quaternion coefficients are tested.
+		*/
+		static bool requiresFactorization(
+			const int intervalIndex,
+			NodeArrays &nodes,
+			const Real threshold);
+
 		/** Factorizes matrix H and computes the right hand side vector -b.
+		* If factorize is false, only the right hand side is computed and the last factorization is reused.
 		*/
 		static Real factor(
+			const bool factorize,
 			const int intervalIndex,
 			const std::vector<RodConstraint*> &rodConstraints,
 			std::vector<RodSegment*> & rodSegments,
 			const Interval* &intervals,
-			std::list <Node*> * forward,
-			std::list <Node*> * backward,
+			NodeArrays &nodes,
 			std::vector<Vector6r> & RHS,
 			std::vector<Vector6r> & lambdaSums,
 			std::vector<std::vector<Matrix3r>> & bendingAndTorsionJacobians
@@ -176,8 +220,7 @@ namespace PBD
 		*/
 		static bool solve(
 			int intervalIndex,
-			std::list <Node*> * forward,
-			std::list <Node*> * backward,
+			NodeArrays &nodes,
 			std::vector<Vector6r> & RHS,
 			std::vector<Vector6r> & lambdaSums,
 			std::vector<Vector3r> & corr_x,
@@ -187,16 +230,14 @@ namespace PBD
 
 		///** Initialize the zero-stretch, bending, and torsion constraints of the rod.
 		//* Computes constraint connectors in segment space, computes the diagonal stiffness matrices
-		//* and the Darboux vectors of the initial state. Initializes the forward and backward lists
+		//* and the Darboux vectors of the initial state. Initializes the node arrays
 		//* of nodes  for the direct solver\n\n
 		//*
 		//* @param rodConstraints contains the combined zero-stretch, bending
 		//* and torsion constraints of the rod. The set of constraints must by acyclic.
 		//* @param rodSegments contains the segments of the rod
-		//* @param forward list of nodes in the acyclic tree of rod segments and zero-stretch,
-		//* bending and torsion constraints so that parent nodes occur later in the list than their children
-		//* @param backward list of nodes in the acyclic tree of rod segments and zero-stretch,
-		//* bending and torsion constraints. The reverse of the forward list.
+		//* @param nodes arrays of the nodes in the acyclic trees of rod segments and zero-stretch,
+		//* bending and torsion constraints so that parent nodes occur later in the arrays than their children
 		//* @param constraintPositions positions of the rod's constraints in world coordinates
 		//* @param averageRadii the average radii at the constraint positions of the rod. Value in Meters (m)
 		//* @param averageSegmentLengths vector of the average lengths of the two rod segments
@@ -223,9 +264,7 @@ namespace PBD
 			std::vector<RodSegment*> & rodSegments,
 			Interval* &intervals,
 			int &numberOfIntervals,
-			std::list <Node*> * &forward,
-			std::list <Node*> * &backward,
-			Node* &root,
+			NodeArrays &nodes,
 			const std::vector<Vector3r> &constraintPositions,
 			const std::vector<Real> &averageRadii,
 			const std::vector<Real> &youngsModuli,
@@ -265,8 +304,7 @@ namespace PBD
 		//*
 		//* @param rodConstraints contains the combined zero-stretch, bending and torsion constraints of the rod. The set of constraints must by acyclic.
 		//* @param rodSegments contains the segments of the rod
-		//* @param forward list of nodes in the acyclic tree of rod segments and zero-stretch, bending and torsion constraints so that parent nodes occur later in the list than their children
-		//* @param backward list of nodes in the acyclic tree of rod segments and zero-stretch, bending and torsion constraints. The reverse of the forward list.
+		//* @param nodes arrays of the nodes in the acyclic trees of rod segments and zero-stretch, bending and torsion constraints so that parent nodes occur later in the arrays than their children
 		//* @param RHS vector with entries for each constraint. In concatenation these entries represent the right hand side of the system of equations to be solved. (eq. 22 in the paper)
 		//* @param lambdaSums contains entries of the sum of all lambda updates for
 		//* each constraint in the rod during one time step which is needed by the solver to handle
@@ -277,19 +315,24 @@ namespace PBD
 		//* vector outside of the solve-method avoids repeated reallocation between iterations of the solver		
 		//* @param corr_x vector of position corrections for every segment of the rod (part of delta-x in eq. 22 in the paper)
 		//* @param corr_q vector of rotation corrections for every segment of the rod (part of delta-x in eq. 22 in the paper)
+		//* @param forceFactorization if this is false, the factorization of the last call is reused for intervals 
+		//* whose segments moved less than refactorizationThreshold since then. Only the right hand side is updated.
+		//* If the constraint violation of an interval increases, it is refactorized anyway.
+		//* @param refactorizationThreshold max. change of the segment positions and quaternion coefficients for reusing a factorization
 		//*/
 		static bool solve_DirectPositionBasedSolverForStiffRodsConstraint(
 			const std::vector<RodConstraint*> &rodConstraints,
 			std::vector<RodSegment*> & rodSegments,
 			const Interval* intervals,
 			const int &numberOfIntervals,
-			std::list <Node*> * forward,
-			std::list <Node*> * backward,
+			NodeArrays &nodes,
 			std::vector<Vector6r> & RHS,
 			std::vector<Vector6r> & lambdaSums,
 			std::vector<std::vector<Matrix3r>> & bendingAndTorsionJacobians,
 			std::vector<Vector3r> & corr_x,
-			std::vector<Quaternionr> & corr_q
+			std::vector<Quaternionr> & corr_q,
+			const bool forceFactorization = true,
+			const Real refactorizationThreshold = 0.0
 			);
 
 		///** Initialize the zero-stretch, bending, and torsion constraint.
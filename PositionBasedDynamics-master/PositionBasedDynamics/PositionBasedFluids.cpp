@@ -129,3 +129,241 @@ bool PositionBasedFluids::solveDensityConstraint(
 
 	return true;
 }
+
+// ----------------------------------------------------------------------------------------------
+bool PositionBasedFluids::computePBFDensity(
+	const unsigned int particleIndex,
+	const unsigned int numberOfParticles,
+	const Real mass[],
+	const Real boundaryPsi[],
+	const unsigned int numNeighbors,
+	const unsigned int neighbors[],
+	const Real W_zero,
+	const Real W[],
+	const Real density0,
+	const bool boundaryHandling,
+	Real &density_err,
+	Real &density)
+{
+	// Compute current density for particle i
+	density = mass[particleIndex] * W_zero;
+	for (unsigned int j = 0; j < numNeighbors; j++)
+	{
+		const unsigned int neighborIndex = neighbors[j];
+		if (neighborIndex < numberOfParticles)		// Test if fluid particle
+		{
+			density += mass[neighborIndex] * W[j];
+		}
+		else if (boundaryHandling)
+		{
+			// Boundary: Akinci2012
+			density += boundaryPsi[neighborIndex - numberOfParticles] * W[j];
+		}
+	}
+
+	density_err = std::max(density, density0) - density0;
+	return true;
+}
+
+// ----------------------------------------------------------------------------------------------
+bool PositionBasedFluids::computePBFLagrangeMultiplier(
+	const unsigned int numberOfParticles,
+	const Real mass[],
+	const Real boundaryPsi[],
+	const Real density,
+	const unsigned int numNeighbors,
+	const unsigned int neighbors[],
+	const Vector3r gradW[],
+	const Real density0,
+	const bool boundaryHandling,
+	Real &lambda)
+{
+	const Real eps = static_cast<Real>(1.0e-6);
+
+	// Evaluate constraint function
+	const Real C = std::max(density / density0 - static_cast<Real>(1.0), static_cast<Real>(0.0));			// clamp to prevent particle clumping at surface
+
+	if (C != 0.0)
+	{
+		// Compute gradients dC/dx_j 
+		Real sum_grad_C2 = 0.0;
+		Vector3r gradC_i(0.0, 0.0, 0.0);
+
+		for (unsigned int j = 0; j < numNeighbors; j++)
+		{
+			const unsigned int neighborIndex = neighbors[j];
+			if (neighborIndex < numberOfParticles)		// Test if fluid particle
+			{
+				const Vector3r gradC_j = -mass[neighborIndex] / density0 * gradW[j];
+				sum_grad_C2 += gradC_j.squaredNorm();
+				gradC_i -= gradC_j;
+			}
+			else if (boundaryHandling)
+			{
+				// Boundary: Akinci2012
+				const Vector3r gradC_j = -boundaryPsi[neighborIndex - numberOfParticles] / density0 * gradW[j];
+				sum_grad_C2 += gradC_j.squaredNorm();
+				gradC_i -= gradC_j;
+			}
+		}
+
+		sum_grad_C2 += gradC_i.squaredNorm();
+
+		// Compute lambda
+		lambda = -C / (sum_grad_C2 + eps);
+	}
+	else
+		lambda = 0.0;
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------------------------
+bool PositionBasedFluids::solveDensityConstraint(
+	const unsigned int particleIndex,
+	const unsigned int numberOfParticles,
+	const Real mass[],
+	const Real boundaryPsi[],
+	const unsigned int numNeighbors,
+	const unsigned int neighbors[],
+	const Vector3r gradW[],
+	const Real density0,
+	const bool boundaryHandling,
+	const Real lambda[],
+	Vector3r &corr)
+{
+	// Compute position correction
+	corr.setZero();
+	for (unsigned int j = 0; j < numNeighbors; j++)
+	{
+		const unsigned int neighborIndex = neighbors[j];
+		if (neighborIndex < numberOfParticles)		// Test if fluid particle
+		{
+			const Vector3r gradC_j = -mass[neighborIndex] / density0 * gradW[j];
+			corr -= (lambda[particleIndex] + lambda[neighborIndex]) * gradC_j;
+		}
+		else if (boundaryHandling)
+		{
+			// Boundary: Akinci2012
+			const Vector3r gradC_j = -boundaryPsi[neighborIndex - numberOfParticles] / density0 * gradW[j];
+			corr -= (lambda[particleIndex]) * gradC_j;
+		}
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------------------------
+void PositionBasedFluids::computeVorticity(
+	const unsigned int particleIndex,
+	const unsigned int numberOfParticles,
+	const Vector3r v[],
+	const Real mass[],
+	const Real density[],
+	const unsigned int numNeighbors,
+	const unsigned int neighbors[],
+	const Vector3r gradW[],
+	Vector3r &vorticity)
+{
+	vorticity.setZero();
+	const Vector3r &vi = v[particleIndex];
+	for (unsigned int j = 0; j < numNeighbors; j++)
+	{
+		const unsigned int neighborIndex = neighbors[j];
+		if (neighborIndex < numberOfParticles)		// Test if fluid particle
+			vorticity += (mass[neighborIndex] / density[neighborIndex]) * (v[neighborIndex] - vi).cross(gradW[j]);
+	}
+}
+
+// ----------------------------------------------------------------------------------------------
+void PositionBasedFluids::computeVorticityConfinement(
+	const unsigned int particleIndex,
+	const unsigned int numberOfParticles,
+	const Real mass[],
+	const Real density[],
+	const Vector3r vorticity[],
+	const unsigned int numNeighbors,
+	const unsigned int neighbors[],
+	const Vector3r gradW[],
+	const Real epsilon,
+	Vector3r &accel)
+{
+	accel.setZero();
+	Vector3r eta;
+	eta.setZero();
+	for (unsigned int j = 0; j < numNeighbors; j++)
+	{
+		const unsigned int neighborIndex = neighbors[j];
+		if (neighborIndex < numberOfParticles)		// Test if fluid particle
+			eta += (mass[neighborIndex] / density[neighborIndex]) * vorticity[neighborIndex].norm() * gradW[j];
+	}
+
+	const Real etaNorm = eta.norm();
+	if (etaNorm > static_cast<Real>(1.0e-6))
+		accel = epsilon * (eta * (static_cast<Real>(1.0) / etaNorm)).cross(vorticity[particleIndex]);
+}
+
+// ----------------------------------------------------------------------------------------------
+void PositionBasedFluids::computeSurfaceNormal(
+	const unsigned int numberOfParticles,
+	const Real mass[],
+	const Real density[],
+	const unsigned int numNeighbors,
+	const unsigned int neighbors[],
+	const Vector3r gradW[],
+	const Real supportRadius,
+	Vector3r &normal)
+{
+	normal.setZero();
+	for (unsigned int j = 0; j < numNeighbors; j++)
+	{
+		const unsigned int neighborIndex = neighbors[j];
+		if (neighborIndex < numberOfParticles)		// Test if fluid particle
+			normal += (mass[neighborIndex] / density[neighborIndex]) * gradW[j];
+	}
+	normal *= supportRadius;
+}
+
+// ----------------------------------------------------------------------------------------------
+void PositionBasedFluids::computeSurfaceTension(
+	const unsigned int particleIndex,
+	const unsigned int numberOfParticles,
+	const Vector3r x[],
+	const Real mass[],
+	const Real density[],
+	const Vector3r normal[],
+	const unsigned int numNeighbors,
+	const unsigned int neighbors[],
+	const Real density0,
+	const Real gamma,
+	Vector3r &accel)
+{
+	accel.setZero();
+	const Vector3r &xi = x[particleIndex];
+	const Real density_i = density[particleIndex];
+	for (unsigned int j = 0; j < numNeighbors; j++)
+	{
+		const unsigned int neighborIndex = neighbors[j];
+		if (neighborIndex < numberOfParticles)		// Test if fluid particle
+		{
+			// correction factor which amplifies the forces at the surface where the density is low
+			const Real K_ij = static_cast<Real>(2.0)*density0 / (density_i + density[neighborIndex]);
+
+			// cohesion
+			const Vector3r xij = xi - x[neighborIndex];
+			const Real length2 = xij.squaredNorm();
+			Vector3r accel_j;
+			accel_j.setZero();
+			if (length2 > static_cast<Real>(1.0e-12))
+			{
+				const Real length = sqrt(length2);
+				accel_j -= gamma * mass[neighborIndex] * (xij * (static_cast<Real>(1.0) / length)) * CohesionKernel::W(length);
+			}
+
+			// curvature
+			accel_j -= gamma * (normal[particleIndex] - normal[neighborIndex]);
+
+			accel += K_ij * accel_j;
+		}
+	}
+}
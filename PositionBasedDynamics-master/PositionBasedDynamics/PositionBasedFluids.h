@@ -136,6 +136,116 @@ namespace PBD
 			const bool boundaryHandling,					// perform boundary handling (Akinci2012)
 			const Real lambda[],							// Lagrange multiplier
 			Vector3r &corr);							// returns the position correction for the current fluid particle
+
+		/** Variants of the functions above which get the kernel values W and the kernel gradients gradW
+		* of all neighbors instead of the positions. This allows to evaluate the kernel by a 
+		* tabulated or vectorized kernel and to reuse the values in several solver passes.
+		*
+		* @param W_zero kernel value for a zero distance 
+		* @param W array with the kernel values of all neighbors
+		* @param gradW array with the kernel gradients of all neighbors
+		*/
+		static bool computePBFDensity(
+			const unsigned int particleIndex,				// current fluid particle	
+			const unsigned int numberOfParticles,			// number of fluid particles 
+			const Real mass[],								// array of all particle masses
+			const Real boundaryPsi[],						// array of all boundary psi values (Akinci2012)
+			const unsigned int numNeighbors,				// number of neighbors 
+			const unsigned int neighbors[],					// array with indices of all neighbors (indices larger than numberOfParticles are boundary particles)
+			const Real W_zero,								// kernel value for a zero distance
+			const Real W[],									// kernel values of all neighbors
+			const Real density0,							// rest density
+			const bool boundaryHandling,					// perform boundary handling (Akinci2012)
+			Real &density_err,								// returns the clamped density error (can be used for enforcing a maximal global density error)
+			Real &density);								// return the density
+
+		static bool computePBFLagrangeMultiplier(
+			const unsigned int numberOfParticles,			// number of fluid particles 
+			const Real mass[],								// array of all particle masses
+			const Real boundaryPsi[],						// array of all boundary psi values (Akinci2012)
+			const Real density,							// density of current fluid particle
+			const unsigned int numNeighbors,				// number of neighbors 
+			const unsigned int neighbors[],					// array with indices of all neighbors
+			const Vector3r gradW[],						// kernel gradients of all neighbors
+			const Real density0,							// rest density
+			const bool boundaryHandling,					// perform boundary handling (Akinci2012)
+			Real &lambda);									// returns the Lagrange multiplier
+
+		static bool solveDensityConstraint(
+			const unsigned int particleIndex,				// current fluid particle	
+			const unsigned int numberOfParticles,			// number of fluid particles 
+			const Real mass[],								// array of all particle masses
+			const Real boundaryPsi[],						// array of all boundary psi values (Akinci2012)
+			const unsigned int numNeighbors,				// number of neighbors 
+			const unsigned int neighbors[],					// array with indices of all neighbors
+			const Vector3r gradW[],						// kernel gradients of all neighbors
+			const Real density0,							// rest density
+			const bool boundaryHandling,					// perform boundary handling (Akinci2012)
+			const Real lambda[],							// Lagrange multiplier
+			Vector3r &corr);							// returns the position correction for the current fluid particle
+
+		// -------------- Vorticity confinement and surface tension  -----------------------------------------------------
+
+		/** Compute the vorticity of a fluid particle:\n\n
+		* \f$\omega_i = \sum_j \frac{m_j}{\rho_j} (\mathbf v_j - \mathbf v_i) \times \nabla W_{ij}\f$\n\n
+		* Boundary neighbors are ignored.
+		*/
+		static void computeVorticity(
+			const unsigned int particleIndex,				// current fluid particle	
+			const unsigned int numberOfParticles,			// number of fluid particles 
+			const Vector3r v[],							// array of all particle velocities
+			const Real mass[],								// array of all particle masses
+			const Real density[],							// array of all particle densities
+			const unsigned int numNeighbors,				// number of neighbors 
+			const unsigned int neighbors[],					// array with indices of all neighbors
+			const Vector3r gradW[],						// kernel gradients of all neighbors
+			Vector3r &vorticity);							// returns the vorticity
+
+		/** Compute the acceleration of the vorticity confinement of Macklin and Mueller 2013,
+		* "Position based fluids":\n\n
+		* \f$\eta = \sum_j \frac{m_j}{\rho_j} |\omega_j| \nabla W_{ij}, \quad \mathbf a_i = \epsilon \left(\frac{\eta}{|\eta|} \times \omega_i\right)\f$
+		*/
+		static void computeVorticityConfinement(
+			const unsigned int particleIndex,				// current fluid particle	
+			const unsigned int numberOfParticles,			// number of fluid particles 
+			const Real mass[],								// array of all particle masses
+			const Real density[],							// array of all particle densities
+			const Vector3r vorticity[],					// array of all particle vorticities
+			const unsigned int numNeighbors,				// number of neighbors 
+			const unsigned int neighbors[],					// array with indices of all neighbors
+			const Vector3r gradW[],						// kernel gradients of all neighbors
+			const Real epsilon,								// vorticity confinement coefficient
+			Vector3r &accel);								// returns the acceleration
+
+		/** Compute the surface normal of a fluid particle (Akinci et al. 2013):\n\n
+		* \f$\mathbf n_i = h \sum_j \frac{m_j}{\rho_j} \nabla W_{ij}\f$
+		*/
+		static void computeSurfaceNormal(
+			const unsigned int numberOfParticles,			// number of fluid particles 
+			const Real mass[],								// array of all particle masses
+			const Real density[],							// array of all particle densities
+			const unsigned int numNeighbors,				// number of neighbors 
+			const unsigned int neighbors[],					// array with indices of all neighbors
+			const Vector3r gradW[],						// kernel gradients of all neighbors
+			const Real supportRadius,						// kernel support radius
+			Vector3r &normal);								// returns the surface normal
+
+		/** Compute the acceleration due to cohesion and curvature minimization of Akinci et al. 2013,
+		* "Versatile surface tension and adhesion for SPH fluids". The cohesion kernel must be 
+		* initialized with the support radius.
+		*/
+		static void computeSurfaceTension(
+			const unsigned int particleIndex,				// current fluid particle	
+			const unsigned int numberOfParticles,			// number of fluid particles 
+			const Vector3r x[],							// array of all particle positions
+			const Real mass[],								// array of all particle masses
+			const Real density[],							// array of all particle densities
+			const Vector3r normal[],						// array of all particle surface normals
+			const unsigned int numNeighbors,				// number of neighbors 
+			const unsigned int neighbors[],					// array with indices of all neighbors
+			const Real density0,							// rest density
+			const Real gamma,								// surface tension coefficient
+			Vector3r &accel);								// returns the acceleration
 	};
 }
 
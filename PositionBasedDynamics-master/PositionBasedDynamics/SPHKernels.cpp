@@ -6,3 +6,14 @@ Real CubicKernel::m_radius;
 Real CubicKernel::m_k;
 Real CubicKernel::m_l;
 Real CubicKernel::m_W_zero;
+
+Real CohesionKernel::m_radius;
+Real CohesionKernel::m_k;
+Real CohesionKernel::m_c;
+
+Real PrecomputedCubicKernel::m_W[PrecomputedCubicKernel::m_resolution + 2];
+Real PrecomputedCubicKernel::m_gradW[PrecomputedCubicKernel::m_resolution + 2];
+Real PrecomputedCubicKernel::m_radius;
+Real PrecomputedCubicKernel::m_radius2;
+Real PrecomputedCubicKernel::m_invStepSize;
+Real PrecomputedCubicKernel::m_W_zero;
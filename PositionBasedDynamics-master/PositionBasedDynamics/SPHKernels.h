@@ -91,6 +91,181 @@ namespace PBD
 		{
 			return m_W_zero;
 		}
+
+		/** Evaluate the kernel for the given support radius. The radius of the kernel is not changed. */
+		static Real W(const Vector3r &r, const Real radius)
+		{
+			static const Real pi = static_cast<Real>(M_PI);
+			const Real k = static_cast<Real>(8.0) / (pi*radius*radius*radius);
+			const Real q = r.norm() / radius;
+			if (q <= 0.5)
+			{
+				const Real q2 = q*q;
+				return k * (static_cast<Real>(6.0)*q2*q - static_cast<Real>(6.0)*q2 + static_cast<Real>(1.0));
+			}
+			else if (q <= 1.0)
+				return k * (static_cast<Real>(2.0)*pow(static_cast<Real>(1.0) - q, 3));
+			return 0.0;
+		}
+
+		/** Evaluate the kernel and its gradient for the vectors xi-xj[j] of a neighbor list. 
+		 * The neighbors are processed in blocks which are stored as structure of arrays and
+		 * the evaluation is free of branches, so that the inner loops are vectorized by the compiler.
+		 */
+		static void batchW(const Vector3r &xi, const unsigned int n, const Vector3r xj[], Real W[], Vector3r gradW[])
+		{
+			const unsigned int blockSize = 8;
+			Real rx[blockSize], ry[blockSize], rz[blockSize], w[blockSize], g[blockSize];
+			const Real invRadius = static_cast<Real>(1.0) / m_radius;
+			for (unsigned int start = 0; start < n; start += blockSize)
+			{
+				const unsigned int count = std::min(blockSize, n - start);
+				for (unsigned int j = 0; j < count; j++)
+				{
+					rx[j] = xi[0] - xj[start + j][0];
+					ry[j] = xi[1] - xj[start + j][1];
+					rz[j] = xi[2] - xj[start + j][2];
+				}
+				for (unsigned int j = count; j < blockSize; j++)
+					rx[j] = ry[j] = rz[j] = 0.0;
+
+				for (unsigned int j = 0; j < blockSize; j++)
+				{
+					const Real rl = sqrt(rx[j] * rx[j] + ry[j] * ry[j] + rz[j] * rz[j]);
+					const Real q = std::min(rl * invRadius, static_cast<Real>(1.0));
+					const Real q2 = q*q;
+					const Real factor = static_cast<Real>(1.0) - q;
+					const bool inner = q <= 0.5;
+					w[j] = inner ? m_k * (static_cast<Real>(6.0)*q2*q - static_cast<Real>(6.0)*q2 + static_cast<Real>(1.0)) : 
+						m_k * (static_cast<Real>(2.0)*factor*factor*factor);
+					// gradient = g * r
+					const Real invRl = (rl > 1.0e-6) ? static_cast<Real>(1.0) / (rl * m_radius) : static_cast<Real>(0.0);
+					g[j] = (inner ? m_l*q*(static_cast<Real>(3.0)*q - static_cast<Real>(2.0)) : -m_l*factor*factor) * invRl;
+				}
+
+				for (unsigned int j = 0; j < count; j++)
+				{
+					W[start + j] = w[j];
+					gradW[start + j] = Vector3r(g[j] * rx[j], g[j] * ry[j], g[j] * rz[j]);
+				}
+			}
+		}
+	};
+
+	/** Cubic spline kernel which is tabulated over the squared distance, so that
+	 * an evaluation requires no square root. The table is linearly interpolated.
+	 */
+	class PrecomputedCubicKernel
+	{
+	protected:
+		static const unsigned int m_resolution = 10000;
+		static Real m_W[m_resolution + 2];
+		/** Factor g(|r|) of the gradient gradW = g(|r|) r */
+		static Real m_gradW[m_resolution + 2];
+		static Real m_radius;
+		static Real m_radius2;
+		static Real m_invStepSize;
+		static Real m_W_zero;
+
+	public:
+		static Real getRadius() { return m_radius; }
+		static void setRadius(Real val)
+		{
+			m_radius = val;
+			m_radius2 = val*val;
+			const Real stepSize = m_radius2 / (Real)m_resolution;
+			m_invStepSize = static_cast<Real>(1.0) / stepSize;
+
+			// the table is filled with the cubic spline kernel of the given radius, the radius
+			// of CubicKernel is not changed
+			static const Real pi = static_cast<Real>(M_PI);
+			const Real k = static_cast<Real>(8.0) / (pi*m_radius2*m_radius);
+			const Real l = static_cast<Real>(48.0) / (pi*m_radius2*m_radius);
+			for (unsigned int i = 0; i <= m_resolution; i++)
+			{
+				const Real rl = sqrt((Real)i * stepSize);
+				const Real q = rl / m_radius;
+				if (q <= 0.5)
+				{
+					m_W[i] = k * (static_cast<Real>(6.0)*q*q*q - static_cast<Real>(6.0)*q*q + static_cast<Real>(1.0));
+					// l*q*(3q-2)/(|r|*radius) = l*(3q-2)/radius^2, so r = 0 needs no special case
+					m_gradW[i] = l * (static_cast<Real>(3.0)*q - static_cast<Real>(2.0)) / m_radius2;
+				}
+				else
+				{
+					const Real factor = static_cast<Real>(1.0) - q;
+					m_W[i] = k * (static_cast<Real>(2.0)*factor*factor*factor);
+					m_gradW[i] = -l * factor*factor / (rl*m_radius);
+				}
+			}
+			m_W[m_resolution] = 0.0;
+			m_gradW[m_resolution] = 0.0;
+			m_W[m_resolution + 1] = 0.0;
+			m_gradW[m_resolution + 1] = 0.0;
+			m_W_zero = m_W[0];
+		}
+
+		static Real W(const Vector3r &r)
+		{
+			const Real r2 = r.squaredNorm();
+			if (r2 >= m_radius2)
+				return 0.0;
+			const Real pos = r2 * m_invStepSize;
+			const unsigned int index = (unsigned int)pos;
+			const Real t = pos - (Real)index;
+			return m_W[index] + t * (m_W[index + 1] - m_W[index]);
+		}
+
+		static Vector3r gradW(const Vector3r &r)
+		{
+			const Real r2 = r.squaredNorm();
+			if (r2 >= m_radius2)
+				return Vector3r::Zero();
+			const Real pos = r2 * m_invStepSize;
+			const unsigned int index = (unsigned int)pos;
+			const Real t = pos - (Real)index;
+			return (m_gradW[index] + t * (m_gradW[index + 1] - m_gradW[index])) * r;
+		}
+
+		static Real W_zero()
+		{
+			return m_W_zero;
+		}
+	};
+
+	/** Cohesion kernel for the surface tension model of Akinci et al. 2013,
+	 * "Versatile surface tension and adhesion for SPH fluids".
+	 */
+	class CohesionKernel
+	{
+	protected:
+		static Real m_radius;
+		static Real m_k;
+		static Real m_c;
+	public:
+		static Real getRadius() { return m_radius; }
+		static void setRadius(Real val)
+		{
+			m_radius = val;
+			static const Real pi = static_cast<Real>(M_PI);
+			m_k = static_cast<Real>(32.0) / (pi*pow(m_radius, 9));
+			m_c = pow(m_radius, 6) / static_cast<Real>(64.0);
+		}
+
+		/** Kernel value for the distance r */
+		static Real W(const Real r)
+		{
+			Real res = 0.0;
+			if (r <= m_radius)
+			{
+				const Real factor = (m_radius - r)*(m_radius - r)*(m_radius - r)*r*r*r;
+				if (r > static_cast<Real>(0.5)*m_radius)
+					res = m_k*factor;
+				else
+					res = m_k*(static_cast<Real>(2.0)*factor - m_c);
+			}
+			return res;
+		}
 	};
 }
 
@@ -0,0 +1,79 @@
+#include "AdaptiveTimeStep.h"
+#include "Simulation/SimulationModel.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace PBD;
+
+AdaptiveTimeStep::AdaptiveTimeStep(const Real cflFactor, const Real minTimeStepSize, const Real maxTimeStepSize, const unsigned int maxSubsteps)
+{
+	m_cflFactor = cflFactor;
+	m_minTimeStepSize = minTimeStepSize;
+	m_maxTimeStepSize = maxTimeStepSize;
+	m_maxSubsteps = maxSubsteps;
+}
+
+AdaptiveTimeStep::~AdaptiveTimeStep()
+{
+}
+
+Real AdaptiveTimeStep::maxParticleVelocity(ParticleData &pd, const Real h)
+{
+	const unsigned int numParticles = pd.size();
+	Real maxVel = 0.0;
+	#pragma omp parallel if(numParticles > MIN_PARALLEL_SIZE) default(shared)
+	{
+		// maximum of each thread
+		Real maxVel_local = 0.0;
+		#pragma omp for schedule(static) nowait
+		for (int i = 0; i < (int)numParticles; i++)
+		{
+			if (pd.getMass(i) == 0.0)
+				continue;
+			const Real velMag = (pd.getVelocity(i) + pd.getAcceleration(i)*h).squaredNorm();
+			if (velMag > maxVel_local)
+				maxVel_local = velMag;
+		}
+		#pragma omp critical
+		{
+			if (maxVel_local > maxVel)
+				maxVel = maxVel_local;
+		}
+	}
+	return sqrt(maxVel);
+}
+
+Real AdaptiveTimeStep::maxRigidBodyVelocity(SimulationModel &model)
+{
+	SimulationModel::RigidBodyVector &rb = model.getRigidBodies();
+	const unsigned int numBodies = (unsigned int)rb.size();
+
+	// the radius is updated by the geometry whenever its local vertices change
+	Real maxVel = 0.0;
+	for (unsigned int i = 0; i < numBodies; i++)
+	{
+		if ((rb[i]->getMass() == 0.0) || rb[i]->isSleeping())
+			continue;
+		const Real vel = rb[i]->getVelocity().norm() + rb[i]->getAngularVelocity().norm() * rb[i]->getGeometry().getLocalRadius();
+		maxVel = std::max(maxVel, vel);
+	}
+	return maxVel;
+}
+
+Real AdaptiveTimeStep::computeTimeStepSize(const Real maxVelocity, const Real lengthScale) const
+{
+	Real h = m_maxTimeStepSize;
+	if (maxVelocity > 0.0)
+		h = m_cflFactor * lengthScale / maxVelocity;
+	h = std::min(h, m_maxTimeStepSize);
+	h = std::max(h, m_minTimeStepSize);
+	return h;
+}
+
+unsigned int AdaptiveTimeStep::computeNumSubsteps(const Real h, const Real maxVelocity, const Real lengthScale) const
+{
+	const Real hSub = computeTimeStepSize(maxVelocity, lengthScale);
+	unsigned int n = (unsigned int) std::ceil(h / hSub - static_cast<Real>(1.0e-6));
+	n = std::max(n, 1u);
+	return std::min(n, std::max(m_maxSubsteps, 1u));
+}
@@ -0,0 +1,58 @@
+#ifndef __ADAPTIVETIMESTEP_H__
+#define __ADAPTIVETIMESTEP_H__
+
+#include "Common/Common.h"
+#include "Simulation/ParticleData.h"
+
+namespace PBD
+{
+	class SimulationModel;
+
+	/** Time step size control by the Courant-Friedrichs-Lewy (CFL) condition.
+	 *
+	 * The time step size is chosen so that no particle or rigid body vertex moves further than
+	 * cflFactor * lengthScale in one step. The same controller is used by the solid and the fluid
+	 * time step methods. In a coupled scene the global step size of the TimeManager is determined
+	 * by the slower subsystem and a faster subsystem takes several substeps of equal size within
+	 * this step (multi-rate stepping). So all subsystems end at the same time.
+	 */
+	class AdaptiveTimeStep
+	{
+	protected:
+		Real m_cflFactor;
+		Real m_minTimeStepSize;
+		Real m_maxTimeStepSize;
+		unsigned int m_maxSubsteps;
+
+	public:
+		AdaptiveTimeStep(const Real cflFactor = 0.5, const Real minTimeStepSize = 0.0001, const Real maxTimeStepSize = 0.005, const unsigned int maxSubsteps = 10u);
+		~AdaptiveTimeStep();
+
+		Real getCFLFactor() const { return m_cflFactor; }
+		void setCFLFactor(const Real val) { m_cflFactor = val; }
+		Real getMinTimeStepSize() const { return m_minTimeStepSize; }
+		void setMinTimeStepSize(const Real val) { m_minTimeStepSize = val; }
+		Real getMaxTimeStepSize() const { return m_maxTimeStepSize; }
+		void setMaxTimeStepSize(const Real val) { m_maxTimeStepSize = val; }
+		unsigned int getMaxSubsteps() const { return m_maxSubsteps; }
+		void setMaxSubsteps(const unsigned int val) { m_maxSubsteps = val; }
+
+		/** Return the maximum of |v + a h| of the particles. */
+		static Real maxParticleVelocity(ParticleData &pd, const Real h);
+		/** Return an upper bound for the velocity of the vertices of the dynamic rigid bodies
+		 * which are awake: |v| + |omega| r, where r is the radius of the body.
+		 */
+		static Real maxRigidBodyVelocity(SimulationModel &model);
+
+		/** Return the time step size cflFactor * lengthScale / maxVelocity clamped to
+		 * [minTimeStepSize, maxTimeStepSize].
+		 */
+		Real computeTimeStepSize(const Real maxVelocity, const Real lengthScale) const;
+		/** Return the number of substeps which a subsystem with the given max. velocity requires
+		 * to advance by the time step size h. The number is limited by maxSubsteps.
+		 */
+		unsigned int computeNumSubsteps(const Real h, const Real maxVelocity, const Real lengthScale) const;
+	};
+}
+
+#endif
@@ -0,0 +1,306 @@
+#include "ArticulatedBodySolver.h"
+#include "Simulation/SimulationModel.h"
+#include "Simulation/Constraints.h"
+
+using namespace PBD;
+
+ArticulatedBodySolver::ArticulatedBodySolver()
+{
+	m_numConstraints = 0;
+}
+
+ArticulatedBodySolver::~ArticulatedBodySolver()
+{
+}
+
+void ArticulatedBodySolver::reset()
+{
+	m_joints.clear();
+	m_nodes.clear();
+	m_trees.clear();
+	m_isHandled.clear();
+	m_numConstraints = 0;
+}
+
+void ArticulatedBodySolver::init(SimulationModel &model)
+{
+	reset();
+
+	SimulationModel::RigidBodyVector &rb = model.getRigidBodies();
+	SimulationModel::ConstraintVector &constraints = model.getConstraints();
+	const unsigned int numBodies = (unsigned int)rb.size();
+	m_numConstraints = (unsigned int)constraints.size();
+	m_isHandled.resize(m_numConstraints, 0);
+
+	// supported joints which act on at least one dynamic body
+	std::vector<Joint> candidates;
+	std::vector<std::vector<std::pair<unsigned int, unsigned int>>> bodyJoints(numBodies);
+	for (unsigned int i = 0; i < m_numConstraints; i++)
+	{
+		Constraint *c = constraints[i];
+		if (!SparseJointSolver::isSupported(c))
+			continue;
+
+		Joint joint;
+		joint.m_constraintIndex = i;
+		joint.m_numRows = SparseJointSolver::numJointRows(c);
+		for (unsigned int side = 0; side < 2; side++)
+		{
+			joint.m_bodies[side] = c->m_bodies[side];
+			joint.m_fixed[side] = (rb[c->m_bodies[side]]->getMass() == 0.0);
+		}
+		if (joint.m_fixed[0] && joint.m_fixed[1])
+			continue;
+
+		for (unsigned int side = 0; side < 2; side++)
+		{
+			if (!joint.m_fixed[side])
+				bodyJoints[joint.m_bodies[side]].push_back(std::make_pair((unsigned int)candidates.size(), side));
+		}
+		candidates.push_back(joint);
+	}
+
+	// spanning trees by a breadth-first search, joints which close a loop are left to the local solver
+	std::vector<unsigned char> bodyVisited(numBodies, 0);
+	std::vector<unsigned char> jointVisited(candidates.size(), 0);
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		if (jointVisited[i])
+			continue;
+
+		const unsigned int rootBody = candidates[i].m_fixed[0] ? candidates[i].m_bodies[1] : candidates[i].m_bodies[0];
+		Tree tree;
+		tree.m_firstNode = (unsigned int)m_nodes.size();
+		Node root;
+		root.m_index = rootBody;
+		root.m_isJoint = false;
+		root.m_parent = -1;
+		root.m_side = 0;
+		m_nodes.push_back(root);
+		bodyVisited[rootBody] = 1;
+
+		for (size_t n = tree.m_firstNode; n < m_nodes.size(); n++)
+		{
+			const Node node = m_nodes[n];
+			if (node.m_isJoint)
+			{
+				// the body on the other side of the joint becomes a child
+				const Joint &joint = m_joints[node.m_index];
+				const unsigned int side = 1 - node.m_side;
+				if (joint.m_fixed[side])
+					continue;
+				Node child;
+				child.m_index = joint.m_bodies[side];
+				child.m_isJoint = false;
+				child.m_parent = (int)n;
+				child.m_side = side;
+				m_nodes.push_back(child);
+			}
+			else
+			{
+				const std::vector<std::pair<unsigned int, unsigned int>> &joints = bodyJoints[node.m_index];
+				for (size_t j = 0; j < joints.size(); j++)
+				{
+					const unsigned int jointIndex = joints[j].first;
+					const unsigned int side = joints[j].second;
+					if (jointVisited[jointIndex])
+						continue;
+					jointVisited[jointIndex] = 1;
+
+					const Joint &joint = candidates[jointIndex];
+					const unsigned int otherSide = 1 - side;
+					if (!joint.m_fixed[otherSide])
+					{
+						// loop closure
+						if (bodyVisited[joint.m_bodies[otherSide]])
+							continue;
+						bodyVisited[joint.m_bodies[otherSide]] = 1;
+					}
+
+					Node child;
+					child.m_index = (unsigned int)m_joints.size();
+					child.m_isJoint = true;
+					child.m_parent = (int)n;
+					child.m_side = side;
+					m_nodes.push_back(child);
+					m_joints.push_back(joint);
+					m_isHandled[joint.m_constraintIndex] = 1;
+				}
+			}
+		}
+		tree.m_numNodes = (unsigned int)m_nodes.size() - tree.m_firstNode;
+		m_trees.push_back(tree);
+	}
+
+	for (unsigned int side = 0; side < 2; side++)
+		m_J[side].resize(m_joints.size());
+	m_rhs.resize(m_joints.size());
+	m_D.resize(m_nodes.size());
+	m_decompositions.resize(m_nodes.size());
+	m_G.resize(m_nodes.size());
+	m_x.resize(m_nodes.size());
+}
+
+void ArticulatedBodySolver::computeRows(SimulationModel &model, const Tree &tree)
+{
+	SimulationModel::ConstraintVector &constraints = model.getConstraints();
+	for (unsigned int n = tree.m_firstNode; n < tree.m_firstNode + tree.m_numNodes; n++)
+	{
+		const Node &node = m_nodes[n];
+		if (!node.m_isJoint)
+			continue;
+		const Joint &joint = m_joints[node.m_index];
+		Vector6r J[2][6];
+		m_rhs[node.m_index].setZero();
+		SparseJointSolver::computeJointRows(model, constraints[joint.m_constraintIndex], J[0], J[1], m_rhs[node.m_index].data());
+		for (unsigned int side = 0; side < 2; side++)
+		{
+			m_J[side][node.m_index].setZero();
+			for (unsigned int k = 0; k < joint.m_numRows; k++)
+				m_J[side][node.m_index].row(k) = J[side][k].transpose();
+		}
+	}
+}
+
+ArticulatedBodySolver::Matrix6r ArticulatedBodySolver::getParentBlock(const Node &node) const
+{
+	if (node.m_isJoint)
+		return m_J[node.m_side][node.m_index];
+	return m_J[node.m_side][m_nodes[node.m_parent].m_index].transpose();
+}
+
+void ArticulatedBodySolver::factorize(SimulationModel &model, const Tree &tree)
+{
+	SimulationModel::RigidBodyVector &rb = model.getRigidBodies();
+	const unsigned int first = tree.m_firstNode;
+	const unsigned int last = tree.m_firstNode + tree.m_numNodes - 1;
+
+	// diagonal blocks: mass matrix of the bodies, (regularization) compliance of the joints
+	for (unsigned int n = first; n <= last; n++)
+	{
+		const Node &node = m_nodes[n];
+		Matrix6r &D = m_D[n];
+		D.setZero();
+		if (!node.m_isJoint)
+		{
+			const RigidBody &body = *rb[node.m_index];
+			D.topLeftCorner<3, 3>() = body.getMass() * Matrix3r::Identity();
+			D.bottomRightCorner<3, 3>() = body.getRotationMatrix() * body.getInertiaTensor().asDiagonal() * body.getRotationMatrix().transpose();
+		}
+		else
+		{
+			// Like in the sparse solver the diagonal of J M^-1 J^T is regularized slightly,
+			// so that a degenerate joint does not cause a singular matrix.
+			const Joint &joint = m_joints[node.m_index];
+			for (unsigned int k = 0; k < 6; k++)
+			{
+				if (k >= joint.m_numRows)
+				{
+					D(k, k) = 1.0;
+					continue;
+				}
+				Real d = 0.0;
+				for (unsigned int side = 0; side < 2; side++)
+				{
+					if (joint.m_fixed[side])
+						continue;
+					const RigidBody &body = *rb[joint.m_bodies[side]];
+					const Vector6r Jk = m_J[side][node.m_index].row(k).transpose();
+					d += body.getInvMass() * Jk.head<3>().squaredNorm() + Jk.tail<3>().dot(body.getInertiaTensorInverseW() * Jk.tail<3>());
+				}
+				D(k, k) = (d > 0.0) ? -static_cast<Real>(1.0e-8) * d : static_cast<Real>(-1.0);
+			}
+		}
+	}
+
+	// elimination from the leaves to the root, the children of a node are stored after the node
+	for (unsigned int n = last + 1; n-- > first; )
+	{
+		const Node &node = m_nodes[n];
+		m_decompositions[n].compute(m_D[n]);
+		if (node.m_parent >= 0)
+		{
+			const Matrix6r H = getParentBlock(node);
+			m_G[n] = m_decompositions[n].solve(H);
+			m_D[node.m_parent] -= H.transpose() * m_G[n];
+		}
+	}
+}
+
+void ArticulatedBodySolver::solve(const Tree &tree)
+{
+	const unsigned int first = tree.m_firstNode;
+	const unsigned int last = tree.m_firstNode + tree.m_numNodes - 1;
+
+	for (unsigned int n = first; n <= last; n++)
+	{
+		const Node &node = m_nodes[n];
+		if (node.m_isJoint)
+			m_x[n] = m_rhs[node.m_index];
+		else
+			m_x[n].setZero();
+	}
+
+	// L y = b
+	for (unsigned int n = last + 1; n-- > first; )
+	{
+		const Node &node = m_nodes[n];
+		if (node.m_parent >= 0)
+			m_x[node.m_parent] -= m_G[n].transpose() * m_x[n];
+	}
+	// D z = y
+	for (unsigned int n = first; n <= last; n++)
+		m_decompositions[n].solveInPlace(m_x[n]);
+	// L^T x = z
+	for (unsigned int n = first; n <= last; n++)
+	{
+		const Node &node = m_nodes[n];
+		if (node.m_parent >= 0)
+			m_x[n] -= m_G[n] * m_x[node.m_parent];
+	}
+}
+
+void ArticulatedBodySolver::applyCorrections(SimulationModel &model, const Tree &tree)
+{
+	SimulationModel::RigidBodyVector &rb = model.getRigidBodies();
+	for (unsigned int n = tree.m_firstNode; n < tree.m_firstNode + tree.m_numNodes; n++)
+	{
+		const Node &node = m_nodes[n];
+		if (node.m_isJoint)
+			continue;
+
+		RigidBody &body = *rb[node.m_index];
+		const Vector6r &corr = m_x[n];
+		body.getPosition() += corr.head<3>();
+		Quaternionr corr_q(0.0, corr[3], corr[4], corr[5]);
+		corr_q = corr_q * body.getRotation();
+		body.getRotation().coeffs() += static_cast<Real>(0.5) * corr_q.coeffs();
+		body.getRotation().normalize();
+		body.rotationUpdated();
+	}
+}
+
+void ArticulatedBodySolver::solvePositionConstraints(SimulationModel &model)
+{
+	if (model.getConstraints().size() != m_numConstraints)
+		init(model);
+
+	SimulationModel::RigidBodyVector &rb = model.getRigidBodies();
+	const int numTrees = (int)m_trees.size();
+
+	#pragma omp parallel if(numTrees > 1) default(shared)
+	{
+		#pragma omp for schedule(static)
+		for (int i = 0; i < numTrees; i++)
+		{
+			const Tree &tree = m_trees[i];
+			// all bodies of a tree belong to the same island
+			if (rb[m_nodes[tree.m_firstNode].m_index]->isSleeping())
+				continue;
+			computeRows(model, tree);
+			factorize(model, tree);
+			solve(tree);
+			applyCorrections(model, tree);
+		}
+	}
+}
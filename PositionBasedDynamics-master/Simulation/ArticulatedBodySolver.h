@@ -0,0 +1,112 @@
+#ifndef __ARTICULATEDBODYSOLVER_H__
+#define __ARTICULATEDBODYSOLVER_H__
+
+#include "Common/Common.h"
+#include "PositionBasedDynamics/BlockLDLT.h"
+#include "SparseJointSolver.h"
+#include <vector>
+
+namespace PBD
+{
+	class SimulationModel;
+	class Constraint;
+
+	/** Linear time direct solver for the position constraints of tree-structured articulated bodies.
+	 *
+	 * The rigid bodies and the supported joints (ball, hinge and universal joints) form a graph.
+	 * For each connected component a spanning tree is determined. The system
+	 * \f[\begin{pmatrix} \mathbf M & \mathbf J^T \\ \mathbf J & -\epsilon \mathbf 1 \end{pmatrix}
+	 * \begin{pmatrix} \Delta \mathbf x \\ -\boldsymbol \lambda \end{pmatrix} =
+	 * \begin{pmatrix} \mathbf 0 \\ -\mathbf C \end{pmatrix}\f]
+	 * of a tree has the sparsity pattern of the tree (bodies and joints are the nodes). It is
+	 * factorized without fill-in by eliminating the nodes from the leaves to the root and solved
+	 * in O(n) (see Baraff, "Linear-time dynamics using Lagrange multipliers", 1996). Like the
+	 * articulated-body algorithm this satisfies the linearized joint constraints of a tree exactly
+	 * at linear cost, but the bodies keep their maximal coordinates.
+	 * Joints which close a loop are not part of a tree and are solved by the local Gauss-Seidel
+	 * projection. Static bodies are not part of the trees, so chains which are attached to static
+	 * bodies at both ends are still trees.
+	 */
+	class ArticulatedBodySolver
+	{
+	protected:
+		typedef SparseJointSolver::Vector6r Vector6r;
+		typedef Eigen::Matrix<Real, 6, 6> Matrix6r;
+
+		/** Joint of a tree. Rows of a fixed (static) body are not used. */
+		struct Joint
+		{
+			unsigned int m_constraintIndex;
+			unsigned int m_bodies[2];
+			unsigned int m_numRows;
+			bool m_fixed[2];
+		};
+
+		/** Node of a tree. The nodes of a tree are stored in breadth-first order, so the parent
+		 * of a node is always stored before the node.
+		 */
+		struct Node
+		{
+			/** Index of the rigid body or of the joint */
+			unsigned int m_index;
+			bool m_isJoint;
+			/** Index of the parent node, -1 for the root */
+			int m_parent;
+			/** Side of the body in the joint, if the node or its parent is a body */
+			unsigned int m_side;
+		};
+
+		/** Range of nodes of one tree. The first node is the root body. */
+		struct Tree
+		{
+			unsigned int m_firstNode;
+			unsigned int m_numNodes;
+		};
+
+		std::vector<Joint> m_joints;
+		std::vector<Node> m_nodes;
+		std::vector<Tree> m_trees;
+		/** Number of model constraints when the trees were built */
+		unsigned int m_numConstraints;
+		/** Flag for each model constraint which is solved by this solver */
+		std::vector<unsigned char> m_isHandled;
+
+		/** Jacobians (6 rows, unused rows are zero) of body 0 and body 1 and the right hand side of each joint */
+		std::vector<Matrix6r, Eigen::aligned_allocator<Matrix6r>> m_J[2];
+		std::vector<Vector6r, Eigen::aligned_allocator<Vector6r>> m_rhs;
+		/** Diagonal blocks D, their decompositions, the blocks G = D^-1 H(node, parent) of the factorization
+		 * and the solution of each node. Joint nodes with less than 6 rows are padded by an identity block.
+		 */
+		std::vector<Matrix6r, Eigen::aligned_allocator<Matrix6r>> m_D;
+		std::vector<BlockLDLT<6>, Eigen::aligned_allocator<BlockLDLT<6>>> m_decompositions;
+		std::vector<Matrix6r, Eigen::aligned_allocator<Matrix6r>> m_G;
+		std::vector<Vector6r, Eigen::aligned_allocator<Vector6r>> m_x;
+
+		void init(SimulationModel &model);
+		void computeRows(SimulationModel &model, const Tree &tree);
+		/** Block of the system matrix in the row of the node and the column of its parent */
+		Matrix6r getParentBlock(const Node &node) const;
+		void factorize(SimulationModel &model, const Tree &tree);
+		void solve(const Tree &tree);
+		void applyCorrections(SimulationModel &model, const Tree &tree);
+
+	public:
+		ArticulatedBodySolver();
+		~ArticulatedBodySolver();
+
+		/** Perform one iteration of the solver for all trees. The trees are built again if the
+		 * number of constraints in the model has changed. Trees of sleeping bodies are skipped.
+		 */
+		void solvePositionConstraints(SimulationModel &model);
+
+		/** Return true if the constraint is part of a tree and solved by this solver. */
+		bool isHandled(const unsigned int constraintIndex) const { return (constraintIndex < m_isHandled.size()) && m_isHandled[constraintIndex]; }
+
+		unsigned int numJoints() const { return (unsigned int)m_joints.size(); }
+		unsigned int numTrees() const { return (unsigned int)m_trees.size(); }
+
+		void reset();
+	};
+}
+
+#endif
@@ -13,6 +13,9 @@ CollisionDetection::CollisionDetection() :
 	m_collisionObjects.reserve(1000);
 	m_contactCB = NULL;
 	m_solidContactCB = NULL;
+	m_contactCBUserData = NULL;
+	m_solidContactCBUserData = NULL;
+	m_defaultContactCallbacks = false;
 	m_tolerance = static_cast<Real>(0.01);
 }
 
@@ -67,12 +70,14 @@ void CollisionDetection::setContactCallback(CollisionDetection::ContactCallbackF
 {
 	m_contactCB = val;
 	m_contactCBUserData = userData;
+	m_defaultContactCallbacks = false;
 }
 
 void CollisionDetection::setSolidContactCallback(CollisionDetection::SolidContactCallbackFunction val, void *userData)
 {
 	m_solidContactCB = val;
 	m_solidContactCBUserData = userData;
+	m_defaultContactCallbacks = false;
 }
 
 void CollisionDetection::updateAABBs(SimulationModel &model)
@@ -99,14 +104,8 @@ void CollisionDetection::updateAABB(SimulationModel &model, CollisionDetection::
 	{
 		const unsigned int rbIndex = co->m_bodyIndex;
 		RigidBody *rb = rigidBodies[rbIndex];
-		const VertexData &vd = rb->getGeometry().getVertexData();
-
-		co->m_aabb.m_p[0] = vd.getPosition(0);
-		co->m_aabb.m_p[1] = vd.getPosition(0);
-		for (unsigned int j = 1; j < vd.size(); j++)
-		{
-			updateAABB(vd.getPosition(j), co->m_aabb);
-		}
+		// the world space vertices are only transformed on demand
+		rb->getGeometry().computeAABB(co->m_aabb.m_p[0], co->m_aabb.m_p[1]);
 	}
 	else if (co->m_bodyType == CollisionDetection::CollisionObject::TriangleModelCollisionObjectType)
 	{
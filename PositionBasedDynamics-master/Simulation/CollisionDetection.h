@@ -53,6 +53,8 @@ namespace PBD
 		SolidContactCallbackFunction m_solidContactCB;
 		void *m_contactCBUserData;
 		void *m_solidContactCBUserData;
+		/** True if the callbacks only add the contacts to the model which is their user data (see TimeStep) */
+		bool m_defaultContactCallbacks;
 		std::vector<CollisionObject*> m_collisionObjects;
 
 		void updateAABB(const Vector3r &p, AABB &aabb);
@@ -90,6 +92,15 @@ namespace PBD
 
 		void setContactCallback(CollisionDetection::ContactCallbackFunction val, void *userData);
 		void setSolidContactCallback(CollisionDetection::SolidContactCallbackFunction val, void *userData);
+		/** Mark the installed callbacks as the default callbacks which only add the contacts to the model.
+		 * Setting another callback resets the flag. 
+		 */
+		void setDefaultContactCallbacks(const bool val) { m_defaultContactCallbacks = val; }
+		/** Return true if the contacts can be added directly to the model without calling the callbacks. */
+		bool hasDefaultContactCallbacks(const SimulationModel &model) const 
+		{ 
+			return m_defaultContactCallbacks && (m_contactCBUserData == &model) && (m_solidContactCBUserData == &model); 
+		}
 		void updateAABBs(SimulationModel &model);
 		void updateAABB(SimulationModel &model, CollisionDetection::CollisionObject *co);
 	};
@@ -9,6 +9,7 @@
 
 #include <set>
 #include <map>
+#include <cmath>
 
 using namespace PBD;
 
@@ -429,6 +430,66 @@ bool SliderJoint::solvePositionConstraint(SimulationModel &model, const unsigned
 }
 
 
+//////////////////////////////////////////////////////////////////////////
+// MotorJoint
+//////////////////////////////////////////////////////////////////////////
+void MotorJoint::updateTarget(const Real t)
+{
+	const std::vector<Real> &sequence = m_targetSequence;
+	const unsigned int numKeys = (unsigned int)sequence.size() / 2;
+	if (numKeys == 0)
+		return;
+
+	Real time = t;
+	const Real sequenceDuration = sequence[2 * (numKeys - 1)] - sequence[0];
+	if (m_repeatSequence && (sequenceDuration > 0.0) && (time > sequenceDuration))
+	{
+		// wrap to (0, duration]
+		time = std::fmod(time, sequenceDuration);
+		if (time <= 0.0)
+			time = sequenceDuration;
+	}
+
+	if ((numKeys == 1) || (time >= sequence[2 * (numKeys - 1)]))
+	{
+		setTarget(sequence[2 * numKeys - 1]);
+		return;
+	}
+	if (time < sequence[0])
+	{
+		setTarget(sequence[1]);
+		return;
+	}
+
+	// find the keyframe k with time_k <= time < time_k+1, first at the cursor
+	// and its successor, then by a binary search
+	unsigned int k = m_sequenceCursor;
+	if ((k + 1 >= numKeys) || (time < sequence[2 * k]) || (time >= sequence[2 * (k + 1)]))
+	{
+		if ((k + 2 < numKeys) && (sequence[2 * (k + 1)] <= time) && (time < sequence[2 * (k + 2)]))
+			k++;
+		else
+		{
+			unsigned int lo = 0;
+			unsigned int hi = numKeys - 1;
+			while (hi - lo > 1)
+			{
+				const unsigned int mid = (lo + hi) / 2;
+				if (sequence[2 * mid] <= time)
+					lo = mid;
+				else
+					hi = mid;
+			}
+			k = lo;
+		}
+	}
+	m_sequenceCursor = k;
+
+	// linear interpolation
+	const Real alpha = (time - sequence[2 * k]) / (sequence[2 * (k + 1)] - sequence[2 * k]);
+	setTarget((static_cast<Real>(1.0) - alpha) * sequence[2 * k + 1] + alpha * sequence[2 * k + 3]);
+}
+
 //////////////////////////////////////////////////////////////////////////
 // TargetPositionMotorSliderJoint
 //////////////////////////////////////////////////////////////////////////
@@ -1626,6 +1687,30 @@ bool RigidBodyContactConstraint::solveVelocityConstraint(SimulationModel &model,
 	return res;
 }
 
+void RigidBodyContactConstraint::applyWarmStartImpulse(SimulationModel &model)
+{
+	SimulationModel::RigidBodyVector &rb = model.getRigidBodies();
+
+	RigidBody &rb1 = *rb[m_bodies[0]];
+	RigidBody &rb2 = *rb[m_bodies[1]];
+
+	const Vector3r &connector1 = m_constraintInfo.col(0);
+	const Vector3r &connector2 = m_constraintInfo.col(1);
+	const Vector3r &normal = m_constraintInfo.col(2);
+	const Vector3r p = m_sum_impulses * normal;
+
+	if (rb1.getMass() != 0.0)
+	{
+		rb1.getVelocity() += rb1.getInvMass() * p;
+		rb1.getAngularVelocity() += rb1.getInertiaTensorInverseW() * (connector1 - rb1.getPosition()).cross(p);
+	}
+	if (rb2.getMass() != 0.0)
+	{
+		rb2.getVelocity() -= rb2.getInvMass() * p;
+		rb2.getAngularVelocity() += rb2.getInertiaTensorInverseW() * (connector2 - rb2.getPosition()).cross(-p);
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////
 // ParticleRigidBodyContactConstraint
 //////////////////////////////////////////////////////////////////////////
@@ -2149,38 +2234,14 @@ bool StretchBendingTwistingConstraint::solvePositionConstraint(SimulationModel &
 
 PBD::DirectPositionBasedSolverForStiffRodsConstraint::~DirectPositionBasedSolverForStiffRodsConstraint()
 {
-	deleteNodes();
 	if (intervals != NULL)
 		delete[] intervals;
-	if (forward != NULL)
-		delete[] forward;
-	if (backward != NULL)
-		delete[] backward;
-	if (root != NULL)
-		delete[] root;
-	root = NULL;
-	forward = NULL;
-	backward = NULL;
+	delete nodes;
+	nodes = NULL;
 	intervals = NULL;
 	numberOfIntervals = 0;
 }
 
-void DirectPositionBasedSolverForStiffRodsConstraint::deleteNodes()
-{
-	std::list<Node*>::iterator nodeIter;
-	for (int i = 0; i < numberOfIntervals; i++)
-	{
-		for (nodeIter = forward[i].begin(); nodeIter != forward[i].end(); nodeIter++)
-		{
-			Node *node = *nodeIter;
-
-			// Root node does not have to be deleted
-			if (node->parent != NULL)
-				delete node;
-		}
-	}
-}
-
 bool PBD::DirectPositionBasedSolverForStiffRodsConstraint::initConstraint(
 	SimulationModel &model, 
 	const std::vector<std::pair<unsigned int, unsigned int>> & constraintSegmentIndices, 
@@ -2247,9 +2308,10 @@ bool PBD::DirectPositionBasedSolverForStiffRodsConstraint::initConstraint(
 	}
 
 	// initialize data of the sparse direct solver
-	deleteNodes();
+	if (nodes == NULL)
+		nodes = new NodeArrays();
 	DirectPositionBasedSolverForStiffRods::init_DirectPositionBasedSolverForStiffRodsConstraint(
-		m_rodConstraints, m_rodSegments, intervals, numberOfIntervals, forward, backward, root,
+		m_rodConstraints, m_rodSegments, intervals, numberOfIntervals, *nodes,
 		constraintPositions, averageRadii, youngsModuli, torsionModuli,
 		m_rightHandSide, m_lambdaSums, m_bendingAndTorsionJacobians, m_corr_x, m_corr_q);
 
@@ -2275,8 +2337,10 @@ bool PBD::DirectPositionBasedSolverForStiffRodsConstraint::updateConstraint(Simu
 bool PBD::DirectPositionBasedSolverForStiffRodsConstraint::solvePositionConstraint(SimulationModel &model, const unsigned int iter)
 {
 	const bool res = DirectPositionBasedSolverForStiffRods::solve_DirectPositionBasedSolverForStiffRodsConstraint(
-		m_rodConstraints, m_rodSegments, intervals, numberOfIntervals, forward, backward,
-		m_rightHandSide, m_lambdaSums, m_bendingAndTorsionJacobians, m_corr_x, m_corr_q
+		m_rodConstraints, m_rodSegments, intervals, numberOfIntervals, *nodes,
+		m_rightHandSide, m_lambdaSums, m_bendingAndTorsionJacobians, m_corr_x, m_corr_q,
+		!model.getValue<bool>(SimulationModel::ROD_REUSE_FACTORIZATION) || (iter == 0),
+		model.getValue<Real>(SimulationModel::ROD_REFACTORIZATION_THRESHOLD)
 		);
 	
 	// apply corrections to bodies
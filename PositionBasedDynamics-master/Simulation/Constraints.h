@@ -112,19 +112,27 @@ namespace PBD
 	public:
 		Real m_target;
 		std::vector<Real> m_targetSequence;
-		MotorJoint() : Constraint(2) { m_target = 0.0; }
+		MotorJoint() : Constraint(2) { m_target = 0.0; m_sequenceCursor = 0; }
 
 		virtual Real getTarget() const { return m_target; }
 		virtual void setTarget(const Real val) { m_target = val; }
 
 		virtual std::vector<Real> &getTargetSequence() { return m_targetSequence; }
-		virtual void setTargetSequence(const std::vector<Real> &val) { m_targetSequence = val; }
+		virtual void setTargetSequence(const std::vector<Real> &val) { m_targetSequence = val; m_sequenceCursor = 0; }
 
 		bool getRepeatSequence() const { return m_repeatSequence; }
 		void setRepeatSequence(bool val) { m_repeatSequence = val; }
 
+		/** Set the target to the linearly interpolated value of the target sequence
+		 * (time_0, value_0, time_1, value_1, ...) at the given time. The keyframe of the last call
+		 * is checked first, so the lookup is constant for a monotonic time and logarithmic otherwise.
+		 */
+		void updateTarget(const Real time);
+
 	private:
 		bool m_repeatSequence;
+		/** Keyframe with the last time <= the time of the last evaluation */
+		unsigned int m_sequenceCursor;
 	};
 
 	class TargetPositionMotorSliderJoint : public MotorJoint
@@ -389,6 +397,8 @@ namespace PBD
 			const Vector3r &normal, const Real dist, 
 			const Real restitutionCoeff, const Real stiffness, const Real frictionCoeff);
 		virtual bool solveVelocityConstraint(SimulationModel &model, const unsigned int iter);
+		/** Apply the accumulated normal impulse m_sum_impulses of the last step (warm starting). */
+		void applyWarmStartImpulse(SimulationModel &model);
 	};
 
 	class ParticleRigidBodyContactConstraint
@@ -511,7 +521,7 @@ namespace PBD
 		virtual bool solvePositionConstraint(SimulationModel &model, const unsigned int iter);
 	};
 
-	struct Node;
+	struct NodeArrays;
 	struct Interval;
 	class SimulationModel;
 	using Vector6r = Eigen::Matrix<Real, 6, 1>;
@@ -565,7 +575,7 @@ namespace PBD
 		static int TYPE_ID;
 
 		DirectPositionBasedSolverForStiffRodsConstraint() :  Constraint(2),
-			root(NULL), numberOfIntervals(0), intervals(NULL), forward(NULL), backward(NULL){}
+			nodes(NULL), numberOfIntervals(0), intervals(NULL){}
 		~DirectPositionBasedSolverForStiffRodsConstraint();
 
 		virtual int &getTypeId() const { return TYPE_ID; }
@@ -584,16 +594,12 @@ namespace PBD
 
 	protected:
 		
-		/** root node */
-		Node *root;
+		/** nodes of the trees in the order of increasing row index in the system matrix H (from the leaves to the root) */
+		NodeArrays *nodes;
 		/** intervals of constraints */
 		Interval *intervals;
 		/** number of intervals */
 		int numberOfIntervals;		
-		/** list to process nodes with increasing row index in the system matrix H (from the leaves to the root) */
-		std::list <Node*> *forward;
-		/** list to process nodes starting with the highest row index to row index zero in the matrix H (from the root to the leaves) */
-		std::list <Node*> *backward;
 
 		std::vector<RodConstraintImpl> m_Constraints;
 		std::vector<RodConstraint*> m_rodConstraints;
@@ -606,8 +612,6 @@ namespace PBD
 		std::vector<std::vector<Matrix3r>> m_bendingAndTorsionJacobians;
 		std::vector<Vector3r> m_corr_x;
 		std::vector<Quaternionr> m_corr_q;
-
-		void deleteNodes();
 	};
 }
 #endif
@@ -53,6 +53,22 @@ void PBD::CubicSDFCollisionDetection::addCubicSDFCollisionObject(const unsigned
 	m_collisionObjects.push_back(co);
 }
 
+void CubicSDFCollisionDetection::addCubicSDFCollisionObject(const unsigned int bodyIndex, const unsigned int bodyType, const Vector3r *vertices, const unsigned int numVertices, SparseSDFPtr sdf, const Vector3r &scale, const bool testMesh, const bool invertSDF)
+{
+	CubicSDFCollisionDetection::CubicSDFCollisionObject *co = new CubicSDFCollisionDetection::CubicSDFCollisionObject();
+	co->m_bodyIndex = bodyIndex;
+	co->m_bodyType = bodyType;
+	co->m_sdfFile = "";
+	co->m_scale = scale;
+	co->m_sparseSDF = sdf;
+	co->m_bvh.init(vertices, numVertices);
+	co->m_bvh.construct();
+	co->m_testMesh = testMesh;
+	if (invertSDF)
+		co->m_invertSDF = -1.0;
+	m_collisionObjects.push_back(co);
+}
+
 CubicSDFCollisionDetection::CubicSDFCollisionObject::CubicSDFCollisionObject()
 {
 }
@@ -64,7 +80,11 @@ CubicSDFCollisionDetection::CubicSDFCollisionObject::~CubicSDFCollisionObject()
 double CubicSDFCollisionDetection::CubicSDFCollisionObject::distance(const Eigen::Vector3d &x, const Real tolerance)
 {
 	const Eigen::Vector3d scaled_x = x.cwiseProduct(m_scale.template cast<double>().cwiseInverse());
-	const double dist = m_sdf->interpolate(0, scaled_x);
+	double dist;
+	if (m_sparseSDF)
+		dist = m_sparseSDF->interpolate(scaled_x.template cast<Real>());
+	else
+		dist = m_sdf->interpolate(0, scaled_x);
 	if (dist == std::numeric_limits<double>::max())
 		return dist;
 	return m_invertSDF * m_scale[0]*dist - tolerance;
@@ -73,12 +93,39 @@ double CubicSDFCollisionDetection::CubicSDFCollisionObject::distance(const Eigen
 bool CubicSDFCollisionDetection::CubicSDFCollisionObject::collisionTest(const Vector3r &x, const Real tolerance, Vector3r &cp, Vector3r &n, Real &dist, const Real maxDist)
 {
 	const Vector3r scaled_x = x.cwiseProduct(m_scale.cwiseInverse());
+	// The field is evaluated in its unscaled space. Distances are converted to world space by the 
+	// smallest scaling factor, so dist is a lower bound of the distance in world space on all paths 
+	// (which is required by the distance cache).
+	const Real minScale = m_scale.cwiseAbs().minCoeff();
 
 	Eigen::Vector3d normal;	
-	double d = m_sdf->interpolate(0, scaled_x.template cast<double>(), &normal);
-	if (d == std::numeric_limits<Real>::max())
+	double d;
+	AlignedBox3r domain;
+	if (m_sparseSDF)
+	{
+		Vector3r gradient;
+		d = m_sparseSDF->interpolate(scaled_x, &gradient);
+		normal = gradient.template cast<double>();
+		domain = m_sparseSDF->getDomain();
+	}
+	else
+	{
+		d = m_sdf->interpolate(0, scaled_x.template cast<double>(), &normal);
+		domain = m_sdf->domain().template cast<Real>();
+	}
+	if (d == std::numeric_limits<double>::max())
+	{
+		// The surface is inside of the domain. An inverted field has no bound outside of it.
+		if (m_invertSDF > 0.0)
+			dist = sqrt(domain.squaredExteriorDistance(scaled_x)) * minScale - tolerance;
+		else
+			dist = -tolerance;
+		return false;
+	}
+	dist = static_cast<Real>(m_invertSDF * d * minScale - tolerance);
+	// the gradient of the sparse field is only zero if the field does not contain any surface
+	if (m_sparseSDF && (normal.squaredNorm() < 1.0e-12))
 		return false;
-	dist = static_cast<Real>(m_invertSDF * d - tolerance);
 
 	normal = m_invertSDF * normal;
 	if (dist < maxDist)
@@ -86,7 +133,7 @@ bool CubicSDFCollisionDetection::CubicSDFCollisionObject::collisionTest(const Ve
 		normal.normalize();
 		n = normal.template cast<Real>();
 
-		cp = (scaled_x - dist * n);
+		cp = (scaled_x - (dist / minScale) * n);
 		cp = cp.cwiseProduct(m_scale);
 
 		return true;
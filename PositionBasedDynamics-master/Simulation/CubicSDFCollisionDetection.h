@@ -3,6 +3,7 @@
 
 #include "Common/Common.h"
 #include "Simulation/DistanceFieldCollisionDetection.h"
+#include "Simulation/SparseSDF.h"
 #include <memory>
 
 #include "Discregrid/All"
@@ -10,6 +11,7 @@
 namespace PBD
 {
 	/** Collision detection based on cubic signed distance fields. 
+	* Alternatively, a sparse narrow-band distance field can be used for a collision object.
 	*/
 	class CubicSDFCollisionDetection : public DistanceFieldCollisionDetection
 	{
@@ -22,6 +24,8 @@ namespace PBD
 			std::string m_sdfFile;
 			Vector3r m_scale;
 			GridPtr m_sdf;
+			/** If set, the sparse field is used instead of m_sdf */
+			SparseSDFPtr m_sparseSDF;
 			static int TYPE_ID;
 
 			CubicSDFCollisionObject();
@@ -39,6 +43,7 @@ namespace PBD
 
 		void addCubicSDFCollisionObject(const unsigned int bodyIndex, const unsigned int bodyType, const Vector3r *vertices, const unsigned int numVertices, const std::string &sdfFile, const Vector3r &scale, const bool testMesh = true, const bool invertSDF = false);
 		void addCubicSDFCollisionObject(const unsigned int bodyIndex, const unsigned int bodyType, const Vector3r *vertices, const unsigned int numVertices, GridPtr sdf, const Vector3r &scale, const bool testMesh = true, const bool invertSDF = false);
+		void addCubicSDFCollisionObject(const unsigned int bodyIndex, const unsigned int bodyType, const Vector3r *vertices, const unsigned int numVertices, SparseSDFPtr sdf, const Vector3r &scale, const bool testMesh = true, const bool invertSDF = false);
 	};
 }
 
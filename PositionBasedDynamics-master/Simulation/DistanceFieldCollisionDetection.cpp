@@ -17,6 +17,11 @@ int DistanceFieldCollisionDetection::DistanceFieldCollisionObjectWithoutGeometry
 DistanceFieldCollisionDetection::DistanceFieldCollisionDetection() :
 	CollisionDetection()
 {
+	m_parallelContactMerge = true;
+	m_useDistanceCache = false;
+	m_distanceCacheTolerance = static_cast<Real>(0.01);
+	m_contactReduction = false;
+	m_maxContactsPerPair = 4;
 }
 
 DistanceFieldCollisionDetection::~DistanceFieldCollisionDetection()
@@ -25,12 +30,16 @@ DistanceFieldCollisionDetection::~DistanceFieldCollisionDetection()
 
 void DistanceFieldCollisionDetection::collisionDetection(SimulationModel &model)
 {
+	if (m_contactReduction)
+		updateContactManifolds(model);
 	model.resetContacts();
 	const SimulationModel::RigidBodyVector &rigidBodies = model.getRigidBodies();
 	const SimulationModel::TriangleModelVector &triModels = model.getTriangleModels();
 	const SimulationModel::TetModelVector &tetModels = model.getTetModels();
 	const ParticleData &pd = model.getParticles();
 
+	// the pair (i, k) has the index i * (numCollisionObjects - 1) + (k < i ? k : k - 1)
+	const unsigned int numCollisionObjects = (unsigned int)m_collisionObjects.size();
 	std::vector < std::pair<unsigned int, unsigned int>> coPairs;
 	for (unsigned int i = 0; i < m_collisionObjects.size(); i++)
 	{
@@ -46,14 +55,23 @@ void DistanceFieldCollisionDetection::collisionDetection(SimulationModel &model)
 		}
 	}
 
+	if (m_useDistanceCache)
+		m_distanceCaches.resize(coPairs.size());
+	if (m_contactReduction)
+		m_contactManifolds.resize(coPairs.size());
+
 	//omp_set_num_threads(1);
-	std::vector<std::vector<ContactData> > contacts_mt;	
+	std::vector<std::vector<ContactData> > &contacts_mt = m_contacts_mt;
 #ifdef _DEBUG
 	const unsigned int maxThreads = 1;
 #else
 	const unsigned int maxThreads = omp_get_max_threads();
 #endif
 	contacts_mt.resize(maxThreads);
+	for (unsigned int i = 0; i < maxThreads; i++)
+		contacts_mt[i].clear();
+	m_manifoldCandidates_mt.resize(maxThreads);
+	m_rigidBodyContactCount_mt.assign(maxThreads, 0);
 
 	#pragma omp parallel default(shared)
 	{
@@ -62,6 +80,10 @@ void DistanceFieldCollisionDetection::collisionDetection(SimulationModel &model)
 		for (int i = 0; i < (int)m_collisionObjects.size(); i++)
 		{
 			CollisionDetection::CollisionObject *co = m_collisionObjects[i];
+			// the AABB of a sleeping body does not change
+			if ((co->m_bodyType == CollisionDetection::CollisionObject::RigidBodyCollisionObjectType) &&
+				model.getRigidBodies()[co->m_bodyIndex]->isSleeping())
+				continue;
 			updateAABB(model, co);
 			if (isDistanceFieldCollisionObject(co))
 			{
@@ -97,16 +119,51 @@ void DistanceFieldCollisionDetection::collisionDetection(SimulationModel &model)
 
 			if ((co1->m_bodyType == CollisionDetection::CollisionObject::RigidBodyCollisionObjectType) &&
 				(co2->m_bodyType == CollisionDetection::CollisionObject::RigidBodyCollisionObjectType) &&
-				((DistanceFieldCollisionObject*) co1)->m_testMesh)
+				(m_contactReduction || ((DistanceFieldCollisionObject*) co1)->m_testMesh))
 			{
 				RigidBody *rb1 = rigidBodies[co1->m_bodyIndex];				
 				RigidBody *rb2 = rigidBodies[co2->m_bodyIndex];
 				const Real restitutionCoeff = rb1->getRestitutionCoeff() * rb2->getRestitutionCoeff();
 				const Real frictionCoeff = rb1->getFrictionCoeff() + rb2->getFrictionCoeff();
-				collisionDetectionRigidBodies(rb1, (DistanceFieldCollisionObject*)co1, rb2, (DistanceFieldCollisionObject*)co2,
-					restitutionCoeff, frictionCoeff
-					, contacts_mt
-					);
+				if (m_contactReduction)
+				{
+					// Both directions of a pair of bodies share one manifold. They are handled
+					// together by the pair whose first collision object has the smaller index.
+					if (coPair.first > coPair.second)
+						continue;
+					const unsigned int reverseIndex = coPair.second * (numCollisionObjects - 1) + coPair.first;
+					DistanceCache *cache1 = nullptr;
+					DistanceCache *cache2 = nullptr;
+					if (m_useDistanceCache)
+					{
+						cache1 = &m_distanceCaches[i];
+						cache1->init(co1, co2, rb1->getGeometry().getVertexDataLocal().size());
+						cache2 = &m_distanceCaches[reverseIndex];
+						cache2->init(co2, co1, rb2->getGeometry().getVertexDataLocal().size());
+					}
+					ContactManifold &manifold = m_contactManifolds[i];
+					manifold.init(co1, co2);
+					collisionDetectionRigidBodyPair(rb1, (DistanceFieldCollisionObject*)co1, rb2, (DistanceFieldCollisionObject*)co2,
+						restitutionCoeff, frictionCoeff
+						, contacts_mt
+						, cache1, cache2
+						, manifold
+						);
+				}
+				else
+				{
+					DistanceCache *cache = nullptr;
+					if (m_useDistanceCache)
+					{
+						cache = &m_distanceCaches[i];
+						cache->init(co1, co2, rb1->getGeometry().getVertexDataLocal().size());
+					}
+					collisionDetectionRigidBodies(rb1, (DistanceFieldCollisionObject*)co1, rb2, (DistanceFieldCollisionObject*)co2,
+						restitutionCoeff, frictionCoeff
+						, contacts_mt
+						, cache
+						);
+				}
 			}
 			else if ((co1->m_bodyType == CollisionDetection::CollisionObject::TriangleModelCollisionObjectType) &&
 					(co2->m_bodyType == CollisionDetection::CollisionObject::RigidBodyCollisionObjectType) &&
@@ -119,9 +176,16 @@ void DistanceFieldCollisionDetection::collisionDetection(SimulationModel &model)
 				const unsigned int numVert = mesh.numVertices();
 				const Real restitutionCoeff = tm->getRestitutionCoeff() * rb2->getRestitutionCoeff();
 				const Real frictionCoeff = tm->getFrictionCoeff() + rb2->getFrictionCoeff();
+				DistanceCache *cache = nullptr;
+				if (m_useDistanceCache)
+				{
+					cache = &m_distanceCaches[i];
+					cache->init(co1, co2, numVert);
+				}
 				collisionDetectionRBSolid(pd, offset, numVert, (DistanceFieldCollisionObject*)co1, rb2, (DistanceFieldCollisionObject*)co2,
 					restitutionCoeff, frictionCoeff
 					, contacts_mt
+					, cache
 					);
 			}
 			else if ((co1->m_bodyType == CollisionDetection::CollisionObject::TetModelCollisionObjectType) && 
@@ -135,9 +199,16 @@ void DistanceFieldCollisionDetection::collisionDetection(SimulationModel &model)
 				const unsigned int numVert = mesh.numVertices();
 				const Real restitutionCoeff = tm->getRestitutionCoeff() * rb2->getRestitutionCoeff();
 				const Real frictionCoeff = tm->getFrictionCoeff() + rb2->getFrictionCoeff();
+				DistanceCache *cache = nullptr;
+				if (m_useDistanceCache)
+				{
+					cache = &m_distanceCaches[i];
+					cache->init(co1, co2, numVert);
+				}
 				collisionDetectionRBSolid(pd, offset, numVert, (DistanceFieldCollisionObject*)co1, rb2, (DistanceFieldCollisionObject*)co2,
 					restitutionCoeff, frictionCoeff
 					, contacts_mt
+					, cache
 					);
 			}
  			else if ((co1->m_bodyType == CollisionDetection::CollisionObject::TetModelCollisionObjectType) &&
@@ -179,6 +250,18 @@ void DistanceFieldCollisionDetection::collisionDetection(SimulationModel &model)
 		}
 	}
 
+	if (!m_parallelContactMerge || !hasDefaultContactCallbacks(model) || !addContactsParallel(model))
+	{
+		model.resetContacts();
+		addContacts();
+	}
+	if (m_contactReduction)
+		warmStartContacts(model);
+}
+
+void DistanceFieldCollisionDetection::addContacts()
+{
+	std::vector<std::vector<ContactData> > &contacts_mt = m_contacts_mt;
 	m_tempContacts.clear();
 	for (unsigned int i = 0; i < contacts_mt.size(); i++)
 	{
@@ -204,15 +287,77 @@ void DistanceFieldCollisionDetection::collisionDetection(SimulationModel &model)
 	}
 }
 
+bool DistanceFieldCollisionDetection::addContactsParallel(SimulationModel &model)
+{
+	const int numThreads = (int)m_contacts_mt.size();
+	for (unsigned int k = 0; k < 3; k++)
+		m_contactOffsets[k].resize(numThreads + 1);
+
+	// count the contacts of each type (0: rigid body, 1: particle-rigid body, 2: particle-solid) per thread
+	#pragma omp parallel for schedule(static) default(shared)
+	for (int t = 0; t < numThreads; t++)
+	{
+		unsigned int count[3] = { 0, 0, 0 };
+		const std::vector<ContactData> &contacts = m_contacts_mt[t];
+		for (unsigned int j = 0; j < contacts.size(); j++)
+			count[(unsigned int) contacts[j].m_type]++;
+		for (unsigned int k = 0; k < 3; k++)
+			m_contactOffsets[k][t + 1] = count[k];
+	}
+
+	// exclusive prefix sums give the first index of the contacts of each thread
+	for (unsigned int k = 0; k < 3; k++)
+	{
+		m_contactOffsets[k][0] = 0;
+		for (int t = 0; t < numThreads; t++)
+			m_contactOffsets[k][t + 1] += m_contactOffsets[k][t];
+	}
+
+	model.resizeContactConstraints(m_contactOffsets[0][numThreads], m_contactOffsets[1][numThreads], m_contactOffsets[2][numThreads]);
+	m_tempContacts.resize(m_contactOffsets[2][numThreads]);
+
+	// construct the constraints in place, each thread writes to its own range
+	bool success = true;
+	#pragma omp parallel for schedule(dynamic, 1) default(shared) reduction(&&:success)
+	for (int t = 0; t < numThreads; t++)
+	{
+		unsigned int index[3] = { m_contactOffsets[0][t], m_contactOffsets[1][t], m_contactOffsets[2][t] };
+		const std::vector<ContactData> &contacts = m_contacts_mt[t];
+		for (unsigned int j = 0; j < contacts.size(); j++)
+		{
+			const ContactData &cd = contacts[j];
+			if (cd.m_type == 0)
+				success = model.initRigidBodyContactConstraint(index[0]++, cd.m_index1, cd.m_index2, 
+					cd.m_cp1, cd.m_cp2, cd.m_normal, cd.m_dist, cd.m_restitution, cd.m_friction) && success;
+			else if (cd.m_type == 1)
+				success = model.initParticleRigidBodyContactConstraint(index[1]++, cd.m_index1, cd.m_index2,
+					cd.m_cp1, cd.m_cp2, cd.m_normal, cd.m_dist, cd.m_restitution, cd.m_friction) && success;
+			else if (cd.m_type == 2)
+			{
+				m_tempContacts[index[2]] = cd;
+				success = model.initParticleSolidContactConstraint(index[2]++, cd.m_index1, cd.m_index2,
+					cd.m_elementIndex2, cd.m_bary2, cd.m_cp1, cd.m_cp2, cd.m_normal, cd.m_dist, cd.m_restitution, cd.m_friction) && success;
+			}
+		}
+	}
+	return success;
+}
+
 void DistanceFieldCollisionDetection::collisionDetectionRigidBodies(RigidBody *rb1, DistanceFieldCollisionObject *co1, RigidBody *rb2, DistanceFieldCollisionObject *co2, 
 	const Real restitutionCoeff, const Real frictionCoeff
 	, std::vector<std::vector<ContactData> > &contacts_mt
+	, DistanceCache *cache
+	, std::vector<ContactData> *candidates
 	)
 {
 	if ((rb1->getMass() == 0.0) && (rb2->getMass() == 0.0))
 		return;
+	// resting contacts of sleeping islands are not required
+	if ((rb1->isSleeping() || (rb1->getMass() == 0.0)) && (rb2->isSleeping() || (rb2->getMass() == 0.0)))
+		return;
 
-	const VertexData &vd = rb1->getGeometry().getVertexData();
+	// the vertices are transformed on demand, only for the leaves which are reached by the traversal
+	const RigidBodyGeometry &geometry1 = rb1->getGeometry();
 
 	const Vector3r &com2 = rb2->getPosition();
 
@@ -230,6 +375,14 @@ void DistanceFieldCollisionDetection::collisionDetectionRigidBodies(RigidBody *r
 	const Vector3r &v1 = rb2->getTransformationV1();
 	const Vector3r &v2 = rb2->getTransformationV2();
 
+#ifdef _DEBUG
+	const int tid = 0;
+#else
+	const int tid = omp_get_thread_num();
+#endif
+	// with contact reduction the contacts are collected as candidates first
+	std::vector<ContactData> &contacts = (candidates != nullptr) ? *candidates : contacts_mt[tid];
+
 	const PointCloudBSH &bvh = ((DistanceFieldCollisionDetection::DistanceFieldCollisionObject*) co1)->m_bvh;
 	std::function<bool(unsigned int, unsigned int)> predicate = [&](unsigned int node_index, unsigned int depth)
 	{
@@ -264,26 +417,264 @@ void DistanceFieldCollisionDetection::collisionDetectionRigidBodies(RigidBody *r
 		for (auto i = node.begin; i < node.begin + node.n; ++i)
 		{
 			unsigned int index = bvh.entity(i);
-			const Vector3r &x_w = vd.getPosition(index);
+			const Vector3r x_w = geometry1.getTransformedVertex(index);
 			const Vector3r x = R * (x_w - com2) + v1;
+			if ((cache != nullptr) && cache->isFar(index, x, m_distanceCacheTolerance))
+				continue;
 			Vector3r cp, n;
-			Real dist;
-			if (co2->collisionTest(x, m_tolerance, cp, n, dist))
+			Real dist = 0.0;
+			const bool collision = co2->collisionTest(x, m_tolerance, cp, n, dist);
+			if (cache != nullptr)
+			{
+				cache->m_x[index] = x;
+				cache->m_dist[index] = dist;
+			}
+			if (collision)
 			{
 				const Vector3r cp_w = R.transpose() * cp + v2;
 				const Vector3r n_w = R.transpose() * n;
 
+				contacts.push_back({ 0, co1->m_bodyIndex, co2->m_bodyIndex, x_w, cp_w, n_w, dist, restitutionCoeff, frictionCoeff });
+				// the vertex identifies the contact in the manifold
+				contacts.back().m_elementIndex1 = index;
+			}
+		}
+	};
+	bvh.traverse_depth_first(predicate, cb);
+}
+
+void DistanceFieldCollisionDetection::collisionDetectionRigidBodyPair(RigidBody *rb1, DistanceFieldCollisionObject *co1, RigidBody *rb2, DistanceFieldCollisionObject *co2,
+	const Real restitutionCoeff, const Real frictionCoeff
+	, std::vector<std::vector<ContactData> > &contacts_mt
+	, DistanceCache *cache1, DistanceCache *cache2
+	, ContactManifold &manifold
+	)
+{
+	if ((rb1->getMass() == 0.0) && (rb2->getMass() == 0.0))
+		return;
+	// the manifold of a sleeping pair is kept, so that its impulses are available when it wakes up
+	if ((rb1->isSleeping() || (rb1->getMass() == 0.0)) && (rb2->isSleeping() || (rb2->getMass() == 0.0)))
+	{
+		manifold.m_resting = true;
+		return;
+	}
+
 #ifdef _DEBUG
-				int tid = 0;
+	const int tid = 0;
 #else
-				int tid = omp_get_thread_num();
-#endif			
+	const int tid = omp_get_thread_num();
+#endif
+	std::vector<ContactData> &candidates = m_manifoldCandidates_mt[tid];
+	candidates.clear();
+	if (co1->m_testMesh)
+		collisionDetectionRigidBodies(rb1, co1, rb2, co2, restitutionCoeff, frictionCoeff, contacts_mt, cache1, &candidates);
+	const size_t numCandidates1 = candidates.size();
+	if (co2->m_testMesh)
+		collisionDetectionRigidBodies(rb2, co2, rb1, co1, restitutionCoeff, frictionCoeff, contacts_mt, cache2, &candidates);
+	for (size_t j = 0; j < candidates.size(); j++)
+		candidates[j].m_elementIndex1 = 2 * candidates[j].m_elementIndex1 + ((j < numCandidates1) ? 0 : 1);
+
+	unsigned int selected[ContactManifold::MAX_POINTS];
+	const unsigned int numSelected = reduceContacts(candidates, manifold, m_maxContactsPerPair, selected);
+
+	// the impulses of the vertices which were already part of the last manifold are kept
+	ContactManifold newManifold = manifold;
+	newManifold.m_numPoints = numSelected;
+	newManifold.m_thread = tid;
+	newManifold.m_firstContact = m_rigidBodyContactCount_mt[tid];
+	for (unsigned int k = 0; k < numSelected; k++)
+	{
+		const ContactData &cd = candidates[selected[k]];
+		newManifold.m_vertexIndex[k] = cd.m_elementIndex1;
+		newManifold.m_impulse[k] = 0.0;
+		for (unsigned int l = 0; l < manifold.m_numPoints; l++)
+		{
+			if (manifold.m_vertexIndex[l] == cd.m_elementIndex1)
+				newManifold.m_impulse[k] = manifold.m_impulse[l];
+		}
+		contacts_mt[tid].push_back(cd);
+	}
+	m_rigidBodyContactCount_mt[tid] += numSelected;
+	manifold = newManifold;
+}
 
-				contacts_mt[tid].push_back({ 0, co1->m_bodyIndex, co2->m_bodyIndex, x_w, cp_w, n_w, dist, restitutionCoeff, frictionCoeff });
+unsigned int DistanceFieldCollisionDetection::reduceContacts(const std::vector<ContactData> &candidates, const ContactManifold &manifold,
+	const unsigned int maxPoints, unsigned int *selected) const
+{
+	const unsigned int n = (unsigned int)candidates.size();
+	if (n <= maxPoints)
+	{
+		for (unsigned int i = 0; i < n; i++)
+			selected[i] = i;
+		return n;
+	}
+
+	// A point of the last manifold is selected if its score reaches this fraction of the best score.
+	// This avoids that the manifold switches between points of similar quality in each step.
+	const Real hysteresis = static_cast<Real>(0.9);
+	unsigned int numSelected = 0;
+	auto isSelected = [&](const unsigned int i)
+	{
+		for (unsigned int k = 0; k < numSelected; k++)
+			if (selected[k] == i)
+				return true;
+		return false;
+	};
+	auto isInManifold = [&](const unsigned int i)
+	{
+		for (unsigned int k = 0; k < manifold.m_numPoints; k++)
+			if (manifold.m_vertexIndex[k] == candidates[i].m_elementIndex1)
+				return true;
+		return false;
+	};
+	// returns the candidate with the best score, -1 if no candidate has a positive score
+	auto selectBest = [&](const std::function<Real(unsigned int)> &score)
+	{
+		int best = -1;
+		int bestKept = -1;
+		Real bestScore = 0.0;
+		Real bestKeptScore = 0.0;
+		for (unsigned int i = 0; i < n; i++)
+		{
+			if (isSelected(i))
+				continue;
+			const Real s = score(i);
+			if (s > bestScore)
+			{
+				best = i;
+				bestScore = s;
+			}
+			if ((s > bestKeptScore) && isInManifold(i))
+			{
+				bestKept = i;
+				bestKeptScore = s;
 			}
 		}
+		if ((bestKept >= 0) && (bestKeptScore >= hysteresis * bestScore))
+			return bestKept;
+		return best;
 	};
-	bvh.traverse_depth_first(predicate, cb);
+
+	// deepest point, the distance is smaller than the tolerance for all contacts
+	int i0 = selectBest([&](unsigned int i) { return m_tolerance - candidates[i].m_dist + std::numeric_limits<Real>::min(); });
+	if (i0 < 0)
+		i0 = 0;
+	selected[numSelected++] = i0;
+
+	// the areas are measured in the tangent plane of the deepest contact
+	const Vector3r &normal = candidates[i0].m_normal;
+	const Vector3r &p0 = candidates[i0].m_cp1;
+
+	// point with the largest distance to the first point
+	const int i1 = selectBest([&](unsigned int i)
+	{
+		const Vector3r d = candidates[i].m_cp1 - p0;
+		return (d - d.dot(normal) * normal).squaredNorm();
+	});
+	if (i1 < 0)
+		return numSelected;
+	selected[numSelected++] = i1;
+
+	// point which spans the triangle with the largest area
+	const Vector3r &p1 = candidates[i1].m_cp1;
+	const int i2 = selectBest([&](unsigned int i)
+	{
+		return std::abs(normal.dot((p1 - p0).cross(candidates[i].m_cp1 - p0)));
+	});
+	if (i2 < 0)
+		return numSelected;
+	selected[numSelected++] = i2;
+
+	// the selected points form a polygon in counter-clockwise order around the normal
+	if (normal.dot((p1 - p0).cross(candidates[i2].m_cp1 - p0)) < 0.0)
+		std::swap(selected[1], selected[2]);
+
+	// add the points which increase the area of the polygon most
+	auto areaGain = [&](const unsigned int i, unsigned int &edge)
+	{
+		Real gain = 0.0;
+		edge = 0;
+		for (unsigned int k = 0; k < numSelected; k++)
+		{
+			const Vector3r &a = candidates[selected[k]].m_cp1;
+			const Vector3r &b = candidates[selected[(k + 1) % numSelected]].m_cp1;
+			const Real g = -normal.dot((b - a).cross(candidates[i].m_cp1 - a));
+			if (g > gain)
+			{
+				gain = g;
+				edge = k;
+			}
+		}
+		return gain;
+	};
+	while (numSelected < maxPoints)
+	{
+		unsigned int edge;
+		const int i = selectBest([&](unsigned int i) { return areaGain(i, edge); });
+		if (i < 0)
+			break;
+		// insert the point after the start of the edge
+		areaGain(i, edge);
+		for (unsigned int k = numSelected; k > edge + 1; k--)
+			selected[k] = selected[k - 1];
+		selected[edge + 1] = i;
+		numSelected++;
+	}
+	return numSelected;
+}
+
+void DistanceFieldCollisionDetection::updateContactManifolds(SimulationModel &model)
+{
+	const SimulationModel::RigidBodyContactConstraintVector &contacts = model.getRigidBodyContactConstraints();
+	for (size_t i = 0; i < m_contactManifolds.size(); i++)
+	{
+		ContactManifold &manifold = m_contactManifolds[i];
+		if ((manifold.m_firstConstraint >= 0) && (manifold.m_firstConstraint + manifold.m_numPoints <= contacts.size()))
+		{
+			for (unsigned int k = 0; k < manifold.m_numPoints; k++)
+				manifold.m_impulse[k] = std::max(contacts[manifold.m_firstConstraint + k].m_sum_impulses, static_cast<Real>(0.0));
+		}
+		else if (!manifold.m_resting)
+			manifold.m_numPoints = 0;
+		manifold.m_thread = -1;
+		manifold.m_firstConstraint = -1;
+		manifold.m_resting = false;
+	}
+}
+
+void DistanceFieldCollisionDetection::warmStartContacts(SimulationModel &model)
+{
+	SimulationModel::RigidBodyContactConstraintVector &contacts = model.getRigidBodyContactConstraints();
+
+	// the rigid body contacts are stored in the model in the order of the threads
+	std::vector<unsigned int> offsets(m_rigidBodyContactCount_mt.size() + 1, 0);
+	for (size_t t = 0; t < m_rigidBodyContactCount_mt.size(); t++)
+		offsets[t + 1] = offsets[t] + m_rigidBodyContactCount_mt[t];
+
+	for (size_t i = 0; i < m_contactManifolds.size(); i++)
+	{
+		ContactManifold &manifold = m_contactManifolds[i];
+		if ((manifold.m_thread < 0) || (manifold.m_numPoints == 0))
+			continue;
+		const unsigned int first = offsets[manifold.m_thread] + manifold.m_firstContact;
+		if (first + manifold.m_numPoints > contacts.size())
+			continue;
+		// the contacts of both directions link the two bodies in different order
+		const unsigned int body1 = manifold.m_co1->m_bodyIndex;
+		const unsigned int body2 = manifold.m_co2->m_bodyIndex;
+		bool valid = true;
+		for (unsigned int k = 0; k < manifold.m_numPoints; k++)
+		{
+			const unsigned int *bodies = contacts[first + k].m_bodies;
+			if (!(((bodies[0] == body1) && (bodies[1] == body2)) || ((bodies[0] == body2) && (bodies[1] == body1))))
+				valid = false;
+		}
+		if (!valid)
+			continue;
+		manifold.m_firstConstraint = (int)first;
+		for (unsigned int k = 0; k < manifold.m_numPoints; k++)
+			contacts[first + k].m_sum_impulses = manifold.m_impulse[k];
+	}
 }
 
 
@@ -291,6 +682,7 @@ void DistanceFieldCollisionDetection::collisionDetectionRBSolid(const ParticleDa
 	DistanceFieldCollisionObject *co1, RigidBody *rb2, DistanceFieldCollisionObject *co2, 
 	const Real restitutionCoeff, const Real frictionCoeff
 	, std::vector<std::vector<ContactData> > &contacts_mt
+	, DistanceCache *cache
 	)
 {
 	const Vector3r &com2 = rb2->getPosition();
@@ -343,12 +735,21 @@ void DistanceFieldCollisionDetection::collisionDetectionRBSolid(const ParticleDa
 
 		for (auto i = node.begin; i < node.begin + node.n; ++i)
 		{
-			unsigned int index = bvh.entity(i) + offset;
+			const unsigned int localIndex = bvh.entity(i);
+			unsigned int index = localIndex + offset;
 			const Vector3r &x_w = pd.getPosition(index);
 			const Vector3r x = R * (x_w - com2) + v1;
+			if ((cache != nullptr) && cache->isFar(localIndex, x, m_distanceCacheTolerance))
+				continue;
 			Vector3r cp, n;
-			Real dist;
-			if (co2->collisionTest(x, m_tolerance, cp, n, dist))
+			Real dist = 0.0;
+			const bool collision = co2->collisionTest(x, m_tolerance, cp, n, dist);
+			if (cache != nullptr)
+			{
+				cache->m_x[localIndex] = x;
+				cache->m_dist[localIndex] = dist;
+			}
+			if (collision)
 			{
 				const Vector3r cp_w = R.transpose() * cp + v2;
 				const Vector3r n_w = R.transpose() * n;
@@ -838,6 +1239,29 @@ void DistanceFieldCollisionDetection::DistanceFieldCollisionObject::approximateN
 }
 
 
+void DistanceFieldCollisionDetection::ContactManifold::init(const CollisionObject *co1, const CollisionObject *co2)
+{
+	if ((m_co1 == co1) && (m_co2 == co2))
+		return;
+	m_co1 = co1;
+	m_co2 = co2;
+	m_numPoints = 0;
+	m_thread = -1;
+	m_firstConstraint = -1;
+	m_resting = false;
+}
+
+void DistanceFieldCollisionDetection::DistanceCache::init(const CollisionObject *co1, const CollisionObject *co2, const unsigned int numPoints)
+{
+	if ((m_co1 == co1) && (m_co2 == co2) && (m_dist.size() == numPoints))
+		return;
+	// a distance of zero forces an evaluation of the distance field
+	m_co1 = co1;
+	m_co2 = co2;
+	m_x.assign(numPoints, Vector3r::Zero());
+	m_dist.assign(numPoints, 0.0);
+}
+
 bool DistanceFieldCollisionDetection::DistanceFieldCollisionObject::collisionTest(const Vector3r &x, const Real tolerance, Vector3r &cp, Vector3r &n, Real &dist, const Real maxDist)
 {
 	const Real t_d = static_cast<Real>(tolerance);
@@ -122,15 +122,76 @@ namespace PBD
 			Vector3r m_bary2;
 		};
 
+		/** Distances of the points of a collision object to the distance field of another
+		 * collision object which were determined in the last evaluation. Since a distance field 
+		 * changes by at most the displacement of the query point, the evaluation can be skipped 
+		 * as long as a point did not move further than its last distance. Therefore, collisionTest()
+		 * must return a lower bound of the distance in world space in dist, also if there is no contact.
+		 */
+		struct DistanceCache
+		{
+			const CollisionObject *m_co1;
+			const CollisionObject *m_co2;
+			/** query points in the local coordinates of the distance field */
+			std::vector<Vector3r> m_x;
+			std::vector<Real> m_dist;
+
+			DistanceCache() { m_co1 = nullptr; m_co2 = nullptr; }
+			void init(const CollisionObject *co1, const CollisionObject *co2, const unsigned int numPoints);
+			bool isFar(const unsigned int index, const Vector3r &x, const Real tolerance) const
+			{
+				return (x - m_x[index]).norm() < m_dist[index] - tolerance;
+			}
+		};
+
+		/** Reduced set of contact points of a pair of rigid bodies. The contacts of both directions
+		 * (vertices of body 1 in the field of body 2 and vice versa) share one manifold. The manifold is 
+		 * kept between the time steps, so that the same points can be selected again and their 
+		 * accumulated impulses can be used to warm start the velocity solver.
+		 */
+		struct ContactManifold
+		{
+			static const unsigned int MAX_POINTS = 8;
+
+			const CollisionObject *m_co1;
+			const CollisionObject *m_co2;
+			unsigned int m_numPoints;
+			/** keys of the colliding vertices (2 * vertex index, plus 1 for the vertices of body 2) 
+			 * and the accumulated normal impulses of their contacts */
+			unsigned int m_vertexIndex[MAX_POINTS];
+			Real m_impulse[MAX_POINTS];
+			/** thread which found the contacts in the current step (-1 if the pair had no contacts)
+			 * and the index of the first contact among the rigid body contacts of the thread */
+			int m_thread;
+			unsigned int m_firstContact;
+			/** index of the first contact constraint in the simulation model, -1 if unknown */
+			int m_firstConstraint;
+			/** true if the pair is at rest (sleeping) in the current step, its points are kept */
+			bool m_resting;
+
+			ContactManifold() { m_co1 = nullptr; m_co2 = nullptr; m_numPoints = 0; m_thread = -1; m_firstContact = 0; m_firstConstraint = -1; m_resting = false; }
+			void init(const CollisionObject *co1, const CollisionObject *co2);
+		};
+
 	protected:
 		void collisionDetectionRigidBodies(RigidBody *rb1, DistanceFieldCollisionObject *co1, RigidBody *rb2, DistanceFieldCollisionObject *co2,
 			const Real restitutionCoeff, const Real frictionCoeff
 			, std::vector<std::vector<ContactData> > &contacts_mt
+			, DistanceCache *cache = nullptr
+			, std::vector<ContactData> *candidates = nullptr
+			);
+		/** Collision detection of both directions of a pair of rigid bodies with contact reduction. */
+		void collisionDetectionRigidBodyPair(RigidBody *rb1, DistanceFieldCollisionObject *co1, RigidBody *rb2, DistanceFieldCollisionObject *co2,
+			const Real restitutionCoeff, const Real frictionCoeff
+			, std::vector<std::vector<ContactData> > &contacts_mt
+			, DistanceCache *cache1, DistanceCache *cache2
+			, ContactManifold &manifold
 			);
 		void collisionDetectionRBSolid(const ParticleData &pd, const unsigned int offset, const unsigned int numVert, 
 			DistanceFieldCollisionObject *co1, RigidBody *rb2, DistanceFieldCollisionObject *co2, 
 			const Real restitutionCoeff, const Real frictionCoeff
 			, std::vector<std::vector<ContactData> > &contacts_mt
+			, DistanceCache *cache = nullptr
 			);
 
 		void collisionDetectionSolidSolid(const ParticleData &pd, const unsigned int offset, const unsigned int numVert,
@@ -147,6 +208,42 @@ namespace PBD
 		bool findRefTetAt(const ParticleData &pd, TetModel *tm, const DistanceFieldCollisionDetection::DistanceFieldCollisionObject *co, const Vector3r &X, 
 			unsigned int &tetIndex, Vector3r &barycentricCoordinates);
 
+		/** Contacts found by each thread. The buffers are kept between the time steps to reuse their memory. */
+		std::vector<std::vector<ContactData> > m_contacts_mt;
+		/** Prefix sums of the number of contacts per thread for each contact type */
+		std::vector<unsigned int> m_contactOffsets[3];
+		bool m_parallelContactMerge;
+		bool m_useDistanceCache;
+		Real m_distanceCacheTolerance;
+		/** One distance cache per pair of collision objects */
+		std::vector<DistanceCache> m_distanceCaches;
+		bool m_contactReduction;
+		unsigned int m_maxContactsPerPair;
+		/** One contact manifold per unordered pair of collision objects, stored at the index of the pair (i, k) with i < k */
+		std::vector<ContactManifold> m_contactManifolds;
+		/** Candidates of the contact reduction and number of rigid body contacts of each thread */
+		std::vector<std::vector<ContactData> > m_manifoldCandidates_mt;
+		std::vector<unsigned int> m_rigidBodyContactCount_mt;
+
+		/** Select at most maxPoints of the candidate contacts: the deepest contact and the contacts
+		 * which span the largest area in the contact plane. Points of the last manifold are preferred
+		 * if their score is close to the best one. Returns the number of selected contacts.
+		 */
+		unsigned int reduceContacts(const std::vector<ContactData> &candidates, const ContactManifold &manifold,
+			const unsigned int maxPoints, unsigned int *selected) const;
+		/** Read the accumulated impulses of the contacts of the last step from the simulation model. */
+		void updateContactManifolds(SimulationModel &model);
+		/** Initialize the accumulated impulses of the new contact constraints by the manifolds. */
+		void warmStartContacts(SimulationModel &model);
+
+		/** Pass the contacts of all threads to the contact callbacks. */
+		void addContacts();
+		/** Construct the contact constraints directly in the simulation model. The constraints of each
+		 * thread are initialized in parallel at offsets given by the prefix sums of the contact counts.
+		 * Returns false if a constraint could not be initialized.
+		 */
+		bool addContactsParallel(SimulationModel &model);
+
 
 	public:
 		DistanceFieldCollisionDetection();
@@ -156,6 +253,35 @@ namespace PBD
 
 		virtual bool isDistanceFieldCollisionObject(CollisionObject *co) const;
 
+		/** If enabled, the contact constraints are constructed in parallel in the simulation model 
+		 * which is passed to collisionDetection(). This is only done if the default callbacks of the
+		 * TimeStep are installed (see CollisionDetection::hasDefaultContactCallbacks()). Otherwise 
+		 * each contact is passed to the contact callbacks.
+		 */
+		bool getParallelContactMerge() const { return m_parallelContactMerge; }
+		void setParallelContactMerge(bool val) { m_parallelContactMerge = val; }
+
+		/** If enabled, the distance of each point of a deformable or rigid body to a
+		 * distance field is cached and the distance field is only evaluated again when the point 
+		 * could have reached the surface. The tolerance accounts for interpolation errors and 
+		 * non-uniform scaling of the distance fields.
+		 */
+		bool getUseDistanceCache() const { return m_useDistanceCache; }
+		void setUseDistanceCache(bool val) { m_useDistanceCache = val; m_distanceCaches.clear(); }
+		Real getDistanceCacheTolerance() const { return m_distanceCacheTolerance; }
+		void setDistanceCacheTolerance(Real val) { m_distanceCacheTolerance = val; }
+
+		/** If enabled, the contacts of each pair of rigid bodies (of both directions) are reduced to a manifold of at most
+		 * maxContactsPerPair (3 to 8) points, so that the cost of the contact handling does not depend
+		 * on the mesh resolution. The manifolds are kept between the time steps to warm start the
+		 * contact impulses. The warm start requires that the contacts are added to the simulation model
+		 * in the order in which they are found (parallel contact merge or the default callback).
+		 */
+		bool getContactReduction() const { return m_contactReduction; }
+		void setContactReduction(bool val) { m_contactReduction = val; m_contactManifolds.clear(); }
+		unsigned int getMaxContactsPerPair() const { return m_maxContactsPerPair; }
+		void setMaxContactsPerPair(unsigned int val) { m_maxContactsPerPair = std::min(std::max(val, 3u), (unsigned int) ContactManifold::MAX_POINTS); }
+
 		void addCollisionBox(const unsigned int bodyIndex, const unsigned int bodyType, const Vector3r *vertices, const unsigned int numVertices, const Vector3r &box, const bool testMesh = true, const bool invertSDF = false);
 		void addCollisionSphere(const unsigned int bodyIndex, const unsigned int bodyType, const Vector3r *vertices, const unsigned int numVertices, const Real radius, const bool testMesh = true, const bool invertSDF = false);
 		void addCollisionTorus(const unsigned int bodyIndex, const unsigned int bodyType, const Vector3r *vertices, const unsigned int numVertices, const Vector2r &radii, const bool testMesh = true, const bool invertSDF = false);
@@ -0,0 +1,206 @@
+#include "FluidRigidBodyCoupling.h"
+#include "Simulation/NeighborhoodSearchSpatialHashing.h"
+#include "PositionBasedDynamics/SPHKernels.h"
+#include <set>
+#include <array>
+#include <cmath>
+
+using namespace PBD;
+using namespace Utilities;
+
+FluidRigidBodyCoupling::FluidRigidBodyCoupling(SimulationModel *model)
+{
+	m_model = model;
+	m_numForceSteps = 0;
+}
+
+FluidRigidBodyCoupling::~FluidRigidBodyCoupling()
+{
+}
+
+void FluidRigidBodyCoupling::reset()
+{
+	for (size_t i = 0; i < m_bodies.size(); i++)
+	{
+		m_force[i].setZero();
+		m_torque[i].setZero();
+	}
+	m_numForceSteps = 0;
+	updateBoundary();
+}
+
+void FluidRigidBodyCoupling::sampleSurface(const VertexData &vd, const IndexedFaceMesh &mesh, const Real spacing, std::vector<Vector3r> &samples)
+{
+	const IndexedFaceMesh::Faces &faces = mesh.getFaces();
+	const unsigned int nFaces = mesh.numFaces();
+
+	// samples on shared edges and vertices are only added once
+	std::set<std::array<long long, 3>> keys;
+	const Real factor = static_cast<Real>(4.0) / spacing;
+	for (unsigned int f = 0; f < nFaces; f++)
+	{
+		const Vector3r &a = vd.getPosition(faces[3 * f]);
+		const Vector3r &b = vd.getPosition(faces[3 * f + 1]);
+		const Vector3r &c = vd.getPosition(faces[3 * f + 2]);
+		const Real maxEdge = std::max((b - a).norm(), std::max((c - b).norm(), (a - c).norm()));
+		const unsigned int n = std::max(1u, (unsigned int) std::ceil(maxEdge / spacing));
+		const Real step = static_cast<Real>(1.0) / static_cast<Real>(n);
+		for (unsigned int i = 0; i <= n; i++)
+		{
+			for (unsigned int j = 0; i + j <= n; j++)
+			{
+				const Vector3r x = a + (i*step)*(b - a) + (j*step)*(c - a);
+				const std::array<long long, 3> key = { { (long long) std::floor(x[0] * factor + 0.5), (long long) std::floor(x[1] * factor + 0.5), (long long) std::floor(x[2] * factor + 0.5) } };
+				if (keys.insert(key).second)
+					samples.push_back(x);
+			}
+		}
+	}
+}
+
+void FluidRigidBodyCoupling::addRigidBody(const unsigned int rigidBodyIndex, const Real spacing, const Real supportRadius)
+{
+	RigidBody *rb = m_model->getRigidBodies()[rigidBodyIndex];
+	std::vector<Vector3r> samples;
+	sampleSurface(rb->getGeometry().getVertexDataLocal(), rb->getGeometry().getMesh(), spacing, samples);
+	addRigidBody(rigidBodyIndex, samples, supportRadius);
+}
+
+void FluidRigidBodyCoupling::addRigidBody(const unsigned int rigidBodyIndex, const std::vector<Vector3r> &samples, const Real supportRadius)
+{
+	RigidBody *rb = m_model->getRigidBodies()[rigidBodyIndex];
+	const unsigned int nSamples = (unsigned int)samples.size();
+	rb->getGeometry().initBoundarySamples(nSamples, samples.data());
+	rb->getGeometry().updateMeshTransformation(rb->getPosition(), rb->getRotationMatrix());
+
+	Body body;
+	body.m_rigidBodyIndex = rigidBodyIndex;
+	body.m_offset = (unsigned int)m_x.size();
+	body.m_numSamples = nSamples;
+	m_bodies.push_back(body);
+	m_force.push_back(Vector3r::Zero());
+	m_torque.push_back(Vector3r::Zero());
+
+	m_x.resize(body.m_offset + nSamples);
+	m_volume.resize(body.m_offset + nSamples);
+	m_sampleBody.resize(body.m_offset + nSamples, (unsigned int)m_bodies.size() - 1);
+	for (unsigned int i = 0; i < nSamples; i++)
+		m_x[body.m_offset + i] = rb->getGeometry().getBoundarySamples().getPosition(i);
+
+	if (nSamples == 0)
+		return;
+
+	//////////////////////////////////////////////////////////////////////////
+	// Compute the volumes of the boundary particles (Akinci2012)
+	//////////////////////////////////////////////////////////////////////////
+	std::vector<Vector3r> x(samples);
+	NeighborhoodSearchSpatialHashing neighborhoodSearchSH(nSamples, supportRadius);
+	neighborhoodSearchSH.neighborhoodSearch(&x[0]);
+	unsigned int **neighbors = neighborhoodSearchSH.getNeighbors();
+	unsigned int *numNeighbors = neighborhoodSearchSH.getNumNeighbors();
+
+	#pragma omp parallel default(shared)
+	{
+		#pragma omp for schedule(static)
+		for (int i = 0; i < (int)nSamples; i++)
+		{
+			Real delta = CubicKernel::W(Vector3r::Zero(), supportRadius);
+			for (unsigned int j = 0; j < numNeighbors[i]; j++)
+				delta += CubicKernel::W(x[i] - x[neighbors[i][j]], supportRadius);
+			m_volume[body.m_offset + i] = static_cast<Real>(1.0) / delta;
+		}
+	}
+}
+
+void FluidRigidBodyCoupling::updateBoundary()
+{
+	SimulationModel::RigidBodyVector &rb = m_model->getRigidBodies();
+	const int numBodies = (int)m_bodies.size();
+	#pragma omp parallel default(shared)
+	{
+		#pragma omp for schedule(static)
+		for (int i = 0; i < numBodies; i++)
+		{
+			const Body &body = m_bodies[i];
+			const VertexData &samples = rb[body.m_rigidBodyIndex]->getGeometry().getBoundarySamples();
+			for (unsigned int j = 0; j < body.m_numSamples; j++)
+				m_x[body.m_offset + j] = samples.getPosition(j);
+		}
+	}
+}
+
+void FluidRigidBodyCoupling::computeForces(const unsigned int numFluidParticles, const Vector3r x[], const Real mass[], const Real lambda[],
+	unsigned int **neighbors, const unsigned int *numNeighbors, const unsigned int boundaryOffset, const Real density0, const Real h)
+{
+	SimulationModel::RigidBodyVector &rb = m_model->getRigidBodies();
+	const unsigned int numBodies = (unsigned int)m_bodies.size();
+	const unsigned int numSamples = (unsigned int)m_x.size();
+	const unsigned int firstIndex = numFluidParticles + boundaryOffset;
+	const Real invH2 = static_cast<Real>(1.0) / (h*h);
+
+	#pragma omp parallel default(shared)
+	{
+		// forces and torques of each thread
+		std::vector<Vector3r> force(numBodies, Vector3r::Zero());
+		std::vector<Vector3r> torque(numBodies, Vector3r::Zero());
+
+		#pragma omp for schedule(static) nowait
+		for (int i = 0; i < (int)numFluidParticles; i++)
+		{
+			for (unsigned int j = 0; j < numNeighbors[i]; j++)
+			{
+				const unsigned int neighborIndex = neighbors[i][j];
+				if ((neighborIndex < firstIndex) || (neighborIndex >= firstIndex + numSamples))
+					continue;
+				const unsigned int sampleIndex = neighborIndex - firstIndex;
+				const Vector3r &xb = m_x[sampleIndex];
+				const Real psi = density0 * m_volume[sampleIndex];
+				const Vector3r corr = lambda[i] * (psi / density0) * CubicKernel::gradW(x[i] - xb);
+				const Vector3r f = -mass[i] * invH2 * corr;
+
+				const unsigned int bodyIndex = m_sampleBody[sampleIndex];
+				force[bodyIndex] += f;
+				torque[bodyIndex] += (xb - rb[m_bodies[bodyIndex].m_rigidBodyIndex]->getPosition()).cross(f);
+			}
+		}
+
+		#pragma omp critical
+		{
+			for (unsigned int k = 0; k < numBodies; k++)
+			{
+				m_force[k] += force[k];
+				m_torque[k] += torque[k];
+			}
+		}
+	}
+	m_numForceSteps++;
+}
+
+void FluidRigidBodyCoupling::applyForces()
+{
+	if (m_numForceSteps == 0)
+		return;
+
+	SimulationModel::RigidBodyVector &rb = m_model->getRigidBodies();
+	const Real factor = static_cast<Real>(1.0) / static_cast<Real>(m_numForceSteps);
+	for (size_t k = 0; k < m_bodies.size(); k++)
+	{
+		RigidBody *body = rb[m_bodies[k].m_rigidBodyIndex];
+		if ((body->getMass() != 0.0) && !m_force[k].isZero())
+		{
+			body->getAcceleration() += factor * body->getInvMass() * m_force[k];
+			body->getTorque() += factor * m_torque[k];
+			// bodies which interact with the fluid are kept awake
+			body->wakeUp();
+		}
+		m_force[k].setZero();
+		m_torque[k].setZero();
+	}
+	m_numForceSteps = 0;
+}
+
+void FluidRigidBodyCoupling::forceCallback(void *userData)
+{
+	FluidRigidBodyCoupling *coupling = (FluidRigidBodyCoupling*)userData;
+	coupling->applyForces();
+}
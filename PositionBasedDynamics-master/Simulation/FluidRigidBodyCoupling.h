@@ -0,0 +1,91 @@
+#ifndef __FLUIDRIGIDBODYCOUPLING_H__
+#define __FLUIDRIGIDBODYCOUPLING_H__
+
+#include "Common/Common.h"
+#include "Simulation/SimulationModel.h"
+#include <vector>
+
+namespace PBD
+{
+	/** Two-way coupling of position based fluids and rigid bodies (Akinci et al. 2012,
+	 * "Versatile rigid-fluid coupling for incompressible SPH").
+	 *
+	 * The surfaces of the coupled rigid bodies are sampled by boundary particles which are stored in
+	 * the RigidBodyGeometry and are moved by setTransformation(). The fluid solver uses them
+	 * as moving boundary particles with the volume-weighted mass psi = density0 * volume. The boundary
+	 * particles get the indices numFluidParticles + boundaryOffset + i in the neighborhood lists.
+	 * The position corrections of the fluid particles which are caused by the boundary particles
+	 * are converted to forces and torques that act on the rigid bodies.
+	 */
+	class FluidRigidBodyCoupling
+	{
+	public:
+		/** Boundary particles of one rigid body */
+		struct Body
+		{
+			unsigned int m_rigidBodyIndex;
+			/** Index of the first boundary particle of the body */
+			unsigned int m_offset;
+			unsigned int m_numSamples;
+		};
+
+	protected:
+		SimulationModel *m_model;
+		std::vector<Body> m_bodies;
+		/** Positions, volumes and body index of all boundary particles */
+		std::vector<Vector3r> m_x;
+		std::vector<Real> m_volume;
+		std::vector<unsigned int> m_sampleBody;
+		/** Forces and torques which are accumulated during the fluid step(s) */
+		std::vector<Vector3r> m_force;
+		std::vector<Vector3r> m_torque;
+		unsigned int m_numForceSteps;
+
+	public:
+		FluidRigidBodyCoupling(SimulationModel *model);
+		~FluidRigidBodyCoupling();
+
+		/** Sample the surface of a rigid body with the given spacing of the boundary particles
+		 * and add the body to the coupling. The kernel radius is required to determine the volumes
+		 * of the boundary particles.
+		 */
+		void addRigidBody(const unsigned int rigidBodyIndex, const Real spacing, const Real supportRadius);
+		/** Add a rigid body with given boundary particles in the local coordinate system of the body. */
+		void addRigidBody(const unsigned int rigidBodyIndex, const std::vector<Vector3r> &samples, const Real supportRadius);
+
+		/** Sample the triangles of a mesh so that the distance of the samples is about the given spacing. */
+		static void sampleSurface(const VertexData &vd, const Utilities::IndexedFaceMesh &mesh, const Real spacing, std::vector<Vector3r> &samples);
+
+		/** Copy the boundary particle positions from the rigid body geometries. */
+		void updateBoundary();
+
+		/** Accumulate the forces which the fluid particles exert on the rigid bodies. The forces are
+		 * determined by the boundary terms of the position based density constraints:\n\n
+		 * \f$\Delta \mathbf x_{ib} = \lambda_i \frac{\psi_b}{\rho_0} \nabla W_{ib}, \quad \mathbf f_b = -\frac{m_i}{h^2} \Delta \mathbf x_{ib}\f$
+		 *
+		 * @param lambda sum of the Lagrange multipliers of all solver iterations, the kernel gradients are evaluated at the final positions
+		 * @param boundaryOffset number of boundary particles in the neighborhood lists before the first coupled boundary particle
+		 */
+		void computeForces(const unsigned int numFluidParticles, const Vector3r x[], const Real mass[], const Real lambda[],
+			unsigned int **neighbors, const unsigned int *numNeighbors, const unsigned int boundaryOffset, const Real density0, const Real h);
+
+		/** Add the mean force and torque of all fluid steps since the last call to the accelerations
+		 * and torques of the rigid bodies and reset the accumulated forces.
+		 */
+		void applyForces();
+		/** Callback for TimeStep::setForceCallback() which calls applyForces(). */
+		static void forceCallback(void *userData);
+
+		void reset();
+
+		unsigned int numBoundaryParticles() const { return (unsigned int)m_x.size(); }
+		const Vector3r *getBoundaryX() const { return m_x.data(); }
+		const Vector3r &getBoundaryX(const unsigned int i) const { return m_x[i]; }
+		Real getBoundaryVolume(const unsigned int i) const { return m_volume[i]; }
+		const std::vector<Body> &getBodies() const { return m_bodies; }
+		const Vector3r &getForce(const unsigned int bodyIndex) const { return m_force[bodyIndex]; }
+		const Vector3r &getTorque(const unsigned int bodyIndex) const { return m_torque[bodyIndex]; }
+	};
+}
+
+#endif
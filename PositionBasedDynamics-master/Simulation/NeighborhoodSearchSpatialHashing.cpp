@@ -1,4 +1,6 @@
 #include "NeighborhoodSearchSpatialHashing.h"
+#include <algorithm>
+#include <cmath>
 
 using namespace PBD;
 using namespace Utilities;
@@ -24,6 +26,13 @@ NeighborhoodSearchSpatialHashing::NeighborhoodSearchSpatialHashing(const unsigne
 	}
 
 	m_currentTimestamp = 0;
+	m_boundaryGridMap = NULL;
+	m_skin = 0.0;
+	m_maxVerletNeighbors = m_maxNeighbors;
+	m_verletValid = false;
+	m_numVerletRebuilds = 0;
+	m_numDynamicBoundaryParticles = 0;
+	m_dynamicBoundaryX = NULL;
 }
 
 NeighborhoodSearchSpatialHashing::~NeighborhoodSearchSpatialHashing()
@@ -52,6 +61,35 @@ void NeighborhoodSearchSpatialHashing::cleanup()
 			}
 		}
 	}
+
+	cleanupBoundaryGrid();
+	m_boundaryX.clear();
+	m_verletNeighbors.clear();
+	m_numVerletNeighbors.clear();
+	m_verletX.clear();
+	m_verletDynamicX.clear();
+	m_verletValid = false;
+}
+
+void NeighborhoodSearchSpatialHashing::cleanupBoundaryGrid()
+{
+	if (m_boundaryGridMap == NULL)
+		return;
+
+	for (unsigned int i = 0; i < m_boundaryGridMap->bucket_count(); i++)
+	{
+		Hashmap<NeighborhoodSearchCellPos*, NeighborhoodSearchSpatialHashing::HashEntry*>::KeyValueMap *kvMap = m_boundaryGridMap->getKeyValueMap(i);
+		if (kvMap)
+		{
+			for (Hashmap<NeighborhoodSearchCellPos*, NeighborhoodSearchSpatialHashing::HashEntry*>::KeyValueMap::iterator iter = kvMap->begin(); iter != kvMap->end(); iter++)
+			{
+				delete iter->second;
+				iter->second = NULL;
+			}
+		}
+	}
+	delete m_boundaryGridMap;
+	m_boundaryGridMap = NULL;
 }
 
 unsigned int ** NeighborhoodSearchSpatialHashing::getNeighbors() const
@@ -71,8 +109,29 @@ unsigned int NeighborhoodSearchSpatialHashing::getNumParticles() const
 
 void NeighborhoodSearchSpatialHashing::setRadius(const Real radius)
 {
-	m_cellGridSize = radius;
+	// the cells must contain all neighbors within radius + skin
+	const Real cellGridSize = radius + m_skin;
+	const bool changed = (m_cellGridSize != cellGridSize);
+	m_cellGridSize = cellGridSize;
 	m_radius2 = radius*radius;
+	m_verletValid = false;
+
+	// the cells of the boundary grid depend on the radius
+	if (changed && (m_boundaryGridMap != NULL))
+		buildBoundaryGrid();
+}
+
+void NeighborhoodSearchSpatialHashing::setSkin(const Real skin)
+{
+	if (skin == m_skin)
+		return;
+	const Real radius = getRadius();
+	m_skin = std::max(skin, static_cast<Real>(0.0));
+
+	// the number of neighbors grows with the volume of the search sphere
+	const Real factor = (radius + m_skin) / radius;
+	m_maxVerletNeighbors = (unsigned int) std::ceil(m_maxNeighbors * factor*factor*factor);
+	setRadius(radius);
 }
 
 Real NeighborhoodSearchSpatialHashing::getRadius() const
@@ -85,9 +144,8 @@ void NeighborhoodSearchSpatialHashing::update()
 	m_currentTimestamp++;
 }
 
-
-void NeighborhoodSearchSpatialHashing::neighborhoodSearch(Vector3r *x) 
-{		
+void NeighborhoodSearchSpatialHashing::insertParticles(Vector3r *x)
+{
 	const Real factor = static_cast<Real>(1.0)/m_cellGridSize;
 	for (int i=0; i < (int) m_numParticles; i++)
 	{
@@ -114,6 +172,43 @@ void NeighborhoodSearchSpatialHashing::neighborhoodSearch(Vector3r *x)
 		}
 		entry->particleIndices.push_back(i);
 	}
+}
+
+void NeighborhoodSearchSpatialHashing::setBoundaryParticles(const unsigned int numBoundaryParticles, const Vector3r *boundaryX)
+{
+	m_boundaryX.assign(boundaryX, boundaryX + numBoundaryParticles);
+	buildBoundaryGrid();
+}
+
+void NeighborhoodSearchSpatialHashing::buildBoundaryGrid()
+{
+	cleanupBoundaryGrid();
+	const unsigned int numBoundaryParticles = (unsigned int) m_boundaryX.size();
+	m_boundaryGridMap = new Hashmap<NeighborhoodSearchCellPos*, HashEntry*>(std::max(numBoundaryParticles * 2u, 1u));
+
+	// The entries of the boundary grid are never invalidated, so the timestamp is not used.
+	const Real factor = static_cast<Real>(1.0) / m_cellGridSize;
+	for (unsigned int i = 0; i < numBoundaryParticles; i++)
+	{
+		const int cellPos1 = NeighborhoodSearchSpatialHashing::floor(m_boundaryX[i][0] * factor) + 1;
+		const int cellPos2 = NeighborhoodSearchSpatialHashing::floor(m_boundaryX[i][1] * factor) + 1;
+		const int cellPos3 = NeighborhoodSearchSpatialHashing::floor(m_boundaryX[i][2] * factor) + 1;
+		NeighborhoodSearchCellPos cellPos(cellPos1, cellPos2, cellPos3);
+		HashEntry *&entry = (*m_boundaryGridMap)[&cellPos];
+		if (entry == NULL)
+		{
+			entry = new HashEntry();
+			entry->timestamp = 0;
+		}
+		entry->particleIndices.push_back(i);
+	}
+}
+
+
+void NeighborhoodSearchSpatialHashing::neighborhoodSearch(Vector3r *x) 
+{		
+	const Real factor = static_cast<Real>(1.0)/m_cellGridSize;
+	insertParticles(x);
 
 	// loop over all 27 neighboring cells
 	#pragma omp parallel default(shared)
@@ -162,31 +257,7 @@ void NeighborhoodSearchSpatialHashing::neighborhoodSearch(Vector3r *x)
 void NeighborhoodSearchSpatialHashing::neighborhoodSearch(Vector3r *x, const unsigned int numBoundaryParticles, Vector3r *boundaryX)
 {		
 	const Real factor = static_cast<Real>(1.0)/m_cellGridSize;
-	for (int i=0; i < (int) m_numParticles; i++)
-	{
-		const int cellPos1 = NeighborhoodSearchSpatialHashing::floor(x[i][0] * factor)+1;
-		const int cellPos2 = NeighborhoodSearchSpatialHashing::floor(x[i][1] * factor)+1;
-		const int cellPos3 = NeighborhoodSearchSpatialHashing::floor(x[i][2] * factor)+1;
-		NeighborhoodSearchCellPos cellPos(cellPos1, cellPos2, cellPos3);
-		HashEntry *&entry = m_gridMap[&cellPos];
-
-		if (entry != NULL)
-		{
-			if (entry->timestamp != m_currentTimestamp)
-			{
-				entry->timestamp = m_currentTimestamp;
-				entry->particleIndices.clear();
-			}
-		}
-		else
-		{
-			HashEntry *newEntry = new HashEntry(); 	
-			newEntry->particleIndices.reserve(m_maxParticlesPerCell);
-			newEntry->timestamp = m_currentTimestamp; 
-			entry = newEntry;
-		}
-		entry->particleIndices.push_back(i);
-	}
+	insertParticles(x);
 
 	for (int i = 0; i < (int)numBoundaryParticles; i++)
 	{
@@ -261,4 +332,187 @@ void NeighborhoodSearchSpatialHashing::neighborhoodSearch(Vector3r *x, const uns
 			}
 		}
 	}
-}
\ No newline at end of file
+}
+
+void NeighborhoodSearchSpatialHashing::findNeighbors(Vector3r *x, const unsigned int i, const Real radius2, const unsigned int maxNeighbors, unsigned int *neighbors, unsigned int &numNeighbors)
+{
+	const Real factor = static_cast<Real>(1.0)/m_cellGridSize;
+	numNeighbors = 0;
+	const int cellPos1 = NeighborhoodSearchSpatialHashing::floor(x[i][0] * factor);
+	const int cellPos2 = NeighborhoodSearchSpatialHashing::floor(x[i][1] * factor);
+	const int cellPos3 = NeighborhoodSearchSpatialHashing::floor(x[i][2] * factor);
+	for(unsigned char j=0; j < 3; j++)
+	{				
+		for(unsigned char k=0; k < 3; k++)
+		{									
+			for(unsigned char l=0; l < 3; l++)
+			{
+				NeighborhoodSearchCellPos cellPos(cellPos1+j, cellPos2+k, cellPos3+l);
+				HashEntry * const *entry = m_gridMap.query(&cellPos);
+			
+				if ((entry != NULL) && (*entry != NULL) && ((*entry)->timestamp == m_currentTimestamp))
+				{
+					for (unsigned int m=0; m < (*entry)->particleIndices.size(); m++)
+					{
+						const unsigned int pi = (*entry)->particleIndices[m];
+						if (pi != i)
+						{
+							const Real dist2 = (x[i] - getNeighborPosition(x, pi)).squaredNorm();
+							if ((dist2 < radius2) && (numNeighbors < maxNeighbors))
+								neighbors[numNeighbors++] = pi;
+						}
+					}
+				}
+
+				if (m_boundaryGridMap == NULL)
+					continue;
+				HashEntry * const *boundaryEntry = m_boundaryGridMap->query(&cellPos);
+				if ((boundaryEntry != NULL) && (*boundaryEntry != NULL))
+				{
+					for (unsigned int m = 0; m < (*boundaryEntry)->particleIndices.size(); m++)
+					{
+						const unsigned int pi = (*boundaryEntry)->particleIndices[m];
+						const Real dist2 = (x[i] - m_boundaryX[pi]).squaredNorm();
+						if ((dist2 < radius2) && (numNeighbors < maxNeighbors))
+							neighbors[numNeighbors++] = m_numParticles + pi;
+					}
+				}
+			}
+		}
+	}
+}
+
+void NeighborhoodSearchSpatialHashing::neighborhoodSearchStaticBoundary(Vector3r *x)
+{
+	neighborhoodSearchStaticBoundary(x, 0, NULL);
+}
+
+void NeighborhoodSearchSpatialHashing::insertDynamicBoundaryParticles()
+{
+	const Real factor = static_cast<Real>(1.0) / m_cellGridSize;
+	const unsigned int offset = m_numParticles + (unsigned int)m_boundaryX.size();
+	for (unsigned int i = 0; i < m_numDynamicBoundaryParticles; i++)
+	{
+		const Vector3r &xi = m_dynamicBoundaryX[i];
+		const int cellPos1 = NeighborhoodSearchSpatialHashing::floor(xi[0] * factor) + 1;
+		const int cellPos2 = NeighborhoodSearchSpatialHashing::floor(xi[1] * factor) + 1;
+		const int cellPos3 = NeighborhoodSearchSpatialHashing::floor(xi[2] * factor) + 1;
+		NeighborhoodSearchCellPos cellPos(cellPos1, cellPos2, cellPos3);
+		HashEntry *&entry = m_gridMap[&cellPos];
+
+		if (entry != NULL)
+		{
+			if (entry->timestamp != m_currentTimestamp)
+			{
+				entry->timestamp = m_currentTimestamp;
+				entry->particleIndices.clear();
+			}
+		}
+		else
+		{
+			HashEntry *newEntry = new HashEntry();
+			newEntry->particleIndices.reserve(m_maxParticlesPerCell);
+			newEntry->timestamp = m_currentTimestamp;
+			entry = newEntry;
+		}
+		entry->particleIndices.push_back(offset + i);
+	}
+}
+
+void NeighborhoodSearchSpatialHashing::neighborhoodSearchStaticBoundary(Vector3r *x, const unsigned int numDynamicBoundaryParticles, const Vector3r *dynamicBoundaryX)
+{
+	m_numDynamicBoundaryParticles = numDynamicBoundaryParticles;
+	m_dynamicBoundaryX = dynamicBoundaryX;
+
+	if (m_skin > 0.0)
+	{
+		if (!m_verletValid || (m_verletDynamicX.size() != m_numDynamicBoundaryParticles) || 
+			(maxDisplacement(x) > static_cast<Real>(0.5)*m_skin))
+			buildVerletLists(x);
+
+		// filter the Verlet lists by the true distance
+		#pragma omp parallel default(shared)
+		{
+			#pragma omp for schedule(static)  
+			for (int i = 0; i < (int)m_numParticles; i++)
+			{
+				const unsigned int *verletNeighbors = &m_verletNeighbors[i * m_maxVerletNeighbors];
+				m_numNeighbors[i] = 0;
+				for (unsigned int j = 0; j < m_numVerletNeighbors[i]; j++)
+				{
+					const unsigned int pi = verletNeighbors[j];
+					const Vector3r &xj = getNeighborPosition(x, pi);
+					if (((x[i] - xj).squaredNorm() < m_radius2) && (m_numNeighbors[i] < m_maxNeighbors))
+						m_neighbors[i][m_numNeighbors[i]++] = pi;
+				}
+			}
+		}
+		return;
+	}
+
+	insertParticles(x);
+	insertDynamicBoundaryParticles();
+
+	// loop over all 27 neighboring cells of the particle grid and the static boundary grid
+	#pragma omp parallel default(shared)
+	{
+		#pragma omp for schedule(static)  
+		for (int i=0; i < (int) m_numParticles; i++)
+			findNeighbors(x, i, m_radius2, m_maxNeighbors, m_neighbors[i], m_numNeighbors[i]);
+	}
+}
+
+void NeighborhoodSearchSpatialHashing::buildVerletLists(Vector3r *x)
+{
+	insertParticles(x);
+	insertDynamicBoundaryParticles();
+	m_verletDynamicX.assign(m_dynamicBoundaryX, m_dynamicBoundaryX + m_numDynamicBoundaryParticles);
+
+	m_verletNeighbors.resize(m_numParticles * m_maxVerletNeighbors);
+	m_numVerletNeighbors.resize(m_numParticles);
+	m_verletX.resize(m_numParticles);
+	const Real searchRadius = getRadius() + m_skin;
+	const Real searchRadius2 = searchRadius*searchRadius;
+
+	#pragma omp parallel default(shared)
+	{
+		#pragma omp for schedule(static)  
+		for (int i = 0; i < (int)m_numParticles; i++)
+		{
+			findNeighbors(x, i, searchRadius2, m_maxVerletNeighbors, &m_verletNeighbors[i * m_maxVerletNeighbors], m_numVerletNeighbors[i]);
+			m_verletX[i] = x[i];
+		}
+	}
+	m_verletValid = true;
+	m_numVerletRebuilds++;
+}
+
+Real NeighborhoodSearchSpatialHashing::maxDisplacement(Vector3r *x) const
+{
+	Real maxDist2 = 0.0;
+	#pragma omp parallel default(shared)
+	{
+		// maximum of each thread
+		Real maxDist2_local = 0.0;
+		#pragma omp for schedule(static) nowait
+		for (int i = 0; i < (int)m_numParticles; i++)
+		{
+			const Real dist2 = (x[i] - m_verletX[i]).squaredNorm();
+			if (dist2 > maxDist2_local)
+				maxDist2_local = dist2;
+		}
+		#pragma omp for schedule(static) nowait
+		for (int i = 0; i < (int)m_numDynamicBoundaryParticles; i++)
+		{
+			const Real dist2 = (m_dynamicBoundaryX[i] - m_verletDynamicX[i]).squaredNorm();
+			if (dist2 > maxDist2_local)
+				maxDist2_local = dist2;
+		}
+		#pragma omp critical
+		{
+			if (maxDist2_local > maxDist2)
+				maxDist2 = maxDist2_local;
+		}
+	}
+	return sqrt(maxDist2);
+}
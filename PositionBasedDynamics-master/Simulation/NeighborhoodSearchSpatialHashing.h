@@ -43,12 +43,37 @@ namespace PBD
 		void cleanup();
 		void neighborhoodSearch(Vector3r *x);
 		void neighborhoodSearch(Vector3r *x, const unsigned int numBoundaryParticles, Vector3r *boundaryX);
+		/** Build the index of static boundary particles. The boundary particles are hashed once in a 
+		 * separate grid which is only rebuilt if the radius changes.
+		 */
+		void setBoundaryParticles(const unsigned int numBoundaryParticles, const Vector3r *boundaryX);
+		/** Neighborhood search which only hashes the particles x. The boundary neighbors are found
+		 * in the static boundary index and get the indices numParticles + i as in
+		 * neighborhoodSearch(x, numBoundaryParticles, boundaryX).
+		 */
+		void neighborhoodSearchStaticBoundary(Vector3r *x);
+		/** Neighborhood search with static and moving boundary particles. The moving boundary particles
+		 * are hashed in each search and get the indices numParticles + numStaticBoundaryParticles + i.
+		 */
+		void neighborhoodSearchStaticBoundary(Vector3r *x, const unsigned int numDynamicBoundaryParticles, const Vector3r *dynamicBoundaryX);
+		/** Set the skin distance of the Verlet lists. If the skin is positive, 
+		 * neighborhoodSearchStaticBoundary() searches all neighbors within radius + skin and only
+		 * repeats the search if a particle moved further than skin/2 since the last search.
+		 * Otherwise the neighbors are determined by filtering the stored Verlet lists.
+		 */
+		void setSkin(const Real skin);
+		Real getSkin() const { return m_skin; }
+		/** Force a new search of the Verlet lists, e.g. after the particles were reordered. */
+		void invalidateVerletLists() { m_verletValid = false; }
+		/** Number of searches of the Verlet lists */
+		unsigned int getNumVerletRebuilds() const { return m_numVerletRebuilds; }
 		void update();
 		unsigned int **getNeighbors() const;
 		unsigned int *getNumNeighbors() const;
 		const unsigned int getMaxNeighbors() const { return m_maxNeighbors;	}
 
 		unsigned int getNumParticles() const;
+		unsigned int getNumBoundaryParticles() const { return (unsigned int) m_boundaryX.size(); }
 		void setRadius(const Real radius);
 		Real getRadius() const;
 
@@ -63,6 +88,24 @@ namespace PBD
 
 
 	private: 
+		void insertParticles(Vector3r *x);
+		void insertDynamicBoundaryParticles();
+		FORCE_INLINE const Vector3r &getNeighborPosition(const Vector3r *x, const unsigned int index) const
+		{
+			if (index < m_numParticles)
+				return x[index];
+			const unsigned int boundaryIndex = index - m_numParticles;
+			if (boundaryIndex < m_boundaryX.size())
+				return m_boundaryX[boundaryIndex];
+			return m_dynamicBoundaryX[boundaryIndex - m_boundaryX.size()];
+		}
+		/** Find the neighbors of particle i (including the static boundary particles) in the 27 neighboring cells. */
+		void findNeighbors(Vector3r *x, const unsigned int i, const Real radius2, const unsigned int maxNeighbors, unsigned int *neighbors, unsigned int &numNeighbors);
+		void buildVerletLists(Vector3r *x);
+		Real maxDisplacement(Vector3r *x) const;
+		void buildBoundaryGrid();
+		void cleanupBoundaryGrid();
+
 		unsigned int m_numParticles;
 		unsigned int m_maxNeighbors;
 		unsigned int m_maxParticlesPerCell;
@@ -72,6 +115,21 @@ namespace PBD
 		Real m_radius2;
 		unsigned int m_currentTimestamp;
 		Utilities::Hashmap<NeighborhoodSearchCellPos*, HashEntry*> m_gridMap;
+		/** Static boundary particles and their grid which is built once */
+		std::vector<Vector3r> m_boundaryX;
+		Utilities::Hashmap<NeighborhoodSearchCellPos*, HashEntry*> *m_boundaryGridMap;
+		/** Moving boundary particles of the current search */
+		unsigned int m_numDynamicBoundaryParticles;
+		const Vector3r *m_dynamicBoundaryX;
+		/** Verlet lists: neighbors within radius + skin and the positions at the last search */
+		Real m_skin;
+		unsigned int m_maxVerletNeighbors;
+		std::vector<unsigned int> m_verletNeighbors;
+		std::vector<unsigned int> m_numVerletNeighbors;
+		std::vector<Vector3r> m_verletX;
+		std::vector<Vector3r> m_verletDynamicX;
+		bool m_verletValid;
+		unsigned int m_numVerletRebuilds;
 	};
 }
 
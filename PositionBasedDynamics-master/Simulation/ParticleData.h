@@ -283,6 +283,33 @@ namespace PBD
 				m_lastX.reserve(newSize);
 			}
 
+			/** Reorder the particle data so that particle i gets the data of particle order[i].
+			 */
+			FORCE_INLINE void permute(const std::vector<unsigned int> &order)
+			{
+				permuteArray(m_masses, order);
+				permuteArray(m_invMasses, order);
+				permuteArray(m_x0, order);
+				permuteArray(m_x, order);
+				permuteArray(m_v, order);
+				permuteArray(m_a, order);
+				permuteArray(m_oldX, order);
+				permuteArray(m_lastX, order);
+			}
+
+			template<class T>
+			static void permuteArray(std::vector<T> &data, const std::vector<unsigned int> &order)
+			{
+				std::vector<T> tmp(order.size());
+				#pragma omp parallel if(order.size() > MIN_PARALLEL_SIZE) default(shared)
+				{
+					#pragma omp for schedule(static)  
+					for (int i = 0; i < (int)order.size(); i++)
+						tmp[i] = data[order[i]];
+				}
+				data.swap(tmp);
+			}
+
 			/** Release the array containing the particle data.
 			 */
 			FORCE_INLINE void release()
@@ -63,6 +63,11 @@ namespace PBD
 			Real m_restitutionCoeff;
 			Real m_frictionCoeff;
 
+			/** A sleeping body is not integrated and its constraints are not projected */
+			bool m_sleeping;
+			/** time the body has been at rest */
+			Real m_restTime;
+
 			RigidBodyGeometry m_geometry;
 
 			// transformation required to transform a point to local space or vice vera
@@ -74,6 +79,8 @@ namespace PBD
 		public:
 			RigidBody(void) 
 			{
+				m_sleeping = false;
+				m_restTime = 0.0;
 			}
 
 			~RigidBody(void)
@@ -158,6 +165,7 @@ namespace PBD
 				getAcceleration().setZero();
 				getTorque().setZero();
 
+				wakeUp();
 				rotationUpdated();
 			}
 
@@ -223,6 +231,7 @@ namespace PBD
 				// rotate vertices back				
 				for (unsigned int i = 0; i < vd.size(); i++)
 					vd.getPosition(i) = R.transpose() * (vd.getPosition(i) - vi.getCenterOfMass());
+				m_geometry.updateLocalBounds();
 
 				// set rotation
 				Quaternionr qR = Quaternionr(R);
@@ -565,6 +574,27 @@ namespace PBD
 				m_frictionCoeff = val; 
 			}
 
+			FORCE_INLINE bool isSleeping() const
+			{
+				return m_sleeping;
+			}
+
+			FORCE_INLINE void setSleeping(bool val)
+			{
+				m_sleeping = val;
+			}
+
+			FORCE_INLINE Real &getRestTime()
+			{
+				return m_restTime;
+			}
+
+			FORCE_INLINE void wakeUp()
+			{
+				m_sleeping = false;
+				m_restTime = 0.0;
+			}
+
 			RigidBodyGeometry& getGeometry()
 			{
 				return m_geometry;
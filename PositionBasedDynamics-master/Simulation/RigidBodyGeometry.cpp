@@ -1,10 +1,15 @@
 #include "RigidBodyGeometry.h"
+#include <algorithm>
 
 using namespace PBD;
 
 RigidBodyGeometry::RigidBodyGeometry() :
 	m_mesh()
 {	
+	m_x.setZero();
+	m_R.setIdentity();
+	m_localRadius = 0.0;
+	m_vertexDataValid = true;
 }
 
 RigidBodyGeometry::~RigidBodyGeometry(void)
@@ -28,6 +33,10 @@ void RigidBodyGeometry::initMesh(const unsigned int nVertices, const unsigned in
 		m_vertexData_local.getPosition(i) = vertices[i].cwiseProduct(scale);
 		m_vertexData.getPosition(i) = m_vertexData_local.getPosition(i);
 	}
+	updateLocalBounds();
+	m_x.setZero();
+	m_R.setIdentity();
+	m_vertexDataValid = true;
 
 	for (unsigned int i = 0; i < nFaces; i++)
 	{
@@ -38,19 +47,77 @@ void RigidBodyGeometry::initMesh(const unsigned int nVertices, const unsigned in
 	updateMeshNormals(m_vertexData);
 }
 
+void RigidBodyGeometry::updateLocalBounds()
+{
+	m_localAABB.setEmpty();
+	Real r2 = 0.0;
+	for (unsigned int i = 0; i < m_vertexData_local.size(); i++)
+	{
+		m_localAABB.extend(m_vertexData_local.getPosition(i));
+		r2 = std::max(r2, m_vertexData_local.getPosition(i).squaredNorm());
+	}
+	m_localRadius = sqrt(r2);
+}
+
 void RigidBodyGeometry::updateMeshNormals(const VertexData &vd)
 {
 	m_mesh.updateNormals(vd, 0);
 	m_mesh.updateVertexNormals(vd);
 }
 
+void RigidBodyGeometry::initBoundarySamples(const unsigned int nSamples, const Vector3r *samples)
+{
+	m_boundarySamples_local.resize(nSamples);
+	m_boundarySamples.resize(nSamples);
+	for (unsigned int i = 0; i < nSamples; i++)
+	{
+		m_boundarySamples_local.getPosition(i) = samples[i];
+		m_boundarySamples.getPosition(i) = samples[i];
+	}
+}
+
 void RigidBodyGeometry::updateMeshTransformation(const Vector3r &x, const Matrix3r &R)
 {
+	setTransformation(x, R);
+	updateVertexData();
+}
+
+void RigidBodyGeometry::setTransformation(const Vector3r &x, const Matrix3r &R)
+{
+	m_x = x;
+	m_R = R;
+	m_vertexDataValid = false;
+	// the samples are required by the fluid solver in each step
+	for (unsigned int i = 0; i < m_boundarySamples_local.size(); i++)
+	{
+		m_boundarySamples.getPosition(i) = R * m_boundarySamples_local.getPosition(i) + x;
+	}
+}
+
+void RigidBodyGeometry::updateVertexData()
+{
+	if (m_vertexDataValid)
+		return;
 	for (unsigned int i = 0; i < m_vertexData_local.size(); i++)
 	{
-		m_vertexData.getPosition(i) = R * m_vertexData_local.getPosition(i) + x;
+		m_vertexData.getPosition(i) = m_R * m_vertexData_local.getPosition(i) + m_x;
 	}
 	updateMeshNormals(m_vertexData);
+	m_vertexDataValid = true;
+}
+
+void RigidBodyGeometry::computeAABB(Vector3r &p0, Vector3r &p1) const
+{
+	if (m_localAABB.isEmpty())
+	{
+		p0 = m_x;
+		p1 = m_x;
+		return;
+	}
+	const Vector3r c = m_R * m_localAABB.center() + m_x;
+	const Vector3r e = m_R.cwiseAbs() * (static_cast<Real>(0.5) * m_localAABB.sizes());
+	p0 = c - e;
+	p1 = c + e;
 }
 
 VertexData & RigidBodyGeometry::getVertexData()
@@ -20,6 +20,18 @@ namespace PBD
 			Mesh m_mesh;
 			VertexData m_vertexData_local;
 			VertexData m_vertexData;
+			/** Boundary samples of the surface for the coupling with SPH fluids */
+			VertexData m_boundarySamples_local;
+			VertexData m_boundarySamples;
+			/** Bounding box of the mesh in local coordinates */
+			AlignedBox3r m_localAABB;
+			/** Distance of the farthest vertex to the origin of the local coordinates */
+			Real m_localRadius;
+			/** Current transformation from local to world coordinates */
+			Vector3r m_x;
+			Matrix3r m_R;
+			/** True if the world space vertices and the normals belong to the current transformation */
+			bool m_vertexDataValid;
 
 		public:
 			Mesh &getMesh();
@@ -27,10 +39,41 @@ namespace PBD
 			const VertexData &getVertexData() const;
 			VertexData &getVertexDataLocal();
 			const VertexData &getVertexDataLocal() const;
+			VertexData &getBoundarySamples() { return m_boundarySamples; }
+			const VertexData &getBoundarySamples() const { return m_boundarySamples; }
+			const VertexData &getBoundarySamplesLocal() const { return m_boundarySamples_local; }
 
 			void initMesh(const unsigned int nVertices, const unsigned int nFaces, const Vector3r *vertices, const unsigned int* indices, const Mesh::UVIndices& uvIndices, const Mesh::UVs& uvs, const Vector3r &scale = Vector3r(1.0, 1.0, 1.0));
+			/** Recompute the bounding box and the radius after the local vertices were changed. */
+			void updateLocalBounds();
+			Real getLocalRadius() const { return m_localRadius; }
+			/** Set the boundary samples in the local coordinate system of the mesh. */
+			void initBoundarySamples(const unsigned int nSamples, const Vector3r *samples);
+			/** Set the transformation and transform the mesh immediately. */
 			void updateMeshTransformation(const Vector3r &x, const Matrix3r &R);
 			void updateMeshNormals(const VertexData &vd);
+
+			/** Set the transformation of the body. Only the boundary samples are transformed. The world
+			 * space vertices and the normals (getVertexData()) are updated on demand by updateVertexData(),
+			 * e.g. once per frame by the renderer.
+			 */
+			void setTransformation(const Vector3r &x, const Matrix3r &R);
+			/** Transform the vertices and update the normals if the transformation has changed. */
+			void updateVertexData();
+			bool isVertexDataValid() const { return m_vertexDataValid; }
+
+			/** Return the world space position of a vertex for the current transformation.
+			 * In contrast to getVertexData() the result is always up to date.
+			 */
+			FORCE_INLINE Vector3r getTransformedVertex(const unsigned int i) const
+			{
+				return m_R * m_vertexData_local.getPosition(i) + m_x;
+			}
+
+			/** Compute a world space AABB of the mesh by transforming the local bounding box. The box
+			 * encloses all vertices but it is not tight if the body is rotated.
+			 */
+			void computeAABB(Vector3r &p0, Vector3r &p1) const;
 			
 	};
 }
@@ -0,0 +1,161 @@
+#include "SDFCache.h"
+#include "Utils/FileSystem.h"
+#include "Utils/Logger.h"
+#include <cstdint>
+#include <sstream>
+#include <iomanip>
+
+using namespace PBD;
+using namespace Utilities;
+
+namespace
+{
+	/** 64 bit FNV-1a hash */
+	void hashBytes(uint64_t &hash, const void *data, const size_t size)
+	{
+		const unsigned char *bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	}
+}
+
+SDFCache::SDFCache(const std::string &cachePath) :
+	m_cachePath(cachePath)
+{
+}
+
+SDFCache::~SDFCache()
+{
+	clear();
+}
+
+void SDFCache::clear()
+{
+	m_grids.clear();
+	m_sparseFields.clear();
+}
+
+std::string SDFCache::computeMeshHash(const VertexData &vd, const IndexedFaceMesh &mesh, const Vector3r &scale)
+{
+	uint64_t hash = 14695981039346656037ull;
+	// hash double values so that the key does not depend on the floating point type
+	for (unsigned int i = 0; i < vd.size(); i++)
+	{
+		const Eigen::Vector3d x = vd.getPosition(i).template cast<double>();
+		hashBytes(hash, x.data(), 3 * sizeof(double));
+	}
+	const IndexedFaceMesh::Faces &faces = mesh.getFaces();
+	hashBytes(hash, faces.data(), faces.size() * sizeof(unsigned int));
+	const Eigen::Vector3d s = scale.template cast<double>();
+	hashBytes(hash, s.data(), 3 * sizeof(double));
+
+	std::ostringstream str;
+	str << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return str.str();
+}
+
+SDFCache::GridPtr SDFCache::generateCubicSDF(const VertexData &vd, const IndexedFaceMesh &mesh, const Eigen::Matrix<unsigned int, 3, 1> &resolution, const Vector3r &scale)
+{
+	const IndexedFaceMesh::Faces &faces = mesh.getFaces();
+	const unsigned int nFaces = mesh.numFaces();
+
+	std::vector<double> vertices;
+	vertices.resize(3 * vd.size());
+	for (unsigned int i = 0; i < vd.size(); i++)
+		for (unsigned int j = 0; j < 3; j++)
+			vertices[3 * i + j] = vd.getPosition(i)[j] * scale[j];
+	Discregrid::TriangleMesh sdfMesh(vertices.data(), faces.data(), vd.size(), nFaces);
+
+	Discregrid::MeshDistance md(sdfMesh);
+	Eigen::AlignedBox3d domain;
+	for (auto const& x : sdfMesh.vertices())
+	{
+		domain.extend(x);
+	}
+	domain.max() += 1.0e-3 * domain.diagonal().norm() * Eigen::Vector3d::Ones();
+	domain.min() -= 1.0e-3 * domain.diagonal().norm() * Eigen::Vector3d::Ones();
+
+	LOG_INFO << "Set SDF resolution: " << resolution[0] << ", " << resolution[1] << ", " << resolution[2];
+	GridPtr distanceField = std::make_shared<CubicSDFCollisionDetection::Grid>(domain, std::array<unsigned int, 3>({ resolution[0], resolution[1], resolution[2] }));
+	auto func = Discregrid::DiscreteGrid::ContinuousFunction{};
+	// signedDistanceCached keeps a cache per thread, so the grid nodes are evaluated in parallel
+	func = [&md](Eigen::Vector3d const& xi) {return md.signedDistanceCached(xi); };
+	distanceField->addFunction(func, true);
+	return distanceField;
+}
+
+SDFCache::GridPtr SDFCache::getCubicSDF(const VertexData &vd, const IndexedFaceMesh &mesh, const Eigen::Matrix<unsigned int, 3, 1> &resolution, const Vector3r &scale)
+{
+	const std::string key = computeMeshHash(vd, mesh, scale) + "_" + std::to_string(resolution[0]) + "_" +
+		std::to_string(resolution[1]) + "_" + std::to_string(resolution[2]);
+	auto it = m_grids.find(key);
+	if (it != m_grids.end())
+		return it->second;
+
+	GridPtr distanceField;
+	const std::string sdfFileName = FileSystem::normalizePath(m_cachePath + "/" + key + ".csdf");
+	if ((m_cachePath != "") && FileSystem::fileExists(sdfFileName))
+	{
+		LOG_INFO << "Load cached SDF: " << sdfFileName;
+		distanceField = std::make_shared<CubicSDFCollisionDetection::Grid>(sdfFileName);
+	}
+	else
+	{
+		LOG_INFO << "Generate SDF " << key;
+		distanceField = generateCubicSDF(vd, mesh, resolution, scale);
+		if ((m_cachePath != "") && (FileSystem::makeDir(m_cachePath) == 0))
+		{
+			LOG_INFO << "Save SDF: " << sdfFileName;
+			distanceField->save(sdfFileName);
+		}
+	}
+	m_grids[key] = distanceField;
+	return distanceField;
+}
+
+SparseSDFPtr SDFCache::getSparseSDF(const VertexData &vd, const IndexedFaceMesh &mesh, const Real cellSize, const Real bandWidth, const Vector3r &scale)
+{
+	std::ostringstream str;
+	str << computeMeshHash(vd, mesh, scale) << "_" << std::setprecision(6) << cellSize << "_" << bandWidth;
+	const std::string key = str.str();
+	auto it = m_sparseFields.find(key);
+	if (it != m_sparseFields.end())
+		return it->second;
+
+	SparseSDFPtr distanceField = std::make_shared<SparseSDF>();
+	const std::string sdfFileName = FileSystem::normalizePath(m_cachePath + "/" + key + ".ssdf");
+	if ((m_cachePath != "") && FileSystem::fileExists(sdfFileName) && distanceField->load(sdfFileName))
+	{
+		LOG_INFO << "Load cached SDF: " << sdfFileName;
+	}
+	else
+	{
+		LOG_INFO << "Generate sparse SDF " << key;
+		std::vector<Vector3r> vertices(vd.size());
+		for (unsigned int i = 0; i < vd.size(); i++)
+			vertices[i] = vd.getPosition(i).cwiseProduct(scale);
+		distanceField->build(vertices.data(), mesh, cellSize, bandWidth);
+		if ((m_cachePath != "") && (FileSystem::makeDir(m_cachePath) == 0))
+		{
+			LOG_INFO << "Save SDF: " << sdfFileName;
+			distanceField->save(sdfFileName);
+		}
+	}
+	m_sparseFields[key] = distanceField;
+	return distanceField;
+}
+
+SDFCache::GridPtr SDFCache::loadCubicSDF(const std::string &fileName)
+{
+	auto it = m_grids.find(fileName);
+	if (it != m_grids.end())
+		return it->second;
+
+	LOG_INFO << "Load SDF: " << fileName;
+	GridPtr distanceField = std::make_shared<CubicSDFCollisionDetection::Grid>(fileName);
+	m_grids[fileName] = distanceField;
+	return distanceField;
+}
@@ -0,0 +1,58 @@
+#ifndef __SDFCACHE_H__
+#define __SDFCACHE_H__
+
+#include "Common/Common.h"
+#include "Simulation/CubicSDFCollisionDetection.h"
+#include "Simulation/SparseSDF.h"
+#include "Simulation/ParticleData.h"
+#include "Utils/IndexedFaceMesh.h"
+#include <map>
+#include <string>
+
+namespace PBD
+{
+	/** Generation and caching of signed distance fields of triangle meshes.
+	 *
+	 * The fields are identified by a hash of the mesh content, the scale and the resolution.
+	 * A field is generated only if it is neither in memory nor in the cache directory. Fields
+	 * which are requested several times are shared.
+	 */
+	class SDFCache
+	{
+	public:
+		using GridPtr = CubicSDFCollisionDetection::GridPtr;
+
+	protected:
+		std::string m_cachePath;
+		std::map<std::string, GridPtr> m_grids;
+		std::map<std::string, SparseSDFPtr> m_sparseFields;
+
+	public:
+		SDFCache(const std::string &cachePath = "");
+		~SDFCache();
+
+		/** Directory of the cache files. If empty, the fields are only cached in memory. */
+		const std::string &getCachePath() const { return m_cachePath; }
+		void setCachePath(const std::string &cachePath) { m_cachePath = cachePath; }
+
+		/** Release all fields which are held in memory. */
+		void clear();
+
+		/** Return the cubic signed distance field of a mesh whose vertices are scaled by the given factors. */
+		GridPtr getCubicSDF(const VertexData &vd, const Utilities::IndexedFaceMesh &mesh, const Eigen::Matrix<unsigned int, 3, 1> &resolution,
+			const Vector3r &scale = Vector3r::Ones());
+		/** Return the sparse narrow-band signed distance field of a mesh whose vertices are scaled by the given factors. */
+		SparseSDFPtr getSparseSDF(const VertexData &vd, const Utilities::IndexedFaceMesh &mesh, const Real cellSize, const Real bandWidth,
+			const Vector3r &scale = Vector3r::Ones());
+		/** Load a cubic signed distance field from a file. Each file is only loaded once. */
+		GridPtr loadCubicSDF(const std::string &fileName);
+
+		/** Generate the cubic signed distance field of a mesh. The grid is evaluated in parallel using the bounding volume hierarchy of the mesh. */
+		static GridPtr generateCubicSDF(const VertexData &vd, const Utilities::IndexedFaceMesh &mesh, const Eigen::Matrix<unsigned int, 3, 1> &resolution,
+			const Vector3r &scale = Vector3r::Ones());
+		/** Hash of the vertex positions, the faces and the scale of a mesh. */
+		static std::string computeMeshHash(const VertexData &vd, const Utilities::IndexedFaceMesh &mesh, const Vector3r &scale);
+	};
+}
+
+#endif
@@ -18,6 +18,8 @@ int SimulationModel::SOLID_STIFFNESS = -1;
 int SimulationModel::SOLID_POISSON_RATIO = -1;
 int SimulationModel::SOLID_NORMALIZE_STRETCH = -1;
 int SimulationModel::SOLID_NORMALIZE_SHEAR = -1;
+int SimulationModel::ROD_REUSE_FACTORIZATION = -1;
+int SimulationModel::ROD_REFACTORIZATION_THRESHOLD = -1;
 
 
 SimulationModel::SimulationModel()
@@ -46,8 +48,11 @@ SimulationModel::SimulationModel()
 	m_rod_bendingStiffness1 = 0.5;
 	m_rod_bendingStiffness2 = 0.5;
 	m_rod_twistingStiffness = 0.5;
+	m_rod_reuseFactorization = false;
+	m_rod_refactorizationThreshold = static_cast<Real>(0.001);
 
 	m_groupsInitialized = false;
+	m_contactGroupsInitialized = false;
 
 	m_rigidBodyContactConstraints.reserve(10000);
 	m_particleRigidBodyContactConstraints.reserve(10000);
@@ -129,6 +134,14 @@ void SimulationModel::initParameters()
 	setGroup(SOLID_NORMALIZE_SHEAR, "Solids");
 	setDescription(SOLID_NORMALIZE_SHEAR, "Normalize shear (strain based dynamics)");
 
+	ROD_REUSE_FACTORIZATION = createBoolParameter("rod_reuseFactorization", "Reuse factorization", &m_rod_reuseFactorization);
+	setGroup(ROD_REUSE_FACTORIZATION, "Stiff rods");
+	setDescription(ROD_REUSE_FACTORIZATION, "Factorize the system of the direct rod solver once per time step and reuse it in the following iterations.");
+
+	ROD_REFACTORIZATION_THRESHOLD = createNumericParameter("rod_refactorizationThreshold", "Refactorization threshold", &m_rod_refactorizationThreshold);
+	setGroup(ROD_REFACTORIZATION_THRESHOLD, "Stiff rods");
+	setDescription(ROD_REFACTORIZATION_THRESHOLD, "A reused factorization is recomputed if a segment position or rotation (quaternion coefficients) changed more than this threshold.");
+	static_cast<NumericParameter<Real>*>(getParameter(ROD_REFACTORIZATION_THRESHOLD))->setMinValue(0.0);
 }
 
 void SimulationModel::cleanup()
@@ -391,6 +404,7 @@ bool SimulationModel::addRigidBodyContactConstraint(const unsigned int rbIndex1,
 	const Real restitutionCoeff, const Real frictionCoeff)
 {
 	m_rigidBodyContactConstraints.emplace_back(RigidBodyContactConstraint());
+	m_contactGroupsInitialized = false;
 	RigidBodyContactConstraint &cc = m_rigidBodyContactConstraints.back();
 	const bool res = cc.initConstraint(*this, rbIndex1, rbIndex2, cp1, cp2, normal, dist, restitutionCoeff, m_contactStiffnessRigidBody, frictionCoeff);
 	if (!res)
@@ -404,6 +418,7 @@ bool SimulationModel::addRigidBodyContactConstraint(const unsigned int rbIndex1,
  	const Real restitutionCoeff, const Real frictionCoeff)
 {
 	m_particleRigidBodyContactConstraints.emplace_back(ParticleRigidBodyContactConstraint());
+	m_contactGroupsInitialized = false;
  	ParticleRigidBodyContactConstraint &cc = m_particleRigidBodyContactConstraints.back();
  	const bool res = cc.initConstraint(*this, particleIndex, rbIndex, cp1, cp2, normal, dist, restitutionCoeff, m_contactStiffnessParticleRigidBody, frictionCoeff);
  	if (!res)
@@ -418,6 +433,7 @@ bool SimulationModel::addParticleSolidContactConstraint(const unsigned int parti
  	const Real restitutionCoeff, const Real frictionCoeff)
 {
 	m_particleSolidContactConstraints.emplace_back(ParticleTetContactConstraint());
+	m_contactGroupsInitialized = false;
  	ParticleTetContactConstraint &cc = m_particleSolidContactConstraints.back();
  	const bool res = cc.initConstraint(*this, particleIndex, solidIndex, tetIndex, bary, cp1, cp2, normal, dist, frictionCoeff);
  	if (!res)
@@ -425,6 +441,40 @@ bool SimulationModel::addParticleSolidContactConstraint(const unsigned int parti
  	return res;
 }
 
+void SimulationModel::resizeContactConstraints(const unsigned int numRigidBodyContacts, const unsigned int numParticleRigidBodyContacts, const unsigned int numParticleSolidContacts)
+{
+	// std::vector keeps its capacity on resize, so the memory is reused between time steps
+	m_rigidBodyContactConstraints.resize(numRigidBodyContacts);
+	m_particleRigidBodyContactConstraints.resize(numParticleRigidBodyContacts);
+	m_particleSolidContactConstraints.resize(numParticleSolidContacts);
+	m_contactGroupsInitialized = false;
+}
+
+bool SimulationModel::initRigidBodyContactConstraint(const unsigned int index, const unsigned int rbIndex1, const unsigned int rbIndex2,
+	const Vector3r &cp1, const Vector3r &cp2,
+	const Vector3r &normal, const Real dist,
+	const Real restitutionCoeff, const Real frictionCoeff)
+{
+	return m_rigidBodyContactConstraints[index].initConstraint(*this, rbIndex1, rbIndex2, cp1, cp2, normal, dist, restitutionCoeff, m_contactStiffnessRigidBody, frictionCoeff);
+}
+
+bool SimulationModel::initParticleRigidBodyContactConstraint(const unsigned int index, const unsigned int particleIndex, const unsigned int rbIndex,
+	const Vector3r &cp1, const Vector3r &cp2,
+	const Vector3r &normal, const Real dist,
+	const Real restitutionCoeff, const Real frictionCoeff)
+{
+	return m_particleRigidBodyContactConstraints[index].initConstraint(*this, particleIndex, rbIndex, cp1, cp2, normal, dist, restitutionCoeff, m_contactStiffnessParticleRigidBody, frictionCoeff);
+}
+
+bool SimulationModel::initParticleSolidContactConstraint(const unsigned int index, const unsigned int particleIndex, const unsigned int solidIndex,
+	const unsigned int tetIndex, const Vector3r &bary,
+	const Vector3r &cp1, const Vector3r &cp2,
+	const Vector3r &normal, const Real dist,
+	const Real restitutionCoeff, const Real frictionCoeff)
+{
+	return m_particleSolidContactConstraints[index].initConstraint(*this, particleIndex, solidIndex, tetIndex, bary, cp1, cp2, normal, dist, frictionCoeff);
+}
+
 bool SimulationModel::addDistanceConstraint(const unsigned int particle1, const unsigned int particle2)
 {
 	DistanceConstraint *c = new DistanceConstraint();
@@ -755,5 +805,123 @@ void SimulationModel::resetContacts()
 	m_rigidBodyContactConstraints.clear();
 	m_particleRigidBodyContactConstraints.clear();
 	m_particleSolidContactConstraints.clear();
+	m_contactGroupsInitialized = false;
+}
+
+namespace
+{
+	typedef unsigned long long ContactColorMask;
+	const unsigned int MAX_CONTACT_COLORS = 64;
+
+	/** Greedy coloring of contacts. getMasks returns the color masks of the dynamic bodies of a contact.
+	 * A contact gets the first color which is not used by one of its bodies. If all colors are used,
+	 * the contact is deferred to another pass with new colors.
+	 */
+	template<typename GetMasks>
+	void colorContacts(SimulationModel::ConstraintGroupVector &groups, const unsigned int numContacts,
+		std::vector<ContactColorMask> &particleMasks, std::vector<ContactColorMask> &rbMasks, GetMasks getMasks)
+	{
+		// keep the memory of the groups
+		for (unsigned int i = 0; i < groups.size(); i++)
+			groups[i].clear();
+
+		std::vector<unsigned int> pending(numContacts);
+		for (unsigned int i = 0; i < numContacts; i++)
+			pending[i] = i;
+		std::vector<unsigned int> deferred;
+
+		unsigned int numGroups = 0;
+		unsigned int colorOffset = 0;
+		while (!pending.empty())
+		{
+			std::fill(particleMasks.begin(), particleMasks.end(), 0);
+			std::fill(rbMasks.begin(), rbMasks.end(), 0);
+			deferred.clear();
+			for (unsigned int i = 0; i < pending.size(); i++)
+			{
+				ContactColorMask *masks[5];
+				const unsigned int n = getMasks(pending[i], masks);
+				ContactColorMask used = 0;
+				for (unsigned int j = 0; j < n; j++)
+					used |= *masks[j];
+				if (used == ~static_cast<ContactColorMask>(0))
+				{
+					deferred.push_back(pending[i]);
+					continue;
+				}
+				unsigned int color = 0;
+				while (used & (static_cast<ContactColorMask>(1) << color))
+					color++;
+				for (unsigned int j = 0; j < n; j++)
+					*masks[j] |= static_cast<ContactColorMask>(1) << color;
+
+				const unsigned int group = colorOffset + color;
+				if (groups.size() <= group)
+					groups.resize(group + 1);
+				groups[group].push_back(pending[i]);
+				numGroups = std::max(numGroups, group + 1);
+			}
+			pending.swap(deferred);
+			colorOffset += MAX_CONTACT_COLORS;
+		}
+		groups.resize(numGroups);
+	}
+}
+
+void SimulationModel::initContactGroups()
+{
+	if (m_contactGroupsInitialized)
+		return;
+
+	// static bodies are never modified by a contact, so only dynamic bodies get a color mask
+	std::vector<ContactColorMask> particleMasks(m_particles.size());
+	std::vector<ContactColorMask> rbMasks(m_rigidBodies.size());
+
+	colorContacts(m_rigidBodyContactGroups, (unsigned int)m_rigidBodyContactConstraints.size(), particleMasks, rbMasks,
+		[&](const unsigned int i, ContactColorMask **masks)
+		{
+			unsigned int n = 0;
+			for (unsigned int j = 0; j < 2; j++)
+			{
+				const unsigned int rbIndex = m_rigidBodyContactConstraints[i].m_bodies[j];
+				if (m_rigidBodies[rbIndex]->getMass() != 0.0)
+					masks[n++] = &rbMasks[rbIndex];
+			}
+			return n;
+		});
+
+	colorContacts(m_particleRigidBodyContactGroups, (unsigned int)m_particleRigidBodyContactConstraints.size(), particleMasks, rbMasks,
+		[&](const unsigned int i, ContactColorMask **masks)
+		{
+			unsigned int n = 0;
+			const ParticleRigidBodyContactConstraint &cc = m_particleRigidBodyContactConstraints[i];
+			if (m_particles.getMass(cc.m_bodies[0]) != 0.0)
+				masks[n++] = &particleMasks[cc.m_bodies[0]];
+			if (m_rigidBodies[cc.m_bodies[1]]->getMass() != 0.0)
+				masks[n++] = &rbMasks[cc.m_bodies[1]];
+			return n;
+		});
+
+	colorContacts(m_particleSolidContactGroups, (unsigned int)m_particleSolidContactConstraints.size(), particleMasks, rbMasks,
+		[&](const unsigned int i, ContactColorMask **masks)
+		{
+			unsigned int n = 0;
+			const ParticleTetContactConstraint &cc = m_particleSolidContactConstraints[i];
+			if (m_particles.getMass(cc.m_bodies[0]) != 0.0)
+				masks[n++] = &particleMasks[cc.m_bodies[0]];
+
+			TetModel *tm = m_tetModels[cc.m_solidIndex];
+			const unsigned int offset = tm->getIndexOffset();
+			const unsigned int *indices = tm->getParticleMesh().getTets().data();
+			for (unsigned int j = 0; j < 4; j++)
+			{
+				const unsigned int index = indices[4 * cc.m_tetIndex + j] + offset;
+				if (m_particles.getMass(index) != 0.0)
+					masks[n++] = &particleMasks[index];
+			}
+			return n;
+		});
+
+	m_contactGroupsInitialized = true;
 }
 
@@ -32,6 +32,9 @@ namespace PBD
 			static int SOLID_NORMALIZE_STRETCH;
 			static int SOLID_NORMALIZE_SHEAR;
 
+			static int ROD_REUSE_FACTORIZATION;
+			static int ROD_REFACTORIZATION_THRESHOLD;
+
 		public:
 			SimulationModel();
 			virtual ~SimulationModel();
@@ -62,6 +65,11 @@ namespace PBD
 			ParticleRigidBodyContactConstraintVector m_particleRigidBodyContactConstraints;
 			ParticleSolidContactConstraintVector m_particleSolidContactConstraints;
 			ConstraintGroupVector m_constraintGroups;
+			/** Contact groups of each contact type. The contacts of one group do not share a dynamic body. */
+			ConstraintGroupVector m_rigidBodyContactGroups;
+			ConstraintGroupVector m_particleRigidBodyContactGroups;
+			ConstraintGroupVector m_particleSolidContactGroups;
+			bool m_contactGroupsInitialized;
 
 			Real m_cloth_stiffness;
 			Real m_cloth_bendingStiffness;
@@ -87,6 +95,11 @@ namespace PBD
 			Real m_rod_bendingStiffness1;
 			Real m_rod_bendingStiffness2;
 			Real m_rod_twistingStiffness;
+			/** The direct rod solver factorizes its system in the first iteration of a time step and
+			 * only refactorizes if the segments moved more than the threshold since the last factorization.
+			 */
+			bool m_rod_reuseFactorization;
+			Real m_rod_refactorizationThreshold;
 
 			virtual void initParameters();
 
@@ -105,6 +118,9 @@ namespace PBD
 			ParticleRigidBodyContactConstraintVector &getParticleRigidBodyContactConstraints();
 			ParticleSolidContactConstraintVector &getParticleSolidContactConstraints();
 			ConstraintGroupVector &getConstraintGroups();
+			ConstraintGroupVector &getRigidBodyContactGroups() { return m_rigidBodyContactGroups; }
+			ConstraintGroupVector &getParticleRigidBodyContactGroups() { return m_particleRigidBodyContactGroups; }
+			ConstraintGroupVector &getParticleSolidContactGroups() { return m_particleSolidContactGroups; }
 			bool m_groupsInitialized;
 
 			void resetContacts();
@@ -135,6 +151,10 @@ namespace PBD
 
 			void updateConstraints();
 			void initConstraintGroups();
+			/** Color the contact graph so that the contacts of a group can be solved in parallel. 
+			 * The groups are recomputed after the contacts have changed.
+			 */
+			void initContactGroups();
 
 			bool addBallJoint(const unsigned int rbIndex1, const unsigned int rbIndex2, const Vector3r &pos);
 			bool addBallOnLineJoint(const unsigned int rbIndex1, const unsigned int rbIndex2, const Vector3r &pos, const Vector3r &dir);
@@ -162,6 +182,25 @@ namespace PBD
 				const Vector3r &normal, const Real dist,
 				const Real restitutionCoeff, const Real frictionCoeff);
 
+			/** Resize the contact constraint vectors without releasing their capacity.
+			 * The new entries must be initialized by the corresponding init*ContactConstraint()
+			 * methods which can be called in parallel for distinct indices.
+			 */
+			void resizeContactConstraints(const unsigned int numRigidBodyContacts, const unsigned int numParticleRigidBodyContacts, const unsigned int numParticleSolidContacts);
+			bool initRigidBodyContactConstraint(const unsigned int index, const unsigned int rbIndex1, const unsigned int rbIndex2,
+					const Vector3r &cp1, const Vector3r &cp2,
+					const Vector3r &normal, const Real dist,
+					const Real restitutionCoeff, const Real frictionCoeff);
+			bool initParticleRigidBodyContactConstraint(const unsigned int index, const unsigned int particleIndex, const unsigned int rbIndex,
+					const Vector3r &cp1, const Vector3r &cp2,
+					const Vector3r &normal, const Real dist,
+					const Real restitutionCoeff, const Real frictionCoeff);
+			bool initParticleSolidContactConstraint(const unsigned int index, const unsigned int particleIndex, const unsigned int solidIndex,
+				const unsigned int tetIndex, const Vector3r &bary,
+				const Vector3r &cp1, const Vector3r &cp2,
+				const Vector3r &normal, const Real dist,
+				const Real restitutionCoeff, const Real frictionCoeff);
+
 			bool addDistanceConstraint(const unsigned int particle1, const unsigned int particle2);
 			bool addDihedralConstraint(	const unsigned int particle1, const unsigned int particle2,
 										const unsigned int particle3, const unsigned int particle4);
@@ -0,0 +1,313 @@
+#include "SparseJointSolver.h"
+#include "Simulation/SimulationModel.h"
+#include "Simulation/Constraints.h"
+
+using namespace PBD;
+
+SparseJointSolver::SparseJointSolver()
+{
+	m_numRows = 0;
+	m_numConstraints = 0;
+	m_analyzed = false;
+}
+
+SparseJointSolver::~SparseJointSolver()
+{
+}
+
+void SparseJointSolver::reset()
+{
+	m_joints.clear();
+	m_isHandled.clear();
+	m_bodies.clear();
+	m_bodyJoints.clear();
+	m_numRows = 0;
+	m_numConstraints = 0;
+	m_analyzed = false;
+}
+
+bool SparseJointSolver::isSupported(const Constraint *constraint)
+{
+	const int typeId = constraint->getTypeId();
+	return (typeId == BallJoint::TYPE_ID) || (typeId == HingeJoint::TYPE_ID) || (typeId == UniversalJoint::TYPE_ID);
+}
+
+void SparseJointSolver::init(SimulationModel &model)
+{
+	reset();
+
+	SimulationModel::ConstraintVector &constraints = model.getConstraints();
+	const unsigned int numBodies = (unsigned int)model.getRigidBodies().size();
+	m_numConstraints = (unsigned int)constraints.size();
+	m_isHandled.resize(m_numConstraints, 0);
+
+	std::vector<int> bodyIndex(numBodies, -1);
+	for (unsigned int i = 0; i < m_numConstraints; i++)
+	{
+		Constraint *c = constraints[i];
+		if (!isSupported(c))
+			continue;
+
+		Joint joint;
+		joint.m_constraintIndex = i;
+		joint.m_bodies[0] = c->m_bodies[0];
+		joint.m_bodies[1] = c->m_bodies[1];
+		joint.m_firstRow = m_numRows;
+		joint.m_numRows = numJointRows(c);
+		m_numRows += joint.m_numRows;
+		m_isHandled[i] = 1;
+
+		for (unsigned int side = 0; side < 2; side++)
+		{
+			const unsigned int b = joint.m_bodies[side];
+			if (bodyIndex[b] < 0)
+			{
+				bodyIndex[b] = (int)m_bodies.size();
+				m_bodies.push_back(b);
+				m_bodyJoints.push_back(std::vector<BodyJoint>());
+			}
+			BodyJoint bj;
+			bj.m_joint = (unsigned int)m_joints.size();
+			bj.m_side = side;
+			m_bodyJoints[bodyIndex[b]].push_back(bj);
+		}
+		m_joints.push_back(joint);
+	}
+
+	for (unsigned int side = 0; side < 2; side++)
+	{
+		m_J[side].resize(m_numRows);
+		m_WJ[side].resize(m_numRows);
+	}
+	m_rhs.resize(m_numRows);
+	m_lambda.resize(m_numRows);
+	m_K.resize(m_numRows, m_numRows);
+}
+
+unsigned int SparseJointSolver::numJointRows(const Constraint *constraint)
+{
+	const int typeId = constraint->getTypeId();
+	if (typeId == BallJoint::TYPE_ID)
+		return 3;
+	else if (typeId == HingeJoint::TYPE_ID)
+		return 5;
+	return 4;
+}
+
+unsigned int SparseJointSolver::computeJointRows(SimulationModel &model, Constraint *c, Vector6r *J0, Vector6r *J1, Real *rhs)
+{
+	SimulationModel::RigidBodyVector &rb = model.getRigidBodies();
+	c->updateConstraint(model);
+
+	// world space connectors and the rotational constraint axes
+	Vector3r c0, c1;
+	Vector3r u[2];
+	Real C[2];
+	unsigned int numRotRows = 0;
+	if (c->getTypeId() == BallJoint::TYPE_ID)
+	{
+		const BallJoint *bj = static_cast<const BallJoint*>(c);
+		c0 = bj->m_jointInfo.col(2);
+		c1 = bj->m_jointInfo.col(3);
+	}
+	else if (c->getTypeId() == HingeJoint::TYPE_ID)
+	{
+		const HingeJoint *hj = static_cast<const HingeJoint*>(c);
+		c0 = hj->m_jointInfo.col(6);
+		c1 = hj->m_jointInfo.col(7);
+		const Vector3r &axis1 = hj->m_jointInfo.col(11);
+		u[0] = hj->m_jointInfo.col(9).cross(axis1);
+		u[1] = hj->m_jointInfo.col(10).cross(axis1);
+		C[0] = hj->m_jointInfo.col(9).dot(axis1);
+		C[1] = hj->m_jointInfo.col(10).dot(axis1);
+		numRotRows = 2;
+	}
+	else
+	{
+		const UniversalJoint *uj = static_cast<const UniversalJoint*>(c);
+		c0 = uj->m_jointInfo.col(4);
+		c1 = uj->m_jointInfo.col(5);
+		u[0] = uj->m_jointInfo.col(6).cross(uj->m_jointInfo.col(7));
+		C[0] = uj->m_jointInfo.col(6).dot(uj->m_jointInfo.col(7));
+		numRotRows = 1;
+	}
+
+	const RigidBody &rb0 = *rb[c->m_bodies[0]];
+	const RigidBody &rb1 = *rb[c->m_bodies[1]];
+	const Vector3r r[2] = { c0 - rb0.getPosition(), c1 - rb1.getPosition() };
+	Vector6r *J[2] = { J0, J1 };
+	const Real sign[2] = { 1.0, -1.0 };
+
+	// translational rows: C = c0 - c1
+	for (unsigned int k = 0; k < 3; k++)
+	{
+		const Vector3r e = Vector3r::Unit(k);
+		for (unsigned int side = 0; side < 2; side++)
+		{
+			J[side][k].head<3>() = sign[side] * e;
+			J[side][k].tail<3>() = sign[side] * r[side].cross(e);
+		}
+		rhs[k] = c1[k] - c0[k];
+	}
+	// rotational rows
+	for (unsigned int k = 0; k < numRotRows; k++)
+	{
+		for (unsigned int side = 0; side < 2; side++)
+		{
+			J[side][3 + k].head<3>().setZero();
+			J[side][3 + k].tail<3>() = sign[side] * u[k];
+		}
+		rhs[3 + k] = -C[k];
+	}
+	return 3 + numRotRows;
+}
+
+void SparseJointSolver::computeRows(SimulationModel &model)
+{
+	SimulationModel::RigidBodyVector &rb = model.getRigidBodies();
+	SimulationModel::ConstraintVector &constraints = model.getConstraints();
+	const int numJoints = (int)m_joints.size();
+
+	#pragma omp parallel if(numJoints > MIN_PARALLEL_SIZE) default(shared)
+	{
+		#pragma omp for schedule(static)
+		for (int i = 0; i < numJoints; i++)
+		{
+			const Joint &joint = m_joints[i];
+			const unsigned int row0 = joint.m_firstRow;
+			computeJointRows(model, constraints[joint.m_constraintIndex], &m_J[0][row0], &m_J[1][row0], &m_rhs[row0]);
+
+			// M^-1 J^T, static and sleeping bodies are not moved
+			bool fixed[2];
+			for (unsigned int side = 0; side < 2; side++)
+			{
+				const RigidBody &body = *rb[joint.m_bodies[side]];
+				fixed[side] = (body.getMass() == 0.0) || body.isSleeping();
+				for (unsigned int k = 0; k < joint.m_numRows; k++)
+				{
+					const unsigned int row = row0 + k;
+					if (fixed[side])
+						m_WJ[side][row].setZero();
+					else
+					{
+						m_WJ[side][row].head<3>() = body.getInvMass() * m_J[side][row].head<3>();
+						m_WJ[side][row].tail<3>() = body.getInertiaTensorInverseW() * m_J[side][row].tail<3>();
+					}
+				}
+			}
+			// a joint between two fixed bodies has no effect
+			if (fixed[0] && fixed[1])
+				m_rhs.segment(row0, joint.m_numRows).setZero();
+		}
+	}
+}
+
+void SparseJointSolver::assembleMatrix()
+{
+	// The same entries are generated in each step, so the sparsity pattern does not change.
+	// Only the lower triangle is required by the LDLT decomposition.
+	m_triplets.clear();
+	for (size_t i = 0; i < m_bodies.size(); i++)
+	{
+		const std::vector<BodyJoint> &bodyJoints = m_bodyJoints[i];
+		for (size_t p = 0; p < bodyJoints.size(); p++)
+		{
+			const Joint &jp = m_joints[bodyJoints[p].m_joint];
+			const unsigned int sp = bodyJoints[p].m_side;
+			for (size_t q = 0; q < bodyJoints.size(); q++)
+			{
+				const Joint &jq = m_joints[bodyJoints[q].m_joint];
+				const unsigned int sq = bodyJoints[q].m_side;
+				if (jq.m_firstRow > jp.m_firstRow)
+					continue;
+				for (unsigned int k = 0; k < jp.m_numRows; k++)
+				{
+					const unsigned int row = jp.m_firstRow + k;
+					for (unsigned int l = 0; l < jq.m_numRows; l++)
+					{
+						const unsigned int col = jq.m_firstRow + l;
+						if (col > row)
+							break;
+						m_triplets.push_back(Eigen::Triplet<Real>(row, col, m_J[sp][row].dot(m_WJ[sq][col])));
+					}
+				}
+			}
+		}
+	}
+
+	// The diagonal is regularized slightly so that redundant joints (closed loops) do not
+	// cause a singular matrix. Rows of joints between fixed bodies get a unit diagonal.
+	for (size_t i = 0; i < m_joints.size(); i++)
+	{
+		const Joint &joint = m_joints[i];
+		for (unsigned int k = 0; k < joint.m_numRows; k++)
+		{
+			const unsigned int row = joint.m_firstRow + k;
+			const Real d = m_J[0][row].dot(m_WJ[0][row]) + m_J[1][row].dot(m_WJ[1][row]);
+			const Real reg = (d > 0.0) ? static_cast<Real>(1.0e-8) * d : static_cast<Real>(1.0);
+			m_triplets.push_back(Eigen::Triplet<Real>(row, row, reg));
+		}
+	}
+	m_K.setFromTriplets(m_triplets.begin(), m_triplets.end());
+}
+
+void SparseJointSolver::applyCorrections(SimulationModel &model)
+{
+	SimulationModel::RigidBodyVector &rb = model.getRigidBodies();
+	const int numBodies = (int)m_bodies.size();
+
+	#pragma omp parallel if(numBodies > MIN_PARALLEL_SIZE) default(shared)
+	{
+		#pragma omp for schedule(static)
+		for (int i = 0; i < numBodies; i++)
+		{
+			RigidBody &body = *rb[m_bodies[i]];
+			if ((body.getMass() == 0.0) || body.isSleeping())
+				continue;
+
+			// sum of M^-1 J^T lambda of all joints of the body
+			Vector6r corr;
+			corr.setZero();
+			const std::vector<BodyJoint> &bodyJoints = m_bodyJoints[i];
+			for (size_t j = 0; j < bodyJoints.size(); j++)
+			{
+				const Joint &joint = m_joints[bodyJoints[j].m_joint];
+				const unsigned int side = bodyJoints[j].m_side;
+				for (unsigned int k = 0; k < joint.m_numRows; k++)
+					corr += m_lambda[joint.m_firstRow + k] * m_WJ[side][joint.m_firstRow + k];
+			}
+
+			body.getPosition() += corr.head<3>();
+			Quaternionr corr_q(0.0, corr[3], corr[4], corr[5]);
+			corr_q = corr_q * body.getRotation();
+			body.getRotation().coeffs() += static_cast<Real>(0.5) * corr_q.coeffs();
+			body.getRotation().normalize();
+			body.rotationUpdated();
+		}
+	}
+}
+
+bool SparseJointSolver::solvePositionConstraints(SimulationModel &model)
+{
+	if (model.getConstraints().size() != m_numConstraints)
+		init(model);
+	if (m_joints.empty())
+		return true;
+
+	computeRows(model);
+	assembleMatrix();
+
+	// the symbolic analysis only depends on the joint topology
+	if (!m_analyzed)
+	{
+		m_solver.analyzePattern(m_K);
+		m_analyzed = true;
+	}
+	m_solver.factorize(m_K);
+	if (m_solver.info() != Eigen::Success)
+		return false;
+
+	m_lambda = m_solver.solve(m_rhs);
+	applyCorrections(model);
+	return true;
+}
@@ -0,0 +1,105 @@
+#ifndef __SPARSEJOINTSOLVER_H__
+#define __SPARSEJOINTSOLVER_H__
+
+#include "Common/Common.h"
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <vector>
+
+namespace PBD
+{
+	class SimulationModel;
+	class Constraint;
+
+	/** Global direct solver for the position constraints of rigid body joints.
+	 *
+	 * The local Gauss-Seidel projection propagates a correction only by one joint per iteration, so
+	 * long chains of bodies converge slowly. This solver assembles the rows of all supported joints
+	 * (ball, hinge and universal joints) in one sparse system
+	 * \f$\mathbf J \mathbf M^{-1} \mathbf J^T \boldsymbol \lambda = -\mathbf C\f$
+	 * and solves it by a sparse LDLT decomposition. The sparsity pattern only depends on the joint
+	 * topology, so the symbolic analysis is done once and only the numeric factorization is
+	 * performed in each iteration. Static and sleeping bodies get an infinite mass.
+	 */
+	class SparseJointSolver
+	{
+	public:
+		typedef Eigen::Matrix<Real, 6, 1> Vector6r;
+
+	protected:
+		typedef Eigen::SparseMatrix<Real> SparseMatrix;
+
+		/** Rows of one joint in the global system */
+		struct Joint
+		{
+			unsigned int m_constraintIndex;
+			unsigned int m_bodies[2];
+			unsigned int m_firstRow;
+			unsigned int m_numRows;
+		};
+
+		/** Joint which acts on a rigid body and the side (0 or 1) of the body in the joint */
+		struct BodyJoint
+		{
+			unsigned int m_joint;
+			unsigned int m_side;
+		};
+
+		std::vector<Joint> m_joints;
+		unsigned int m_numRows;
+		/** Number of model constraints when the joints were collected */
+		unsigned int m_numConstraints;
+		/** Flag for each model constraint which is solved by this solver */
+		std::vector<unsigned char> m_isHandled;
+		/** Joints of each rigid body which is connected to a supported joint */
+		std::vector<unsigned int> m_bodies;
+		std::vector<std::vector<BodyJoint>> m_bodyJoints;
+
+		/** Jacobian (linear and angular part) of each row for body 0 and body 1 and the
+		 * corresponding columns of M^-1 J^T */
+		std::vector<Vector6r, Eigen::aligned_allocator<Vector6r>> m_J[2];
+		std::vector<Vector6r, Eigen::aligned_allocator<Vector6r>> m_WJ[2];
+		Eigen::Matrix<Real, Eigen::Dynamic, 1> m_rhs;
+		Eigen::Matrix<Real, Eigen::Dynamic, 1> m_lambda;
+
+		std::vector<Eigen::Triplet<Real>> m_triplets;
+		SparseMatrix m_K;
+		Eigen::SimplicialLDLT<SparseMatrix> m_solver;
+		bool m_analyzed;
+
+		void init(SimulationModel &model);
+		void computeRows(SimulationModel &model);
+		void assembleMatrix();
+		void applyCorrections(SimulationModel &model);
+
+	public:
+		SparseJointSolver();
+		~SparseJointSolver();
+
+		/** Return true if the constraint type is supported by the solver. */
+		static bool isSupported(const Constraint *constraint);
+		/** Return the number of rows (3 to 5) of a supported joint. */
+		static unsigned int numJointRows(const Constraint *constraint);
+		/** Update a supported joint and compute its rows. The Jacobians (linear and angular part)
+		 * of body 0 and body 1 are stored in J0 and J1, the negative constraint values in rhs.
+		 * Returns the number of rows.
+		 */
+		static unsigned int computeJointRows(SimulationModel &model, Constraint *c, Vector6r *J0, Vector6r *J1, Real *rhs);
+
+		/** Perform one iteration of the global solver for all supported joints. The joints are
+		 * collected again if the number of constraints in the model has changed.
+		 * Returns false if the system could not be factorized. Then the joints must be solved
+		 * by the local solver.
+		 */
+		bool solvePositionConstraints(SimulationModel &model);
+
+		/** Return true if the constraint is solved by this solver. */
+		bool isHandled(const unsigned int constraintIndex) const { return (constraintIndex < m_isHandled.size()) && m_isHandled[constraintIndex]; }
+
+		unsigned int numJoints() const { return (unsigned int)m_joints.size(); }
+
+		void reset();
+	};
+}
+
+#endif
@@ -0,0 +1,518 @@
+#include "SparseSDF.h"
+#include <fstream>
+#include <unordered_map>
+#include <deque>
+#include <limits>
+#include <cstdint>
+#include <cmath>
+
+using namespace PBD;
+
+namespace
+{
+	enum TriangleRegion { FACE = 0, VERTEX_A, VERTEX_B, VERTEX_C, EDGE_AB, EDGE_BC, EDGE_CA };
+
+	/** Closest point on the triangle abc to p (Ericson, Real-Time Collision Detection).
+	 * The region of the triangle which contains the closest point is returned. */
+	TriangleRegion closestPointOnTriangle(const Vector3r &p, const Vector3r &a, const Vector3r &b, const Vector3r &c, Vector3r &cp)
+	{
+		const Vector3r ab = b - a;
+		const Vector3r ac = c - a;
+		const Vector3r ap = p - a;
+		const Real d1 = ab.dot(ap);
+		const Real d2 = ac.dot(ap);
+		if ((d1 <= 0.0) && (d2 <= 0.0))
+		{
+			cp = a;
+			return VERTEX_A;
+		}
+
+		const Vector3r bp = p - b;
+		const Real d3 = ab.dot(bp);
+		const Real d4 = ac.dot(bp);
+		if ((d3 >= 0.0) && (d4 <= d3))
+		{
+			cp = b;
+			return VERTEX_B;
+		}
+
+		const Real vc = d1*d4 - d3*d2;
+		if ((vc <= 0.0) && (d1 >= 0.0) && (d3 <= 0.0))
+		{
+			cp = a + d1 / (d1 - d3) * ab;
+			return EDGE_AB;
+		}
+
+		const Vector3r cp_ = p - c;
+		const Real d5 = ab.dot(cp_);
+		const Real d6 = ac.dot(cp_);
+		if ((d6 >= 0.0) && (d5 <= d6))
+		{
+			cp = c;
+			return VERTEX_C;
+		}
+
+		const Real vb = d5*d2 - d1*d6;
+		if ((vb <= 0.0) && (d2 >= 0.0) && (d6 <= 0.0))
+		{
+			cp = a + d2 / (d2 - d6) * ac;
+			return EDGE_CA;
+		}
+
+		const Real va = d3*d6 - d5*d4;
+		if ((va <= 0.0) && ((d4 - d3) >= 0.0) && ((d5 - d6) >= 0.0))
+		{
+			cp = b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b);
+			return EDGE_BC;
+		}
+
+		const Real denom = static_cast<Real>(1.0) / (va + vb + vc);
+		cp = a + ab * (vb * denom) + ac * (vc * denom);
+		return FACE;
+	}
+
+	/** Header of the files written by SparseSDF::save() ("SSDF" and the version of the format) */
+	const uint32_t SPARSE_SDF_MAGIC = 0x46445353;
+	const uint32_t SPARSE_SDF_VERSION = 1;
+
+	FORCE_INLINE uint64_t edgeKey(const unsigned int v1, const unsigned int v2)
+	{
+		return (static_cast<uint64_t>(std::min(v1, v2)) << 32) | static_cast<uint64_t>(std::max(v1, v2));
+	}
+}
+
+SparseSDF::SparseSDF()
+{
+	m_origin.setZero();
+	m_cellSize = 1.0;
+	m_bandWidth = 0.0;
+	m_numBlocks.setZero();
+}
+
+SparseSDF::~SparseSDF()
+{
+}
+
+void SparseSDF::build(const Vector3r *vertices, const Utilities::IndexedFaceMesh &mesh, const Real cellSize, const Real bandWidth)
+{
+	build(vertices, mesh.numVertices(), mesh.getFaces().data(), mesh.numFaces(), cellSize, bandWidth);
+}
+
+void SparseSDF::build(const Vector3r *vertices, const unsigned int numVertices, const unsigned int *faces, const unsigned int numFaces, const Real cellSize, const Real bandWidth)
+{
+	m_cellSize = cellSize;
+	m_bandWidth = bandWidth;
+	m_blockIndex.clear();
+	m_values.clear();
+	m_emptyBlockDirections.clear();
+
+	// domain of the field: bounding box of the mesh extended by the band width
+	AlignedBox3r domain;
+	for (unsigned int i = 0; i < numVertices; i++)
+		domain.extend(vertices[i]);
+	const Real blockLength = BLOCK_SIZE * cellSize;
+	const Vector3r border = Vector3r::Constant(bandWidth + cellSize);
+	m_origin = domain.min() - border;
+	const Vector3r extent = domain.max() + border - m_origin;
+	for (unsigned int i = 0; i < 3; i++)
+		m_numBlocks[i] = std::max(1, (int)ceil(extent[i] / blockLength));
+	const unsigned int totalBlocks = m_numBlocks[0] * m_numBlocks[1] * m_numBlocks[2];
+
+	// pseudo normals to determine the sign of the distance (Baerentzen and Aanaes)
+	std::vector<Vector3r> faceNormals(numFaces);
+	std::vector<Vector3r> vertexNormals(numVertices, Vector3r::Zero());
+	std::vector<Vector3r> edgeNormals;
+	std::vector<unsigned int> edgeIndices(3 * numFaces);
+	std::unordered_map<uint64_t, unsigned int> edgeMap;
+	for (unsigned int f = 0; f < numFaces; f++)
+	{
+		const unsigned int *v = &faces[3 * f];
+		Vector3r n = (vertices[v[1]] - vertices[v[0]]).cross(vertices[v[2]] - vertices[v[0]]);
+		const Real len = n.norm();
+		if (len > 1.0e-12)
+			n /= len;
+		faceNormals[f] = n;
+
+		for (unsigned int j = 0; j < 3; j++)
+		{
+			const Vector3r e1 = (vertices[v[(j + 1) % 3]] - vertices[v[j]]).normalized();
+			const Vector3r e2 = (vertices[v[(j + 2) % 3]] - vertices[v[j]]).normalized();
+			const Real angle = acos(std::max(static_cast<Real>(-1.0), std::min(static_cast<Real>(1.0), e1.dot(e2))));
+			vertexNormals[v[j]] += angle * n;
+
+			auto it = edgeMap.find(edgeKey(v[j], v[(j + 1) % 3]));
+			if (it == edgeMap.end())
+			{
+				it = edgeMap.insert({ edgeKey(v[j], v[(j + 1) % 3]), (unsigned int)edgeNormals.size() }).first;
+				edgeNormals.push_back(Vector3r::Zero());
+			}
+			edgeNormals[it->second] += n;
+			edgeIndices[3 * f + j] = it->second;
+		}
+	}
+
+	// Collect the candidate triangles of each block. A block is allocated if a triangle is closer than
+	// the band width. The candidates additionally contain all triangles within the band width plus
+	// the block diagonal, so that the closest triangle of each node of an allocated block is a candidate.
+	const Real blockDiagonal = sqrt(static_cast<Real>(3.0)) * blockLength;
+	const Real candidateDistance = bandWidth + blockDiagonal;
+	std::vector<std::vector<unsigned int>> candidates(totalBlocks);
+	std::vector<char> nearSurface(totalBlocks, false);
+	for (unsigned int f = 0; f < numFaces; f++)
+	{
+		AlignedBox3r triBox;
+		for (unsigned int j = 0; j < 3; j++)
+			triBox.extend(vertices[faces[3 * f + j]]);
+		Eigen::Vector3i minBlock, maxBlock;
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			minBlock[i] = std::max(0, (int)floor((triBox.min()[i] - candidateDistance - m_origin[i]) / blockLength));
+			maxBlock[i] = std::min(m_numBlocks[i] - 1, (int)floor((triBox.max()[i] + candidateDistance - m_origin[i]) / blockLength));
+		}
+		for (int k = minBlock[2]; k <= maxBlock[2]; k++)
+			for (int j = minBlock[1]; j <= maxBlock[1]; j++)
+				for (int i = minBlock[0]; i <= maxBlock[0]; i++)
+				{
+					AlignedBox3r blockBox;
+					blockBox.min() = m_origin + blockLength * Vector3r((Real)i, (Real)j, (Real)k);
+					blockBox.max() = blockBox.min() + Vector3r::Constant(blockLength);
+					Vector3r d = (triBox.min() - blockBox.max()).cwiseMax(blockBox.min() - triBox.max()).cwiseMax(Vector3r::Zero());
+					const Real dist = d.norm();
+					if (dist > candidateDistance)
+						continue;
+					const unsigned int b = blockLinearIndex(i, j, k);
+					candidates[b].push_back(f);
+					if (dist <= bandWidth)
+						nearSurface[b] = true;
+				}
+	}
+
+	// allocate blocks
+	m_blockIndex.resize(totalBlocks);
+	std::vector<Eigen::Vector3i> allocatedBlocks;
+	for (int k = 0; k < m_numBlocks[2]; k++)
+		for (int j = 0; j < m_numBlocks[1]; j++)
+			for (int i = 0; i < m_numBlocks[0]; i++)
+			{
+				const unsigned int b = blockLinearIndex(i, j, k);
+				if (nearSurface[b])
+				{
+					m_blockIndex[b] = (int)allocatedBlocks.size();
+					allocatedBlocks.push_back(Eigen::Vector3i(i, j, k));
+				}
+				else
+					m_blockIndex[b] = EMPTY_OUTSIDE;
+			}
+	const unsigned int nodesPerBlock = BLOCK_NODES*BLOCK_NODES*BLOCK_NODES;
+	m_values.resize(allocatedBlocks.size() * nodesPerBlock);
+
+	#pragma omp parallel default(shared)
+	{
+		#pragma omp for schedule(dynamic, 4)
+		for (int i = 0; i < (int)allocatedBlocks.size(); i++)
+		{
+			const Eigen::Vector3i &block = allocatedBlocks[i];
+			computeBlockValues(i, block, vertices, faces, candidates[blockLinearIndex(block[0], block[1], block[2])],
+				faceNormals, vertexNormals, edgeNormals, edgeIndices);
+		}
+	}
+
+	determineSignOfEmptyBlocks();
+	computeEmptyBlockDirections();
+}
+
+void SparseSDF::computeBlockValues(const unsigned int blockIndex, const Eigen::Vector3i &block,
+	const Vector3r *vertices, const unsigned int *faces, const std::vector<unsigned int> &candidates,
+	const std::vector<Vector3r> &faceNormals, const std::vector<Vector3r> &vertexNormals,
+	const std::vector<Vector3r> &edgeNormals, const std::vector<unsigned int> &edgeIndices)
+{
+	float *values = &m_values[blockIndex * BLOCK_NODES*BLOCK_NODES*BLOCK_NODES];
+	const Vector3r blockOrigin = m_origin + (BLOCK_SIZE * m_cellSize) * block.cast<Real>();
+	for (int k = 0; k < BLOCK_NODES; k++)
+		for (int j = 0; j < BLOCK_NODES; j++)
+			for (int i = 0; i < BLOCK_NODES; i++)
+			{
+				const Vector3r x = blockOrigin + m_cellSize * Vector3r((Real)i, (Real)j, (Real)k);
+				Real minDist2 = std::numeric_limits<Real>::max();
+				Real sign = 1.0;
+				for (unsigned int c = 0; c < candidates.size(); c++)
+				{
+					const unsigned int f = candidates[c];
+					const unsigned int *v = &faces[3 * f];
+					Vector3r cp;
+					const TriangleRegion region = closestPointOnTriangle(x, vertices[v[0]], vertices[v[1]], vertices[v[2]], cp);
+					const Real dist2 = (x - cp).squaredNorm();
+					if (dist2 < minDist2)
+					{
+						minDist2 = dist2;
+						const Vector3r *n;
+						switch (region)
+						{
+						case VERTEX_A: n = &vertexNormals[v[0]]; break;
+						case VERTEX_B: n = &vertexNormals[v[1]]; break;
+						case VERTEX_C: n = &vertexNormals[v[2]]; break;
+						case EDGE_AB: n = &edgeNormals[edgeIndices[3 * f]]; break;
+						case EDGE_BC: n = &edgeNormals[edgeIndices[3 * f + 1]]; break;
+						case EDGE_CA: n = &edgeNormals[edgeIndices[3 * f + 2]]; break;
+						default: n = &faceNormals[f];
+						}
+						sign = ((x - cp).dot(*n) < 0.0) ? static_cast<Real>(-1.0) : static_cast<Real>(1.0);
+					}
+				}
+				const Real dist = std::min(std::sqrt(minDist2), m_bandWidth);
+				values[(k * BLOCK_NODES + j) * BLOCK_NODES + i] = static_cast<float>(sign * dist);
+			}
+}
+
+void SparseSDF::determineSignOfEmptyBlocks()
+{
+	// The empty blocks which are connected to the boundary of the domain are outside. All
+	// other empty blocks are enclosed by the surface.
+	const unsigned int totalBlocks = (unsigned int)m_blockIndex.size();
+	std::vector<char> visited(totalBlocks, false);
+	std::deque<Eigen::Vector3i> queue;
+	for (int k = 0; k < m_numBlocks[2]; k++)
+		for (int j = 0; j < m_numBlocks[1]; j++)
+			for (int i = 0; i < m_numBlocks[0]; i++)
+			{
+				const bool boundary = (i == 0) || (j == 0) || (k == 0) ||
+					(i == m_numBlocks[0] - 1) || (j == m_numBlocks[1] - 1) || (k == m_numBlocks[2] - 1);
+				const unsigned int b = blockLinearIndex(i, j, k);
+				if (boundary && (m_blockIndex[b] < 0))
+				{
+					visited[b] = true;
+					queue.push_back(Eigen::Vector3i(i, j, k));
+				}
+			}
+
+	while (!queue.empty())
+	{
+		const Eigen::Vector3i block = queue.front();
+		queue.pop_front();
+		for (int dim = 0; dim < 3; dim++)
+		{
+			for (int dir = -1; dir <= 1; dir += 2)
+			{
+				Eigen::Vector3i neighbor = block;
+				neighbor[dim] += dir;
+				if ((neighbor[dim] < 0) || (neighbor[dim] >= m_numBlocks[dim]))
+					continue;
+				const unsigned int b = blockLinearIndex(neighbor[0], neighbor[1], neighbor[2]);
+				if (!visited[b] && (m_blockIndex[b] < 0))
+				{
+					visited[b] = true;
+					queue.push_back(neighbor);
+				}
+			}
+		}
+	}
+
+	for (unsigned int b = 0; b < totalBlocks; b++)
+	{
+		if ((m_blockIndex[b] < 0) && !visited[b])
+			m_blockIndex[b] = EMPTY_INSIDE;
+	}
+}
+
+void SparseSDF::computeEmptyBlockDirections()
+{
+	// Breadth-first search from the allocated blocks. Each empty block stores the direction
+	// to the allocated block from which it was reached first.
+	const unsigned int totalBlocks = (unsigned int)m_blockIndex.size();
+	m_emptyBlockDirections.assign(totalBlocks, Eigen::Vector3f::Zero());
+	std::vector<Eigen::Vector3i> source(totalBlocks, Eigen::Vector3i::Constant(-1));
+	std::deque<Eigen::Vector3i> queue;
+	for (int k = 0; k < m_numBlocks[2]; k++)
+		for (int j = 0; j < m_numBlocks[1]; j++)
+			for (int i = 0; i < m_numBlocks[0]; i++)
+			{
+				const unsigned int b = blockLinearIndex(i, j, k);
+				if (m_blockIndex[b] >= 0)
+				{
+					source[b] = Eigen::Vector3i(i, j, k);
+					queue.push_back(source[b]);
+				}
+			}
+
+	while (!queue.empty())
+	{
+		const Eigen::Vector3i block = queue.front();
+		queue.pop_front();
+		const Eigen::Vector3i &blockSource = source[blockLinearIndex(block[0], block[1], block[2])];
+		for (int dim = 0; dim < 3; dim++)
+		{
+			for (int dir = -1; dir <= 1; dir += 2)
+			{
+				Eigen::Vector3i neighbor = block;
+				neighbor[dim] += dir;
+				if ((neighbor[dim] < 0) || (neighbor[dim] >= m_numBlocks[dim]))
+					continue;
+				const unsigned int b = blockLinearIndex(neighbor[0], neighbor[1], neighbor[2]);
+				if (source[b][0] < 0)
+				{
+					source[b] = blockSource;
+					m_emptyBlockDirections[b] = (blockSource - neighbor).cast<float>().normalized();
+					queue.push_back(neighbor);
+				}
+			}
+		}
+	}
+}
+
+double SparseSDF::interpolate(const Vector3r &x, Vector3r *gradient) const
+{
+	const Vector3r p = (x - m_origin) / m_cellSize;
+	Eigen::Vector3i cell;
+	for (int i = 0; i < 3; i++)
+	{
+		const int numCells = m_numBlocks[i] * BLOCK_SIZE;
+		if ((p[i] < 0.0) || (p[i] > (Real)numCells))
+		{
+			if (gradient)
+				gradient->setZero();
+			return std::numeric_limits<double>::max();
+		}
+		cell[i] = std::min((int)p[i], numCells - 1);
+	}
+	const Eigen::Vector3i block(cell[0] / BLOCK_SIZE, cell[1] / BLOCK_SIZE, cell[2] / BLOCK_SIZE);
+	const unsigned int b = blockLinearIndex(block[0], block[1], block[2]);
+	const int index = m_blockIndex[b];
+	if (index < 0)
+	{
+		// the distance increases towards the surface inside and away from it outside
+		if (gradient)
+		{
+			const Vector3r dir = m_emptyBlockDirections[b].cast<Real>();
+			*gradient = (index == EMPTY_INSIDE) ? dir : -dir;
+		}
+		return (index == EMPTY_INSIDE) ? -m_bandWidth : m_bandWidth;
+	}
+
+	const Eigen::Vector3i l = cell - BLOCK_SIZE * block;
+	const Vector3r t = p - cell.cast<Real>();
+	const float *values = &m_values[index * BLOCK_NODES*BLOCK_NODES*BLOCK_NODES + (l[2] * BLOCK_NODES + l[1]) * BLOCK_NODES + l[0]];
+	const int dy = BLOCK_NODES;
+	const int dz = BLOCK_NODES*BLOCK_NODES;
+	const Real c000 = values[0];
+	const Real c100 = values[1];
+	const Real c010 = values[dy];
+	const Real c110 = values[dy + 1];
+	const Real c001 = values[dz];
+	const Real c101 = values[dz + 1];
+	const Real c011 = values[dz + dy];
+	const Real c111 = values[dz + dy + 1];
+
+	const Real c00 = c000 + t[0] * (c100 - c000);
+	const Real c10 = c010 + t[0] * (c110 - c010);
+	const Real c01 = c001 + t[0] * (c101 - c001);
+	const Real c11 = c011 + t[0] * (c111 - c011);
+	const Real c0 = c00 + t[1] * (c10 - c00);
+	const Real c1 = c01 + t[1] * (c11 - c01);
+
+	if (gradient)
+	{
+		const Real invH = static_cast<Real>(1.0) / m_cellSize;
+		const Real dx0 = (1.0 - t[1]) * (c100 - c000) + t[1] * (c110 - c010);
+		const Real dx1 = (1.0 - t[1]) * (c101 - c001) + t[1] * (c111 - c011);
+		(*gradient)[0] = ((1.0 - t[2]) * dx0 + t[2] * dx1) * invH;
+		(*gradient)[1] = ((1.0 - t[2]) * (c10 - c00) + t[2] * (c11 - c01)) * invH;
+		(*gradient)[2] = (c1 - c0) * invH;
+	}
+	return c0 + t[2] * (c1 - c0);
+}
+
+bool SparseSDF::save(const std::string &fileName) const
+{
+	std::ofstream out(fileName, std::ios::binary);
+	if (!out.is_open())
+		return false;
+	const uint32_t header[2] = { SPARSE_SDF_MAGIC, SPARSE_SDF_VERSION };
+	const double origin[3] = { m_origin[0], m_origin[1], m_origin[2] };
+	const double cellSize = m_cellSize;
+	const double bandWidth = m_bandWidth;
+	const int32_t numBlocks[3] = { m_numBlocks[0], m_numBlocks[1], m_numBlocks[2] };
+	const uint64_t numValues = m_values.size();
+	out.write((const char*)header, sizeof(header));
+	out.write((const char*)origin, sizeof(origin));
+	out.write((const char*)&cellSize, sizeof(double));
+	out.write((const char*)&bandWidth, sizeof(double));
+	out.write((const char*)numBlocks, sizeof(numBlocks));
+	out.write((const char*)&numValues, sizeof(uint64_t));
+	out.write((const char*)m_blockIndex.data(), m_blockIndex.size() * sizeof(int));
+	out.write((const char*)m_values.data(), numValues * sizeof(float));
+	return out.good();
+}
+
+bool SparseSDF::load(const std::string &fileName)
+{
+	std::ifstream in(fileName, std::ios::binary);
+	if (!in.is_open())
+		return false;
+	uint32_t header[2];
+	double origin[3];
+	double cellSize, bandWidth;
+	int32_t numBlocks[3];
+	uint64_t numValues;
+	in.read((char*)header, sizeof(header));
+	if (!in.good() || (header[0] != SPARSE_SDF_MAGIC) || (header[1] != SPARSE_SDF_VERSION))
+		return false;
+	in.read((char*)origin, sizeof(origin));
+	in.read((char*)&cellSize, sizeof(double));
+	in.read((char*)&bandWidth, sizeof(double));
+	in.read((char*)numBlocks, sizeof(numBlocks));
+	in.read((char*)&numValues, sizeof(uint64_t));
+	if (!in.good())
+		return false;
+
+	// validate the header before any memory is allocated
+	if (!std::isfinite(cellSize) || (cellSize <= 0.0) || !std::isfinite(bandWidth) || (bandWidth < 0.0))
+		return false;
+	uint64_t totalBlocks = 1;
+	for (int i = 0; i < 3; i++)
+	{
+		if (!std::isfinite(origin[i]) || (numBlocks[i] <= 0) || (numBlocks[i] > std::numeric_limits<int>::max() / BLOCK_SIZE))
+			return false;
+		totalBlocks *= (uint64_t)numBlocks[i];
+		if (totalBlocks > (uint64_t)std::numeric_limits<int>::max())
+			return false;
+	}
+	const uint64_t nodesPerBlock = BLOCK_NODES*BLOCK_NODES*BLOCK_NODES;
+	if ((numValues % nodesPerBlock != 0) || (numValues / nodesPerBlock > totalBlocks))
+		return false;
+	const std::streamoff dataStart = in.tellg();
+	in.seekg(0, std::ios::end);
+	const std::streamoff fileSize = in.tellg();
+	in.seekg(dataStart);
+	if ((uint64_t)(fileSize - dataStart) != totalBlocks * sizeof(int) + numValues * sizeof(float))
+		return false;
+
+	std::vector<int> blockIndex((size_t)totalBlocks);
+	std::vector<float> values((size_t)numValues);
+	in.read((char*)blockIndex.data(), blockIndex.size() * sizeof(int));
+	in.read((char*)values.data(), values.size() * sizeof(float));
+	if (!in.good())
+		return false;
+
+	// each block index must refer to an allocated block or mark an empty block
+	const int numAllocated = (int)(numValues / nodesPerBlock);
+	for (size_t b = 0; b < blockIndex.size(); b++)
+	{
+		const int index = blockIndex[b];
+		if ((index >= numAllocated) || ((index < 0) && (index != EMPTY_OUTSIDE) && (index != EMPTY_INSIDE)))
+			return false;
+	}
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		if (!std::isfinite(values[i]))
+			return false;
+	}
+
+	m_origin = Vector3r((Real)origin[0], (Real)origin[1], (Real)origin[2]);
+	m_cellSize = (Real)cellSize;
+	m_bandWidth = (Real)bandWidth;
+	m_numBlocks = Eigen::Vector3i(numBlocks[0], numBlocks[1], numBlocks[2]);
+	m_blockIndex.swap(blockIndex);
+	m_values.swap(values);
+	computeEmptyBlockDirections();
+	return true;
+}
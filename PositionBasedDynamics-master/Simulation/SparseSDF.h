@@ -0,0 +1,101 @@
+#ifndef __SPARSESDF_H__
+#define __SPARSESDF_H__
+
+#include "Common/Common.h"
+#include "Utils/IndexedFaceMesh.h"
+#include <vector>
+#include <string>
+#include <memory>
+
+namespace PBD
+{
+	/** Sparse narrow-band signed distance field of a closed triangle mesh.
+	 *
+	 * The domain is divided into blocks of BLOCK_SIZE^3 cells. Only the blocks which are closer to
+	 * the surface than the band width are allocated. These blocks store the distance values at their
+	 * (BLOCK_SIZE+1)^3 nodes so that a query only accesses the memory of a single block. The values are
+	 * clamped to the band width and the empty blocks only store if they are inside or outside.
+	 * Therefore, the memory is proportional to the surface area of the mesh.
+	 */
+	class SparseSDF
+	{
+	public:
+		static const int BLOCK_SIZE = 8;
+		static const int BLOCK_NODES = BLOCK_SIZE + 1;
+
+	protected:
+		/** Block indices of empty blocks */
+		static const int EMPTY_OUTSIDE = -1;
+		static const int EMPTY_INSIDE = -2;
+
+		Vector3r m_origin;
+		Real m_cellSize;
+		Real m_bandWidth;
+		Eigen::Vector3i m_numBlocks;
+		/** Index of the allocated block or EMPTY_OUTSIDE/EMPTY_INSIDE for each block of the domain */
+		std::vector<int> m_blockIndex;
+		/** Nodal distance values of the allocated blocks. Single precision is sufficient since the
+		 * values are bounded by the band width. */
+		std::vector<float> m_values;
+		/** Direction from each empty block to the closest allocated block (zero for allocated blocks).
+		 * It approximates the gradient outside of the narrow band. */
+		std::vector<Eigen::Vector3f> m_emptyBlockDirections;
+
+		FORCE_INLINE unsigned int blockLinearIndex(const int i, const int j, const int k) const
+		{
+			return (k * m_numBlocks[1] + j) * m_numBlocks[0] + i;
+		}
+
+		void computeBlockValues(const unsigned int blockIndex, const Eigen::Vector3i &block,
+			const Vector3r *vertices, const unsigned int *faces, const std::vector<unsigned int> &candidates,
+			const std::vector<Vector3r> &faceNormals, const std::vector<Vector3r> &vertexNormals,
+			const std::vector<Vector3r> &edgeNormals, const std::vector<unsigned int> &edgeIndices);
+		void determineSignOfEmptyBlocks();
+		void computeEmptyBlockDirections();
+
+	public:
+		SparseSDF();
+		~SparseSDF();
+
+		/** Build the signed distance field of a closed triangle mesh.
+		 *
+		 * @param vertices vertex positions of the mesh
+		 * @param mesh triangle mesh
+		 * @param cellSize edge length of the grid cells
+		 * @param bandWidth distance to the surface up to which the field is stored
+		 */
+		void build(const Vector3r *vertices, const Utilities::IndexedFaceMesh &mesh, const Real cellSize, const Real bandWidth);
+		void build(const Vector3r *vertices, const unsigned int numVertices, const unsigned int *faces, const unsigned int numFaces, const Real cellSize, const Real bandWidth);
+
+		/** Return the signed distance at x and optionally its gradient. If x is outside of the domain,
+		 * std::numeric_limits<double>::max() is returned and the gradient is zero. Outside of the narrow
+		 * band the distance is clamped to the band width and the gradient is the unit direction 
+		 * to the closest block of the band (pointing away from it outside of the surface).
+		 */
+		double interpolate(const Vector3r &x, Vector3r *gradient = nullptr) const;
+
+		bool save(const std::string &fileName) const;
+		/** Load a field which was written by save(). False is returned if the file is not a valid
+		 * sparse distance field. In this case the field is not changed. */
+		bool load(const std::string &fileName);
+
+		/** Bounding box of the domain of the field */
+		AlignedBox3r getDomain() const
+		{
+			return AlignedBox3r(m_origin, m_origin + (BLOCK_SIZE * m_cellSize) * m_numBlocks.cast<Real>());
+		}
+
+		Real getCellSize() const { return m_cellSize; }
+		Real getBandWidth() const { return m_bandWidth; }
+		unsigned int numAllocatedBlocks() const { return (unsigned int) (m_values.size() / (BLOCK_NODES*BLOCK_NODES*BLOCK_NODES)); }
+		/** Memory of the distance field in bytes */
+		size_t memoryUsage() const
+		{
+			return m_values.size() * sizeof(float) + m_blockIndex.size() * sizeof(int) + m_emptyBlockDirections.size() * sizeof(Eigen::Vector3f);
+		}
+	};
+
+	using SparseSDFPtr = std::shared_ptr<SparseSDF>;
+}
+
+#endif
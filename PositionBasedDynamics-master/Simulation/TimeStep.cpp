@@ -9,6 +9,8 @@ using namespace GenParam;
 
 TimeStep::TimeStep()
 {
+	m_forceCallback = NULL;
+	m_forceCallbackUserData = NULL;
 }
 
 TimeStep::~TimeStep(void)
@@ -41,6 +43,7 @@ void TimeStep::clearAccelerations(SimulationModel &model)
 		{
 			Vector3r &a = rb[i]->getAcceleration();
 			a = grav;
+			rb[i]->getTorque().setZero();
 		}
 	}
 
@@ -59,6 +62,9 @@ void TimeStep::clearAccelerations(SimulationModel &model)
 			a = grav;
 		}
 	}
+
+	if (m_forceCallback)
+		m_forceCallback(m_forceCallbackUserData);
 }
 
 void TimeStep::reset()
@@ -70,6 +76,13 @@ void TimeStep::setCollisionDetection(SimulationModel &model, CollisionDetection
 	m_collisionDetection = cd;
 	m_collisionDetection->setContactCallback(contactCallbackFunction, &model);
 	m_collisionDetection->setSolidContactCallback(solidContactCallbackFunction, &model);
+	m_collisionDetection->setDefaultContactCallbacks(true);
+}
+
+void TimeStep::setForceCallback(ForceCallbackFunction f, void *userData)
+{
+	m_forceCallback = f;
+	m_forceCallbackUserData = userData;
 }
 
 CollisionDetection *TimeStep::getCollisionDetection()
@@ -12,11 +12,16 @@ namespace PBD
 	*/
 	class TimeStep : public GenParam::ParameterObject
 	{
+	public:
+		typedef void(*ForceCallbackFunction)(void *userData);
+
 	protected:
 		CollisionDetection *m_collisionDetection;
+		/** Callback which adds external forces after the accelerations were cleared */
+		ForceCallbackFunction m_forceCallback;
+		void *m_forceCallbackUserData;
 
-		/** Clear accelerations and add gravitation.
-		*/
+		/** Clear accelerations and torques, add gravitation and call the force callback. */
 		void clearAccelerations(SimulationModel &model);
 
 		virtual void initParameters();
@@ -45,6 +50,11 @@ namespace PBD
 
 		void setCollisionDetection(SimulationModel &model, CollisionDetection *cd);
 		CollisionDetection *getCollisionDetection();
+
+		/** Set a function which adds external forces (e.g. of a coupled fluid) to the accelerations 
+		 * and torques of the bodies. It is called in each step after the accelerations were cleared.
+		 */
+		void setForceCallback(ForceCallbackFunction f, void *userData);
 	};
 }
 
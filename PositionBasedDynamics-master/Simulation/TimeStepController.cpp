@@ -15,8 +15,21 @@ using namespace GenParam;
 int TimeStepController::MAX_ITERATIONS = -1;
 int TimeStepController::MAX_ITERATIONS_V = -1;
 int TimeStepController::VELOCITY_UPDATE_METHOD = -1;
+int TimeStepController::ENABLE_SLEEPING = -1;
+int TimeStepController::SLEEP_LINEAR_VELOCITY = -1;
+int TimeStepController::SLEEP_ANGULAR_VELOCITY = -1;
+int TimeStepController::SLEEP_TIME = -1;
+int TimeStepController::ENABLE_CFL = -1;
+int TimeStepController::CFL_FACTOR = -1;
+int TimeStepController::CFL_LENGTH_SCALE = -1;
+int TimeStepController::CFL_MIN_TIME_STEP_SIZE = -1;
+int TimeStepController::CFL_MAX_TIME_STEP_SIZE = -1;
+int TimeStepController::JOINT_SOLVER = -1;
 int TimeStepController::ENUM_VUPDATE_FIRST_ORDER = -1;
 int TimeStepController::ENUM_VUPDATE_SECOND_ORDER = -1;
+int TimeStepController::ENUM_JOINT_SOLVER_GAUSS_SEIDEL = -1;
+int TimeStepController::ENUM_JOINT_SOLVER_SPARSE = -1;
+int TimeStepController::ENUM_JOINT_SOLVER_ARTICULATED = -1;
 bool control = false;
 float Treshold = 0.2;
 
@@ -51,7 +64,7 @@ void build_tree(int pos, int l,int r, ParticleData &pd)
 	tree[pos].miny = pd.getPosition(l)(2, 0);
 	tree[pos].maxy = pd.getPosition(l)(2, 0);
 
-	if (l == r) { map[l] = pos; return; }
+	if (l == r) { ::map[l] = pos; return; }
 	build_tree(pos + pos, l , mid, pd);
 	build_tree(pos + pos + 1, mid + 1, r, pd);
 
@@ -98,7 +111,7 @@ void update(int l,int r)
 			overlap2[i][j] = false;
 	for (int i = l; i < r; i++)
 	{
-		tree_ask(map[i], 1);
+		tree_ask(::map[i], 1);
 		//printf("%d ",map[i]);
 	}
 	//printf("\n");
@@ -117,6 +130,17 @@ TimeStepController::TimeStepController()
 	m_maxIterations = 5;
 	m_maxIterationsV = 5;
 	m_collisionDetection = NULL;	
+	m_enableSleeping = false;
+	m_sleepLinearVelocity = static_cast<Real>(0.05);
+	m_sleepAngularVelocity = static_cast<Real>(0.05);
+	m_sleepTime = static_cast<Real>(0.5);
+	m_enableCFL = false;
+	m_cflFactor = static_cast<Real>(0.5);
+	m_cflLengthScale = static_cast<Real>(0.05);
+	m_cflMinTimeStepSize = static_cast<Real>(0.0001);
+	m_cflMaxTimeStepSize = static_cast<Real>(0.005);
+	m_jointSolver = 0;
+	m_motorsNumConstraints = 0;
 }
 
 TimeStepController::~TimeStepController(void)
@@ -153,28 +177,100 @@ void TimeStepController::initParameters()
 	EnumParameter* enumParam = static_cast<EnumParameter*>(getParameter(VELOCITY_UPDATE_METHOD));
 	enumParam->addEnumValue("First Order Update", ENUM_VUPDATE_FIRST_ORDER);
 	enumParam->addEnumValue("Second Order Update", ENUM_VUPDATE_SECOND_ORDER);
+
+	JOINT_SOLVER = createEnumParameter("jointSolver", "Joint solver", &m_jointSolver);
+	setGroup(JOINT_SOLVER, "PBD");
+	setDescription(JOINT_SOLVER, "Solver of the ball, hinge and universal joints. The direct solvers converge faster for long chains, the articulated body solver requires O(n) per iteration and solves loop closures locally.");
+	enumParam = static_cast<EnumParameter*>(getParameter(JOINT_SOLVER));
+	enumParam->addEnumValue("Gauss-Seidel", ENUM_JOINT_SOLVER_GAUSS_SEIDEL);
+	enumParam->addEnumValue("Sparse direct", ENUM_JOINT_SOLVER_SPARSE);
+	enumParam->addEnumValue("Articulated body", ENUM_JOINT_SOLVER_ARTICULATED);
+
+	ENABLE_SLEEPING = createBoolParameter("enableSleeping", "Enable sleeping", &m_enableSleeping);
+	setGroup(ENABLE_SLEEPING, "PBD");
+	setDescription(ENABLE_SLEEPING, "Deactivate islands of rigid bodies which are at rest.");
+
+	SLEEP_LINEAR_VELOCITY = createNumericParameter("sleepLinearVelocity", "Sleep linear velocity", &m_sleepLinearVelocity);
+	setGroup(SLEEP_LINEAR_VELOCITY, "PBD");
+	setDescription(SLEEP_LINEAR_VELOCITY, "A rigid body is at rest if its velocity is below this threshold.");
+	static_cast<NumericParameter<Real>*>(getParameter(SLEEP_LINEAR_VELOCITY))->setMinValue(0.0);
+
+	SLEEP_ANGULAR_VELOCITY = createNumericParameter("sleepAngularVelocity", "Sleep angular velocity", &m_sleepAngularVelocity);
+	setGroup(SLEEP_ANGULAR_VELOCITY, "PBD");
+	setDescription(SLEEP_ANGULAR_VELOCITY, "A rigid body is at rest if its angular velocity is below this threshold.");
+	static_cast<NumericParameter<Real>*>(getParameter(SLEEP_ANGULAR_VELOCITY))->setMinValue(0.0);
+
+	SLEEP_TIME = createNumericParameter("sleepTime", "Sleep time", &m_sleepTime);
+	setGroup(SLEEP_TIME, "PBD");
+	setDescription(SLEEP_TIME, "Time an island must be at rest before it is put to sleep.");
+	static_cast<NumericParameter<Real>*>(getParameter(SLEEP_TIME))->setMinValue(0.0);
+
+	ENABLE_CFL = createBoolParameter("enableCFL", "Adaptive time step size", &m_enableCFL);
+	setGroup(ENABLE_CFL, "PBD");
+	setDescription(ENABLE_CFL, "Adapt the time step size by the CFL condition.");
+
+	CFL_FACTOR = createNumericParameter("cflFactor", "CFL factor", &m_cflFactor);
+	setGroup(CFL_FACTOR, "PBD");
+	setDescription(CFL_FACTOR, "Fraction of the CFL length scale which a vertex may move in one time step.");
+	static_cast<NumericParameter<Real>*>(getParameter(CFL_FACTOR))->setMinValue(static_cast<Real>(1e-6));
+
+	CFL_LENGTH_SCALE = createNumericParameter("cflLengthScale", "CFL length scale", &m_cflLengthScale);
+	setGroup(CFL_LENGTH_SCALE, "PBD");
+	setDescription(CFL_LENGTH_SCALE, "Characteristic length of the scene, e.g. the thickness of the thinnest object.");
+	static_cast<NumericParameter<Real>*>(getParameter(CFL_LENGTH_SCALE))->setMinValue(static_cast<Real>(1e-6));
+
+	CFL_MIN_TIME_STEP_SIZE = createNumericParameter("cflMinTimeStepSize", "Min. time step size", &m_cflMinTimeStepSize);
+	setGroup(CFL_MIN_TIME_STEP_SIZE, "PBD");
+	setDescription(CFL_MIN_TIME_STEP_SIZE, "Minimal time step size of the adaptive time stepping.");
+	static_cast<NumericParameter<Real>*>(getParameter(CFL_MIN_TIME_STEP_SIZE))->setMinValue(static_cast<Real>(1e-6));
+
+	CFL_MAX_TIME_STEP_SIZE = createNumericParameter("cflMaxTimeStepSize", "Max. time step size", &m_cflMaxTimeStepSize);
+	setGroup(CFL_MAX_TIME_STEP_SIZE, "PBD");
+	setDescription(CFL_MAX_TIME_STEP_SIZE, "Maximal time step size of the adaptive time stepping.");
+	static_cast<NumericParameter<Real>*>(getParameter(CFL_MAX_TIME_STEP_SIZE))->setMinValue(static_cast<Real>(1e-6));
+}
+
+/** Update the time step size of the TimeManager by the CFL condition.
+*/
+void TimeStepController::updateTimeStepSizeCFL(SimulationModel &model)
+{
+	m_adaptiveTimeStep.setCFLFactor(m_cflFactor);
+	m_adaptiveTimeStep.setMinTimeStepSize(m_cflMinTimeStepSize);
+	m_adaptiveTimeStep.setMaxTimeStepSize(m_cflMaxTimeStepSize);
+
+	TimeManager *tm = TimeManager::getCurrent();
+	const Real maxVel = std::max(m_adaptiveTimeStep.maxRigidBodyVelocity(model),
+		AdaptiveTimeStep::maxParticleVelocity(model.getParticles(), tm->getTimeStepSize()));
+	tm->setTimeStepSize(m_adaptiveTimeStep.computeTimeStepSize(maxVel, m_cflLengthScale));
 }
 
 void TimeStepController::step(SimulationModel &model)
 {
 	START_TIMING("simulation step");
 	TimeManager *tm = TimeManager::getCurrent ();
-	const Real h = tm->getTimeStepSize();
  
 	//////////////////////////////////////////////////////////////////////////
 	// rigid body model
 	//////////////////////////////////////////////////////////////////////////
 	clearAccelerations(model);
+
+	if (m_enableCFL)
+		updateTimeStepSizeCFL(model);
+	const Real h = tm->getTimeStepSize();
 	SimulationModel::RigidBodyVector &rb = model.getRigidBodies();
 	ParticleData &pd = model.getParticles();
 	OrientationData &od = model.getOrientations();
 
 	const int numBodies = (int)rb.size();
+	updateSleepingConstraints(model);
+
 	#pragma omp parallel if(numBodies > MIN_PARALLEL_SIZE) default(shared)
 	{
 		#pragma omp for schedule(static) nowait
 		for (int i = 0; i < numBodies; i++)
 		{ 
+			if (rb[i]->isSleeping())
+				continue;
 			rb[i]->getLastPosition() = rb[i]->getOldPosition();
 			rb[i]->getOldPosition() = rb[i]->getPosition();
 			TimeIntegration::semiImplicitEuler(h, rb[i]->getMass(), rb[i]->getPosition(), rb[i]->getVelocity(), rb[i]->getAcceleration());
@@ -217,6 +313,8 @@ void TimeStepController::step(SimulationModel &model)
 		#pragma omp for schedule(static) nowait
 		for (int i = 0; i < numBodies; i++)
 		{
+			if (rb[i]->isSleeping())
+				continue;
 			if (m_velocityUpdateMethod == 0)
 			{
 				TimeIntegration::velocityUpdateFirstOrder(h, rb[i]->getMass(), rb[i]->getPosition(), rb[i]->getOldPosition(), rb[i]->getVelocity());
@@ -227,8 +325,8 @@ void TimeStepController::step(SimulationModel &model)
 				TimeIntegration::velocityUpdateSecondOrder(h, rb[i]->getMass(), rb[i]->getPosition(), rb[i]->getOldPosition(), rb[i]->getLastPosition(), rb[i]->getVelocity());
 				TimeIntegration::angularVelocityUpdateSecondOrder(h, rb[i]->getMass(), rb[i]->getRotation(), rb[i]->getOldRotation(), rb[i]->getLastRotation(), rb[i]->getAngularVelocity());
 			}
-			// update geometry
-			rb[i]->getGeometry().updateMeshTransformation(rb[i]->getPosition(), rb[i]->getRotationMatrix());
+			// update geometry, the mesh is transformed on demand
+			rb[i]->getGeometry().setTransformation(rb[i]->getPosition(), rb[i]->getRotationMatrix());
 		}
 
 		// Update velocities	
@@ -261,45 +359,11 @@ void TimeStepController::step(SimulationModel &model)
 
 	velocityConstraintProjection(model);
 
-	//////////////////////////////////////////////////////////////////////////
-	// update motor joint targets
-	//////////////////////////////////////////////////////////////////////////
-	SimulationModel::ConstraintVector &constraints = model.getConstraints();
-	for (unsigned int i = 0; i < constraints.size(); i++)
-	{
-		if ((constraints[i]->getTypeId() == TargetAngleMotorHingeJoint::TYPE_ID) ||
-			(constraints[i]->getTypeId() == TargetVelocityMotorHingeJoint::TYPE_ID) ||
-			(constraints[i]->getTypeId() == TargetPositionMotorSliderJoint::TYPE_ID) ||
-			(constraints[i]->getTypeId() == TargetVelocityMotorSliderJoint::TYPE_ID))
-		{
-			MotorJoint *motor = (MotorJoint*)constraints[i];
-			const std::vector<Real> sequence = motor->getTargetSequence();
-			if (sequence.size() > 0)
-			{
-				Real time = tm->getTime();
-				const Real sequenceDuration = sequence[sequence.size() - 2] - sequence[0];
-				if (motor->getRepeatSequence())
-				{
-					while (time > sequenceDuration)
-						time -= sequenceDuration;
-				}
-				unsigned int index = 0;
-				while ((2*index < sequence.size()) && (sequence[2 * index] <= time))
-					index++;
+	if (m_enableSleeping)
+		updateIslands(model, h);
 
-				// linear interpolation
-				Real target = 0.0;
-				if (2 * index < sequence.size())
-				{
-					const Real alpha = (time - sequence[2 * (index - 1)]) / (sequence[2 * index] - sequence[2 * (index - 1)]);
-					target = (static_cast<Real>(1.0) - alpha) * sequence[2 * index - 1] + alpha * sequence[2 * index + 1];
-				}
-				else
-					target = sequence[sequence.size() - 1];
-				motor->setTarget(target);
-			}
-		}
-	}
+	// update motor joint targets
+	updateMotorTargets(model, tm->getTime());
 	
 	// compute new time	
 	tm->setTime (tm->getTime () + h);
@@ -308,6 +372,11 @@ void TimeStepController::step(SimulationModel &model)
 
 void TimeStepController::reset()
 {
+	m_constraintSleeping.clear();
+	m_sparseJointSolver.reset();
+	m_articulatedBodySolver.reset();
+	m_motors.clear();
+	m_motorsNumConstraints = 0;
 	m_iterations = 0;
 	m_iterationsV = 0;
 	m_maxIterations = 5;
@@ -327,6 +396,10 @@ void TimeStepController::positionConstraintProjection(SimulationModel &model)
 	SimulationModel::RigidBodyContactConstraintVector &contacts = model.getRigidBodyContactConstraints();
 	SimulationModel::ParticleSolidContactConstraintVector &particleTetContacts = model.getParticleSolidContactConstraints();
 
+	// contacts of one group do not share a dynamic body and can be solved in parallel
+	model.initContactGroups();
+	SimulationModel::ConstraintGroupVector &particleTetContactGroups = model.getParticleSolidContactGroups();
+
 	// init constraints for this time step if necessary
 	for (auto & constraint : constraints)
 	{
@@ -338,6 +411,10 @@ void TimeStepController::positionConstraintProjection(SimulationModel &model)
 	{
 		int nc = 0;
 		int c = 0;
+		// the supported joints are solved globally, if the factorization fails they are solved locally
+		const bool jointsSolved = (m_jointSolver == 1) && m_sparseJointSolver.solvePositionConstraints(model);
+		if (m_jointSolver == 2)
+			m_articulatedBodySolver.solvePositionConstraints(model);
 		for (unsigned int group = 0; group < groups.size(); group++)
 		{
 			const int groupSize = (int)groups[group].size();
@@ -347,6 +424,12 @@ void TimeStepController::positionConstraintProjection(SimulationModel &model)
 				for (int i = 0; i < groupSize; i++)
 				{
 					const unsigned int constraintIndex = groups[group][i];
+					if (isConstraintSleeping(constraintIndex))
+						continue;
+					if (jointsSolved && m_sparseJointSolver.isHandled(constraintIndex))
+						continue;
+					if ((m_jointSolver == 2) && m_articulatedBodySolver.isHandled(constraintIndex))
+						continue;
 					if(constraints[constraintIndex] -> getTypeId() == LineLineConstraint::TYPE_ID)
 					{
 						int p0 = constraints[constraintIndex] -> m_bodies[0];
@@ -382,9 +465,15 @@ void TimeStepController::positionConstraintProjection(SimulationModel &model)
 			}
 		}
 		//printf("%d	%d\n", c, c + nc);// << c << ' ' << c + nc << endl;
-		for (unsigned int i = 0; i < particleTetContacts.size(); i++)
+		for (unsigned int group = 0; group < particleTetContactGroups.size(); group++)
 		{
-			particleTetContacts[i].solvePositionConstraint(model, m_iterations);
+			const int groupSize = (int)particleTetContactGroups[group].size();
+			#pragma omp parallel if(groupSize > MIN_PARALLEL_SIZE) default(shared)
+			{
+				#pragma omp for schedule(static) 
+				for (int i = 0; i < groupSize; i++)
+					particleTetContacts[particleTetContactGroups[group][i]].solvePositionConstraint(model, m_iterations);
+			}
 		}
 
 		m_iterations++;
@@ -406,6 +495,12 @@ void TimeStepController::velocityConstraintProjection(SimulationModel &model)
 	SimulationModel::ParticleRigidBodyContactConstraintVector &particleRigidBodyContacts = model.getParticleRigidBodyContactConstraints();
 	SimulationModel::ParticleSolidContactConstraintVector &particleTetContacts = model.getParticleSolidContactConstraints();
 
+	// contacts of one group do not share a dynamic body and can be solved in parallel
+	model.initContactGroups();
+	SimulationModel::ConstraintGroupVector &rigidBodyContactGroups = model.getRigidBodyContactGroups();
+	SimulationModel::ConstraintGroupVector &particleRigidBodyContactGroups = model.getParticleRigidBodyContactGroups();
+	SimulationModel::ConstraintGroupVector &particleTetContactGroups = model.getParticleSolidContactGroups();
+
 	for (unsigned int group = 0; group < groups.size(); group++)
 	{
 		const int groupSize = (int)groups[group].size();
@@ -415,7 +510,29 @@ void TimeStepController::velocityConstraintProjection(SimulationModel &model)
 			for (int i = 0; i < groupSize; i++)
 			{
 				const unsigned int constraintIndex = groups[group][i];
-				constraints[constraintIndex]->updateConstraint(model);
+				if (!isConstraintSleeping(constraintIndex))
+					constraints[constraintIndex]->updateConstraint(model);
+			}
+		}
+	}
+
+	// warm start: apply the impulses of persistent contacts from the last step
+	for (unsigned int group = 0; group < rigidBodyContactGroups.size(); group++)
+	{
+		const int groupSize = (int)rigidBodyContactGroups[group].size();
+		#pragma omp parallel if(groupSize > MIN_PARALLEL_SIZE) default(shared)
+		{
+			#pragma omp for schedule(static) 
+			for (int i = 0; i < groupSize; i++)
+			{
+				RigidBodyContactConstraint &cc = rigidBodyContacts[rigidBodyContactGroups[group][i]];
+				if (cc.m_sum_impulses == 0.0)
+					continue;
+				const RigidBody *rb1 = rb[cc.m_bodies[0]];
+				const RigidBody *rb2 = rb[cc.m_bodies[1]];
+				if ((rb1->isSleeping() || (rb1->getMass() == 0.0)) && (rb2->isSleeping() || (rb2->getMass() == 0.0)))
+					continue;
+				cc.applyWarmStartImpulse(model);
 			}
 		}
 	}
@@ -431,26 +548,254 @@ void TimeStepController::velocityConstraintProjection(SimulationModel &model)
 				for (int i = 0; i < groupSize; i++)
 				{
 					const unsigned int constraintIndex = groups[group][i];
-					constraints[constraintIndex]->solveVelocityConstraint(model, m_iterationsV);
+					if (!isConstraintSleeping(constraintIndex))
+						constraints[constraintIndex]->solveVelocityConstraint(model, m_iterationsV);
 				}
 			}
 		}
 
 		// solve contacts
-		for (unsigned int i = 0; i < rigidBodyContacts.size(); i++)
+		for (unsigned int group = 0; group < rigidBodyContactGroups.size(); group++)
 		{
-			rigidBodyContacts[i].solveVelocityConstraint(model, m_iterationsV);
+			const int groupSize = (int)rigidBodyContactGroups[group].size();
+			#pragma omp parallel if(groupSize > MIN_PARALLEL_SIZE) default(shared)
+			{
+				#pragma omp for schedule(static) 
+				for (int i = 0; i < groupSize; i++)
+				{
+					RigidBodyContactConstraint &cc = rigidBodyContacts[rigidBodyContactGroups[group][i]];
+					// contacts between sleeping and static bodies are at rest
+					const RigidBody *rb1 = rb[cc.m_bodies[0]];
+					const RigidBody *rb2 = rb[cc.m_bodies[1]];
+					if ((rb1->isSleeping() || (rb1->getMass() == 0.0)) && (rb2->isSleeping() || (rb2->getMass() == 0.0)))
+						continue;
+					cc.solveVelocityConstraint(model, m_iterationsV);
+				}
+			}
 		}
-		for (unsigned int i = 0; i < particleRigidBodyContacts.size(); i++)
+		for (unsigned int group = 0; group < particleRigidBodyContactGroups.size(); group++)
 		{
-			particleRigidBodyContacts[i].solveVelocityConstraint(model, m_iterationsV);
+			const int groupSize = (int)particleRigidBodyContactGroups[group].size();
+			#pragma omp parallel if(groupSize > MIN_PARALLEL_SIZE) default(shared)
+			{
+				#pragma omp for schedule(static) 
+				for (int i = 0; i < groupSize; i++)
+					particleRigidBodyContacts[particleRigidBodyContactGroups[group][i]].solveVelocityConstraint(model, m_iterationsV);
+			}
 		}
-		for (unsigned int i = 0; i < particleTetContacts.size(); i++)
+		for (unsigned int group = 0; group < particleTetContactGroups.size(); group++)
 		{
-			particleTetContacts[i].solveVelocityConstraint(model, m_iterationsV);
+			const int groupSize = (int)particleTetContactGroups[group].size();
+			#pragma omp parallel if(groupSize > MIN_PARALLEL_SIZE) default(shared)
+			{
+				#pragma omp for schedule(static) 
+				for (int i = 0; i < groupSize; i++)
+					particleTetContacts[particleTetContactGroups[group][i]].solveVelocityConstraint(model, m_iterationsV);
+			}
 		}
 		m_iterationsV++;
 	}
 }
 
+namespace
+{
+	bool isRigidBodyJoint(const int typeId)
+	{
+		return (typeId == BallJoint::TYPE_ID) ||
+			(typeId == BallOnLineJoint::TYPE_ID) ||
+			(typeId == HingeJoint::TYPE_ID) ||
+			(typeId == UniversalJoint::TYPE_ID) ||
+			(typeId == SliderJoint::TYPE_ID) ||
+			(typeId == RigidBodySpring::TYPE_ID) ||
+			(typeId == StretchBendingTwistingConstraint::TYPE_ID) ||
+			(typeId == TargetAngleMotorHingeJoint::TYPE_ID) ||
+			(typeId == TargetVelocityMotorHingeJoint::TYPE_ID) ||
+			(typeId == TargetPositionMotorSliderJoint::TYPE_ID) ||
+			(typeId == TargetVelocityMotorSliderJoint::TYPE_ID);
+	}
+
+	bool isMotorJoint(const int typeId)
+	{
+		return (typeId == TargetAngleMotorHingeJoint::TYPE_ID) ||
+			(typeId == TargetVelocityMotorHingeJoint::TYPE_ID) ||
+			(typeId == TargetPositionMotorSliderJoint::TYPE_ID) ||
+			(typeId == TargetVelocityMotorSliderJoint::TYPE_ID);
+	}
 
+	unsigned int findIsland(std::vector<unsigned int> &parent, unsigned int i)
+	{
+		while (parent[i] != i)
+		{
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	}
+
+	void uniteIslands(std::vector<unsigned int> &parent, const unsigned int i, const unsigned int j)
+	{
+		const unsigned int ri = findIsland(parent, i);
+		const unsigned int rj = findIsland(parent, j);
+		if (ri != rj)
+			parent[std::max(ri, rj)] = std::min(ri, rj);
+	}
+}
+
+void TimeStepController::updateMotorTargets(SimulationModel &model, const Real time)
+{
+	SimulationModel::ConstraintVector &constraints = model.getConstraints();
+	// the motor list is collected again if constraints were added or removed
+	if (constraints.size() != m_motorsNumConstraints)
+	{
+		m_motors.clear();
+		for (unsigned int i = 0; i < constraints.size(); i++)
+		{
+			if (isMotorJoint(constraints[i]->getTypeId()))
+				m_motors.push_back(i);
+		}
+		m_motorsNumConstraints = (unsigned int)constraints.size();
+	}
+
+	for (size_t i = 0; i < m_motors.size(); i++)
+	{
+		MotorJoint *motor = static_cast<MotorJoint*>(constraints[m_motors[i]]);
+		motor->updateTarget(time);
+	}
+}
+
+void TimeStepController::updateSleepingConstraints(SimulationModel &model)
+{
+	SimulationModel::RigidBodyVector &rb = model.getRigidBodies();
+	SimulationModel::ConstraintVector &constraints = model.getConstraints();
+	if (!m_enableSleeping)
+	{
+		// wake up all bodies when sleeping was disabled
+		for (unsigned int i = 0; i < rb.size(); i++)
+		{
+			if (rb[i]->isSleeping())
+				rb[i]->wakeUp();
+		}
+		m_constraintSleeping.clear();
+		return;
+	}
+	m_constraintSleeping.resize(constraints.size());
+
+	#pragma omp parallel for schedule(static) if(constraints.size() > MIN_PARALLEL_SIZE) default(shared)
+	for (int i = 0; i < (int)constraints.size(); i++)
+	{
+		const Constraint *c = constraints[i];
+		bool sleeping = false;
+		if (isRigidBodyJoint(c->getTypeId()))
+		{
+			const RigidBody *rb1 = rb[c->m_bodies[0]];
+			const RigidBody *rb2 = rb[c->m_bodies[1]];
+			sleeping = (rb1->isSleeping() || rb2->isSleeping()) &&
+				(rb1->isSleeping() || (rb1->getMass() == 0.0)) &&
+				(rb2->isSleeping() || (rb2->getMass() == 0.0));
+		}
+		m_constraintSleeping[i] = sleeping;
+	}
+}
+
+void TimeStepController::updateIslands(SimulationModel &model, const Real h)
+{
+	SimulationModel::RigidBodyVector &rb = model.getRigidBodies();
+	SimulationModel::ConstraintVector &constraints = model.getConstraints();
+	SimulationModel::RigidBodyContactConstraintVector &rigidBodyContacts = model.getRigidBodyContactConstraints();
+	SimulationModel::ParticleRigidBodyContactConstraintVector &particleRigidBodyContacts = model.getParticleRigidBodyContactConstraints();
+	const ParticleData &pd = model.getParticles();
+	const unsigned int numBodies = (unsigned int)rb.size();
+
+	m_islandParent.resize(numBodies);
+	m_islandRestTime.resize(numBodies);
+	m_islandAwake.resize(numBodies);
+
+	// update the rest time of the bodies
+	const Real linearThreshold2 = m_sleepLinearVelocity * m_sleepLinearVelocity;
+	const Real angularThreshold2 = m_sleepAngularVelocity * m_sleepAngularVelocity;
+	for (unsigned int i = 0; i < numBodies; i++)
+	{
+		m_islandParent[i] = i;
+		m_islandRestTime[i] = REAL_MAX;
+		m_islandAwake[i] = false;
+		if (rb[i]->getMass() == 0.0)
+			continue;
+		if ((rb[i]->getVelocity().squaredNorm() < linearThreshold2) &&
+			(rb[i]->getAngularVelocity().squaredNorm() < angularThreshold2))
+			rb[i]->getRestTime() += h;
+		else
+			rb[i]->getRestTime() = 0.0;
+	}
+
+	// Joints connect the bodies of an island. Static bodies do not connect islands.
+	for (unsigned int i = 0; i < constraints.size(); i++)
+	{
+		const Constraint *c = constraints[i];
+		const int typeId = c->getTypeId();
+		if (isRigidBodyJoint(typeId))
+		{
+			const unsigned int i1 = c->m_bodies[0];
+			const unsigned int i2 = c->m_bodies[1];
+			if ((rb[i1]->getMass() != 0.0) && (rb[i2]->getMass() != 0.0))
+				uniteIslands(m_islandParent, i1, i2);
+			// motors change their targets, so their bodies are kept awake
+			if (isMotorJoint(typeId))
+				m_islandAwake[i1] = m_islandAwake[i2] = true;
+		}
+		else if (typeId == RigidBodyParticleBallJoint::TYPE_ID)
+			m_islandAwake[c->m_bodies[0]] = true;
+		else if (typeId == DirectPositionBasedSolverForStiffRodsConstraint::TYPE_ID)
+		{
+			// the segments of the rod are not known here
+			for (unsigned int j = 0; j < numBodies; j++)
+				m_islandAwake[j] = true;
+		}
+	}
+	for (unsigned int i = 0; i < rigidBodyContacts.size(); i++)
+	{
+		const unsigned int i1 = rigidBodyContacts[i].m_bodies[0];
+		const unsigned int i2 = rigidBodyContacts[i].m_bodies[1];
+		if ((rb[i1]->getMass() != 0.0) && (rb[i2]->getMass() != 0.0))
+			uniteIslands(m_islandParent, i1, i2);
+	}
+	// a moving particle wakes up the body it touches
+	for (unsigned int i = 0; i < particleRigidBodyContacts.size(); i++)
+	{
+		const unsigned int particleIndex = particleRigidBodyContacts[i].m_bodies[0];
+		if ((pd.getMass(particleIndex) != 0.0) && (pd.getVelocity(particleIndex).squaredNorm() >= linearThreshold2))
+			m_islandAwake[particleRigidBodyContacts[i].m_bodies[1]] = true;
+	}
+
+	// the rest time of an island is the minimum rest time of its bodies
+	for (unsigned int i = 0; i < numBodies; i++)
+	{
+		if (rb[i]->getMass() == 0.0)
+			continue;
+		const unsigned int island = findIsland(m_islandParent, i);
+		m_islandRestTime[island] = std::min(m_islandRestTime[island], rb[i]->getRestTime());
+		if (m_islandAwake[i])
+			m_islandAwake[island] = true;
+	}
+
+	for (unsigned int i = 0; i < numBodies; i++)
+	{
+		if (rb[i]->getMass() == 0.0)
+			continue;
+		const unsigned int island = findIsland(m_islandParent, i);
+		const bool sleeping = !m_islandAwake[island] && (m_islandRestTime[island] >= m_sleepTime);
+		if (sleeping)
+		{
+			if (!rb[i]->isSleeping())
+			{
+				// keep the last positions consistent for the second order velocity update
+				rb[i]->getOldPosition() = rb[i]->getPosition();
+				rb[i]->getLastPosition() = rb[i]->getPosition();
+				rb[i]->getOldRotation() = rb[i]->getRotation();
+				rb[i]->getLastRotation() = rb[i]->getRotation();
+			}
+			rb[i]->getVelocity().setZero();
+			rb[i]->getAngularVelocity().setZero();
+		}
+		rb[i]->setSleeping(sleeping);
+	}
+}
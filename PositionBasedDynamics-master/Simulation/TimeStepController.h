@@ -5,6 +5,9 @@
 #include "TimeStep.h"
 #include "SimulationModel.h"
 #include "CollisionDetection.h"
+#include "AdaptiveTimeStep.h"
+#include "SparseJointSolver.h"
+#include "ArticulatedBodySolver.h"
 
 namespace PBD
 {
@@ -16,9 +19,22 @@ namespace PBD
 		static int MAX_ITERATIONS;
 		static int MAX_ITERATIONS_V;
 		static int VELOCITY_UPDATE_METHOD;
+		static int ENABLE_SLEEPING;
+		static int SLEEP_LINEAR_VELOCITY;
+		static int SLEEP_ANGULAR_VELOCITY;
+		static int SLEEP_TIME;
+		static int ENABLE_CFL;
+		static int CFL_FACTOR;
+		static int CFL_LENGTH_SCALE;
+		static int CFL_MIN_TIME_STEP_SIZE;
+		static int CFL_MAX_TIME_STEP_SIZE;
+		static int JOINT_SOLVER;
 
 		static int ENUM_VUPDATE_FIRST_ORDER;
 		static int ENUM_VUPDATE_SECOND_ORDER;
+		static int ENUM_JOINT_SOLVER_GAUSS_SEIDEL;
+		static int ENUM_JOINT_SOLVER_SPARSE;
+		static int ENUM_JOINT_SOLVER_ARTICULATED;
 
 	protected:
 		int m_velocityUpdateMethod;
@@ -27,11 +43,55 @@ namespace PBD
 		unsigned int m_maxIterations;
 		unsigned int m_maxIterationsV;
 
+		bool m_enableSleeping;
+		Real m_sleepLinearVelocity;
+		Real m_sleepAngularVelocity;
+		Real m_sleepTime;
+		/** union-find structure of the rigid body islands */
+		std::vector<unsigned int> m_islandParent;
+		std::vector<Real> m_islandRestTime;
+		std::vector<unsigned char> m_islandAwake;
+		/** flags for the constraints which only act on sleeping or static rigid bodies */
+		std::vector<unsigned char> m_constraintSleeping;
+
+		/** If enabled, the time step size of the TimeManager is adapted by the CFL condition
+		 * so that no particle or rigid body vertex moves further than cflFactor * cflLengthScale.
+		 */
+		bool m_enableCFL;
+		Real m_cflFactor;
+		Real m_cflLengthScale;
+		Real m_cflMinTimeStepSize;
+		Real m_cflMaxTimeStepSize;
+		AdaptiveTimeStep m_adaptiveTimeStep;
+		/** Solver of the ball, hinge and universal joints: local Gauss-Seidel projection (0),
+		 * global sparse direct solver (1) or linear time solver for articulated bodies (2). The
+		 * articulated body solver handles the joints of spanning trees, loop closures are solved
+		 * by the local projection.
+		 */
+		int m_jointSolver;
+		SparseJointSolver m_sparseJointSolver;
+		ArticulatedBodySolver m_articulatedBodySolver;
+		/** Indices of the motor joints in the constraint vector and the number of constraints
+		 * when the list was collected */
+		std::vector<unsigned int> m_motors;
+		unsigned int m_motorsNumConstraints;
+
 		virtual void initParameters();
 		
 		void positionConstraintProjection(SimulationModel &model);
 		void velocityConstraintProjection(SimulationModel &model);
 
+		/** Determine the islands of rigid bodies which are connected by joints or contacts.
+		 * An island is put to sleep if all its bodies are at rest for a certain time. It is woken up
+		 * if one of its bodies moves, e.g. due to a contact with an awake body.
+		 */
+		void updateIslands(SimulationModel &model, const Real h);
+		void updateSleepingConstraints(SimulationModel &model);
+		void updateTimeStepSizeCFL(SimulationModel &model);
+		/** Set the targets of the motor joints from their target sequences. */
+		void updateMotorTargets(SimulationModel &model, const Real time);
+		bool isConstraintSleeping(const unsigned int index) const { return (index < m_constraintSleeping.size()) && m_constraintSleeping[index]; }
+
 
 	public:
 		TimeStepController();
@@ -0,0 +1,171 @@
+#include "Common/Common.h"
+#include "Simulation/SparseSDF.h"
+#include "Discregrid/All"
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <limits>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+using namespace PBD;
+
+namespace
+{
+	int numFailures = 0;
+
+	void check(const bool condition, const std::string &message)
+	{
+		if (!condition)
+		{
+			std::cerr << "FAILED: " << message << std::endl;
+			numFailures++;
+		}
+	}
+
+	/** Closed box mesh with outward oriented faces */
+	void createBox(const Real halfExtent, std::vector<Vector3r> &vertices, std::vector<unsigned int> &faces)
+	{
+		vertices.resize(8);
+		for (unsigned int i = 0; i < 8; i++)
+			vertices[i] = halfExtent * Vector3r((i & 1) ? 1.0 : -1.0, (i & 2) ? 1.0 : -1.0, (i & 4) ? 1.0 : -1.0);
+		faces = { 0, 4, 6,  0, 6, 2,  1, 3, 7,  1, 7, 5,
+			0, 1, 5,  0, 5, 4,  2, 6, 7,  2, 7, 3,
+			0, 2, 3,  0, 3, 1,  4, 5, 7,  4, 7, 6 };
+	}
+
+	bool writeFile(const std::string &fileName, const std::vector<char> &data)
+	{
+		std::ofstream out(fileName, std::ios::binary);
+		out.write(data.data(), data.size());
+		return out.good();
+	}
+
+	std::vector<char> readFile(const std::string &fileName)
+	{
+		std::ifstream in(fileName, std::ios::binary);
+		return std::vector<char>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	}
+}
+
+/** Compare the sparse narrow-band field of a box with a dense cubic grid of the same mesh
+ * and check that save() and load() reproduce the field and that invalid files are rejected.
+ */
+int main()
+{
+	const Real halfExtent = 1.0;
+	const Real cellSize = 0.05;
+	const Real bandWidth = 0.2;
+	std::vector<Vector3r> vertices;
+	std::vector<unsigned int> faces;
+	createBox(halfExtent, vertices, faces);
+
+	SparseSDF sparse;
+	sparse.build(vertices.data(), (unsigned int)vertices.size(), faces.data(), (unsigned int)faces.size() / 3, cellSize, bandWidth);
+
+	// dense reference grid
+	std::vector<double> verticesd(3 * vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+		for (unsigned int j = 0; j < 3; j++)
+			verticesd[3 * i + j] = vertices[i][j];
+	Discregrid::TriangleMesh mesh(verticesd.data(), faces.data(), vertices.size(), faces.size() / 3);
+	Discregrid::MeshDistance md(mesh);
+	Eigen::AlignedBox3d domain(Eigen::Vector3d::Constant(-1.5), Eigen::Vector3d::Constant(1.5));
+	Discregrid::CubicLagrangeDiscreteGrid dense(domain, { 30, 30, 30 });
+	dense.addFunction([&md](Eigen::Vector3d const& xi) { return md.signedDistanceCached(xi); });
+
+	// The trilinear interpolation of the sparse field is exact on the faces of the box and has
+	// an error below the cell size at its edges and corners.
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<Real> coordinate(-1.5, 1.5);
+	std::vector<Vector3r> samples(10000);
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		const Vector3r x(coordinate(generator), coordinate(generator), coordinate(generator));
+		samples[i] = x;
+		const double d = dense.interpolate(0, x.template cast<double>());
+		Vector3r gradient;
+		const double s = sparse.interpolate(x, &gradient);
+		if (s == std::numeric_limits<double>::max())
+		{
+			check(!sparse.getDomain().contains(x), "sample in the domain was not evaluated");
+			check(d > bandWidth, "sample outside of the domain is not outside of the band");
+			continue;
+		}
+		if (fabs(d) < bandWidth - cellSize)
+			check(fabs(s - d) < cellSize, "distance in the band differs from the dense grid");
+		else if (d > bandWidth + cellSize)
+			check(s > bandWidth - cellSize, "distance outside of the band is not clamped");
+		else if (d < -bandWidth - cellSize)
+			check(s < -bandWidth + cellSize, "distance inside of the band is not clamped");
+		// outside of a convex body the distance is smooth, inside its gradient jumps at the medial axis
+		if ((d > cellSize) && (d < bandWidth - 2.0 * cellSize))
+			check(fabs(gradient.norm() - 1.0) < 0.5, "gradient in the band is not a direction");
+	}
+
+	// outside of the band the gradient points to the closest block of the band
+	Vector3r gradient;
+	check(sparse.interpolate(Vector3r(0.0, 0.0, 0.5), &gradient) == -bandWidth, "distance inside of the band is not clamped");
+	check(gradient.z() > 0.5, "gradient inside the box does not point to the surface");
+	check(sparse.interpolate(Vector3r(0.0, 0.0, 0.1), &gradient) == -bandWidth, "distance inside of the band is not clamped");
+	check(fabs(gradient.norm() - 1.0) < 1.0e-6, "gradient inside the box is not a direction");
+
+	// outside of the domain no gradient is returned
+	gradient = Vector3r::Ones();
+	check(sparse.interpolate(Vector3r(10.0, 0.0, 0.0), &gradient) == std::numeric_limits<double>::max(), "point outside of the domain");
+	check(gradient.isZero(), "gradient outside of the domain is not zero");
+
+	// save and load
+	const std::string fileName = "SparseSDFTest.ssdf";
+	check(sparse.save(fileName), "save failed");
+	SparseSDF loaded;
+	check(loaded.load(fileName), "load failed");
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		Vector3r g1, g2;
+		const double s1 = sparse.interpolate(samples[i], &g1);
+		const double s2 = loaded.interpolate(samples[i], &g2);
+		if ((s1 != s2) || (g1 != g2))
+		{
+			check(false, "loaded field differs from the saved field");
+			break;
+		}
+	}
+
+	// invalid files are rejected
+	const std::vector<char> data = readFile(fileName);
+	const std::string invalidFileName = "SparseSDFTest_invalid.ssdf";
+	std::vector<char> invalid(data.begin(), data.begin() + data.size() / 2);
+	writeFile(invalidFileName, invalid);
+	check(!loaded.load(invalidFileName), "truncated file was loaded");
+
+	invalid = data;
+	invalid[0] = 'X';
+	writeFile(invalidFileName, invalid);
+	check(!loaded.load(invalidFileName), "file without header was loaded");
+
+	// header: magic, version, origin, cell size, band width, number of blocks and values
+	const size_t blockIndexOffset = 2 * sizeof(uint32_t) + 5 * sizeof(double) + 3 * sizeof(int32_t) + sizeof(uint64_t);
+	invalid = data;
+	const int badIndex = sparse.numAllocatedBlocks();
+	memcpy(&invalid[blockIndexOffset], &badIndex, sizeof(int));
+	writeFile(invalidFileName, invalid);
+	check(!loaded.load(invalidFileName), "file with an invalid block index was loaded");
+
+	invalid = data;
+	const uint64_t badNumValues = 1;
+	memcpy(&invalid[blockIndexOffset - sizeof(uint64_t)], &badNumValues, sizeof(uint64_t));
+	writeFile(invalidFileName, invalid);
+	check(!loaded.load(invalidFileName), "file with an invalid number of values was loaded");
+
+	// a rejected file does not change the field
+	check(loaded.interpolate(Vector3r(0.0, 0.0, 1.0)) == sparse.interpolate(Vector3r(0.0, 0.0, 1.0)), "field was changed by an invalid file");
+
+	std::remove(fileName.c_str());
+	std::remove(invalidFileName.c_str());
+
+	if (numFailures == 0)
+		std::cout << "SparseSDFTest passed" << std::endl;
+	return (numFailures == 0) ? 0 : 1;
+}